@@ -0,0 +1,225 @@
+#include "allocator.h"
+
+#include <atomic>
+
+namespace ink::runtime
+{
+	namespace
+	{
+		class heap_allocator : public allocator
+		{
+		public:
+			virtual void* allocate(std::size_t size, std::size_t alignment, alloc_category) override
+			{
+				inkAssert(alignment <= alignof(std::max_align_t), "Over-aligned allocations are not supported");
+				return ::operator new(size);
+			}
+			virtual void deallocate(void* ptr, std::size_t, alloc_category) override
+			{
+				::operator delete(ptr);
+			}
+		};
+
+		struct category_counters
+		{
+			std::atomic<std::size_t> allocations{0};
+			std::atomic<std::size_t> deallocations{0};
+			std::atomic<std::size_t> bytes{0};
+			std::atomic<std::size_t> peak_bytes{0};
+		};
+
+		heap_allocator default_allocator;
+		allocator* installed_allocator = &default_allocator;
+
+		constexpr std::size_t NumCategories = static_cast<std::size_t>(alloc_category::NUM_CATEGORIES);
+		category_counters counters[NumCategories];
+
+		thread_local int guard_depth = 0;
+		thread_local allocator* scoped_allocator = nullptr;
+
+		constexpr std::size_t ObjectHeader = alignof(std::max_align_t);
+		static_assert(ObjectHeader >= sizeof(allocator*), "Object header too small");
+
+		std::size_t align_up(std::size_t value, std::size_t alignment)
+		{
+			return (value + alignment - 1) & ~(alignment - 1);
+		}
+	}
+
+	void set_allocator(allocator* alloc)
+	{
+		installed_allocator = alloc == nullptr ? &default_allocator : alloc;
+	}
+
+	allocator* get_allocator()
+	{
+		return installed_allocator;
+	}
+
+	allocation_stats get_allocation_stats(alloc_category category)
+	{
+		const category_counters& c = counters[static_cast<std::size_t>(category)];
+		return allocation_stats{
+			c.allocations.load(std::memory_order_relaxed),
+			c.deallocations.load(std::memory_order_relaxed),
+			c.bytes.load(std::memory_order_relaxed),
+			c.peak_bytes.load(std::memory_order_relaxed),
+		};
+	}
+
+	allocation_stats get_allocation_stats()
+	{
+		allocation_stats sum{0, 0, 0, 0};
+		for (std::size_t i = 0; i < NumCategories; ++i)
+		{
+			allocation_stats s = get_allocation_stats(static_cast<alloc_category>(i));
+			sum.allocations += s.allocations;
+			sum.deallocations += s.deallocations;
+			sum.bytes += s.bytes;
+			sum.peak_bytes += s.peak_bytes;
+		}
+		return sum;
+	}
+
+	void reset_allocation_stats()
+	{
+		for (category_counters& c : counters)
+		{
+			c.allocations.store(0, std::memory_order_relaxed);
+			c.deallocations.store(0, std::memory_order_relaxed);
+			c.peak_bytes.store(c.bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+	}
+
+	heap_guard::heap_guard() { ++guard_depth; }
+	heap_guard::~heap_guard() { --guard_depth; }
+
+	arena_allocator::arena_allocator(std::size_t block_size)
+		: _blocks{nullptr}, _ptr{nullptr}, _end{nullptr}, _block_size{block_size}, _used{0}, _reserved{0}
+	{ }
+
+	arena_allocator::~arena_allocator()
+	{
+		reset();
+		if (_blocks != nullptr)
+			::operator delete(_blocks);
+	}
+
+	void arena_allocator::add_block(std::size_t min_size)
+	{
+		std::size_t header = align_up(sizeof(block), alignof(std::max_align_t));
+		std::size_t size = min_size + header > _block_size ? min_size + header : _block_size;
+		block* b = static_cast<block*>(::operator new(size));
+		b->size = size;
+
+		// the first block stays first, so reset() can keep it
+		if (_blocks == nullptr)
+		{
+			b->next = nullptr;
+			_blocks = b;
+		}
+		else
+		{
+			b->next = _blocks->next;
+			_blocks->next = b;
+		}
+		_ptr = reinterpret_cast<unsigned char*>(b) + header;
+		_end = reinterpret_cast<unsigned char*>(b) + size;
+		_reserved += size;
+	}
+
+	void* arena_allocator::allocate(std::size_t size, std::size_t alignment, alloc_category)
+	{
+		inkAssert(alignment <= alignof(std::max_align_t), "Over-aligned allocations are not supported");
+		unsigned char* start = _ptr == nullptr ? nullptr
+			: reinterpret_cast<unsigned char*>(align_up(reinterpret_cast<std::size_t>(_ptr), alignment));
+		if (start == nullptr || start + size > _end)
+		{
+			add_block(size);
+			start = _ptr;
+		}
+		_ptr = start + size;
+		_used += size;
+		return start;
+	}
+
+	void arena_allocator::reset()
+	{
+		if (_blocks == nullptr)
+			return;
+		block* b = _blocks->next;
+		while (b != nullptr)
+		{
+			block* next = b->next;
+			::operator delete(b);
+			b = next;
+		}
+		_blocks->next = nullptr;
+		_ptr = reinterpret_cast<unsigned char*>(_blocks) + align_up(sizeof(block), alignof(std::max_align_t));
+		_end = reinterpret_cast<unsigned char*>(_blocks) + _blocks->size;
+		_used = 0;
+		_reserved = _blocks->size;
+	}
+
+	namespace internal
+	{
+		allocator* current_allocator()
+		{
+			return scoped_allocator != nullptr ? scoped_allocator : installed_allocator;
+		}
+
+		allocator_scope::allocator_scope(allocator* alloc)
+			: _previous{scoped_allocator}
+		{
+			if (alloc != nullptr)
+				scoped_allocator = alloc;
+		}
+
+		allocator_scope::~allocator_scope()
+		{
+			scoped_allocator = _previous;
+		}
+
+		void* allocate(allocator* alloc, alloc_category category, std::size_t size, std::size_t alignment)
+		{
+			if (guard_depth > 0)
+				inkFail("Runtime allocation while a heap_guard is active");
+
+			category_counters& c = counters[static_cast<std::size_t>(category)];
+			c.allocations.fetch_add(1, std::memory_order_relaxed);
+			std::size_t now = c.bytes.fetch_add(size, std::memory_order_relaxed) + size;
+			std::size_t peak = c.peak_bytes.load(std::memory_order_relaxed);
+			while (now > peak && !c.peak_bytes.compare_exchange_weak(peak, now, std::memory_order_relaxed)) { }
+
+			return alloc->allocate(size, alignment, category);
+		}
+
+		void deallocate(allocator* alloc, alloc_category category, void* ptr, std::size_t size)
+		{
+			if (ptr == nullptr)
+				return;
+
+			category_counters& c = counters[static_cast<std::size_t>(category)];
+			c.deallocations.fetch_add(1, std::memory_order_relaxed);
+			c.bytes.fetch_sub(size, std::memory_order_relaxed);
+
+			alloc->deallocate(ptr, size, category);
+		}
+
+		void* allocate_object(alloc_category category, std::size_t size)
+		{
+			allocator* alloc = current_allocator();
+			unsigned char* block = static_cast<unsigned char*>(allocate(alloc, category, size + ObjectHeader));
+			*reinterpret_cast<allocator**>(block) = alloc;
+			return block + ObjectHeader;
+		}
+
+		void deallocate_object(alloc_category category, void* ptr, std::size_t size)
+		{
+			if (ptr == nullptr)
+				return;
+			unsigned char* block = static_cast<unsigned char*>(ptr) - ObjectHeader;
+			deallocate(*reinterpret_cast<allocator**>(block), category, block, size + ObjectHeader);
+		}
+	}
+}
@@ -1,18 +1,35 @@
 #pragma once
 
 #include "system.h"
+#include "allocator.h"
 
 namespace ink::runtime::internal
 {
-	template<typename T, bool dynamic, size_t initialCapacity>
+	template<typename T, bool dynamic, size_t initialCapacity, alloc_category Category = alloc_category::stacks>
 	class managed_array {
 	public:
-		managed_array() : _capacity{initialCapacity}, _size{0}{
+		managed_array() : managed_array(initialCapacity) { }
+		// Dynamic arrays start with the given capacity. For fixed arrays it
+		//  limits the inline storage in use
+		explicit managed_array(size_t capacity) : _alloc{current_allocator()}, _capacity{capacity}, _size{0}{
 			if constexpr (dynamic) {
-				_dynamic_data = new T[initialCapacity];
+				if (_capacity == 0) { _capacity = 1; }
+				_dynamic_data = new_array<T>(_alloc, Category, _capacity);
+			} else if (_capacity > initialCapacity) {
+				inkFail("Capacity exceeds the fixed size set in config.h");
+				_capacity = initialCapacity;
+			}
+		}
+		~managed_array() {
+			if constexpr (dynamic) {
+				delete_array(_alloc, Category, _dynamic_data, _capacity);
 			}
 		}
 
+		// == Non-Copyable ==
+		managed_array(const managed_array&) = delete;
+		managed_array& operator=(const managed_array&) = delete;
+
 		const T& operator[](size_t i) const { return data()[i]; }
 		T& operator[](size_t i) { return data()[i]; }
 		const T* data() const {
@@ -41,14 +58,32 @@ namespace ink::runtime::internal
 		T& push() {
 			if constexpr (dynamic) {
 				if (_size == _capacity) { extend(); }
-			} else {
-				ink_assert(_size <= _capacity, "Stack Overflow!");
+			} else if (_size >= _capacity) {
+				// writes go to a scratch element, never to a live one
+				inkFail("Stack Overflow!");
+				_overflow = T{};
+				return _overflow;
 			}
 			return data()[_size++];
 		}
+		// Appends count elements without initializing them, returns the first
+		T* push(size_t count) {
+			if constexpr (dynamic) {
+				while (_size + count > _capacity) { extend(); }
+			} else if (_size + count > _capacity) {
+				inkFail("Stack Overflow!");
+				return nullptr;
+			}
+			T* first = data() + _size;
+			_size += count;
+			return first;
+		}
 		void clear() { _size = 0; }
 		void resize(size_t size) {
-			ink_assert(size <= _size, "Only allow to reduce size");
+			if (size > _size) {
+				inkFail("Only allow to reduce size");
+				return;
+			}
 			_size = size;
 		}
 
@@ -56,24 +91,26 @@ namespace ink::runtime::internal
 	private:
 
 		if_t<dynamic, char, T> _static_data[dynamic ? 1 : initialCapacity];
+		if_t<dynamic, char, T> _overflow;
 		T* _dynamic_data = nullptr;
+		allocator* _alloc;
 		size_t _capacity;
 		size_t _size;
 	};
 
-	template<typename T, bool dynamic, size_t initialCapacity>
-	void managed_array<T, dynamic, initialCapacity>::extend()
+	template<typename T, bool dynamic, size_t initialCapacity, alloc_category Category>
+	void managed_array<T, dynamic, initialCapacity, Category>::extend()
 	{
 		static_assert(dynamic, "Can only extend if array is dynamic!");
 		size_t new_capacity = 1.5f * _capacity;
 		if (new_capacity < 5) { new_capacity = 5; }
-		T* new_data = new T[new_capacity];
+		T* new_data = new_array<T>(_alloc, Category, new_capacity);
 
 		for(size_t i = 0; i < _capacity; ++i) {
 			new_data[i] = _dynamic_data[i];
 		}
 
-		delete[] _dynamic_data;
+		delete_array(_alloc, Category, _dynamic_data, _capacity);
 		_dynamic_data = new_data;
 		_capacity = new_capacity;
 	}
@@ -116,6 +153,37 @@ namespace ink::runtime::internal
 		// Resets all values and clears any save points
 		void clear(const T& value);
 
+		// == Snapshots ==
+		template<typename Snapper>
+		void snap(Snapper& snapper) const
+		{
+			snapper.write(_saved);
+			snapper.write(_capacity);
+			for (size_t i = 0; i < _capacity; ++i)
+				snapper.write(_array[i]);
+			// the temp array only holds values while we are saved
+			if (_saved)
+				for (size_t i = 0; i < _capacity; ++i)
+					snapper.write(_temp[i]);
+		}
+		template<typename Loader>
+		void snap_load(Loader& loader)
+		{
+			loader.read(_saved);
+			size_t capacity;
+			loader.read(capacity);
+			if (capacity > _capacity) {
+				inkFail("Snapshot does not fit into restorable array");
+				return;
+			}
+			for (size_t i = 0; i < capacity; ++i)
+				loader.read(_array[i]);
+			clear_temp();
+			if (_saved)
+				for (size_t i = 0; i < capacity; ++i)
+					loader.read(_temp[i]);
+		}
+
 	protected:
 		inline T* buffer() { return _array; }
 		void set_new_buffer(T* buffer, size_t capacity) {
@@ -125,7 +193,14 @@ namespace ink::runtime::internal
 		}
 
 	private:
-		inline void check_index(size_t index) const { inkAssert(index < capacity(), "Index out of range!"); }
+		inline bool check_index(size_t index) const
+		{
+			if (index >= capacity()) {
+				inkFail("Index out of range!");
+				return false;
+			}
+			return true;
+		}
 		void clear_temp();
 	private:
 		bool _saved;
@@ -147,8 +222,12 @@ namespace ink::runtime::internal
 	template<typename T>
 	inline void basic_restorable_array<T>::set(size_t index, const T& value)
 	{
-		check_index(index);
-		inkAssert(value != _null, "Can not add a value considered a 'null' to a restorable_array");
+		if (!check_index(index))
+			return;
+		if (value == _null) {
+			inkFail("Can not add a value considered a 'null' to a restorable_array");
+			return;
+		}
 
 		// If we're saved, store in second half of the array
 		if (_saved)
@@ -161,7 +240,8 @@ namespace ink::runtime::internal
 	template<typename T>
 	inline const T& basic_restorable_array<T>::get(size_t index) const
 	{
-		check_index(index);
+		if (!check_index(index))
+			return _null;
 
 		// If we're in save mode and we have a value at that index, return that instead
 		if (_saved && _temp[index] != _null)
@@ -244,12 +324,13 @@ namespace ink::runtime::internal
 	public:
 		allocated_restorable_array(const T& initial, const T& nullValue)
 			: basic_restorable_array<T>(0, 0, nullValue), _initialValue{initial}, _nullValue{nullValue},
-				_buffer{nullptr}
+				_buffer{nullptr}, _alloc{current_allocator()}
 		{}
 		allocated_restorable_array(size_t capacity, const T& initial, const T &nullValue)
-			: basic_restorable_array<T>(new T[capacity * 2], capacity * 2, nullValue),
+			: basic_restorable_array<T>(new_array<T>(current_allocator(), alloc_category::stacks, capacity * 2), capacity * 2, nullValue),
 			_initialValue{initial},
-			_nullValue{nullValue}
+			_nullValue{nullValue},
+			_alloc{current_allocator()}
 		{
 			_buffer = this->buffer();
 			this->clear(_initialValue);
@@ -257,14 +338,14 @@ namespace ink::runtime::internal
 
 		void resize(size_t n) {
 			size_t new_capacity = 2 * n;
-			T* new_buffer = new T[new_capacity];
+			T* new_buffer = new_array<T>(_alloc, alloc_category::stacks, new_capacity);
 			if (_buffer) {
 				for(size_t i = 0; i < base::capacity(); ++i) {
 					new_buffer[i] = _buffer[i];
 					// copy temp
 					new_buffer[i + base::capacity()] = _buffer[i + base::capacity()];
 				}
-				delete[] _buffer;
+				delete_array(_alloc, alloc_category::stacks, _buffer, 2 * base::capacity());
 			}
 			for(size_t i = base::capacity(); i < new_capacity; ++i) {
 				new_buffer[i] = _initialValue;
@@ -278,7 +359,7 @@ namespace ink::runtime::internal
 		~allocated_restorable_array()
 		{
 			if(_buffer) {
-				delete[] _buffer;
+				delete_array(_alloc, alloc_category::stacks, _buffer, 2 * base::capacity());
 				_buffer = nullptr;
 			}
 		}
@@ -287,5 +368,6 @@ namespace ink::runtime::internal
 		T _initialValue;
 		T _nullValue;
 		T* _buffer;
+		allocator* _alloc;
 	};
 }
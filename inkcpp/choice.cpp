@@ -1,45 +1,60 @@
 #include "choice.h"
 #include "output.h"
-#include "string_utils.h"
 #include "string_table.h"
+#include "runner_impl.h"
+#include "globals_impl.h"
 
 namespace ink
 {
 	namespace runtime
 	{
-		choice& choice::setup(internal::basic_stream& in, internal::string_table& strings, internal::list_table& lists, int index, uint32_t path, thread_t thread)
+		choice& choice::setup(internal::basic_stream& in, internal::string_table& strings, internal::list_table& lists, int index, uint32_t path, thread_t thread,
+			internal::runner_impl* runner, uint32_t tags_begin, uint32_t tags_end)
+		{
+			// Clean story literals and strings are not copied, see basic_stream::get_alloc
+			_text = in.get_alloc<true, true>(strings, lists);
+			_parts[0] = _parts[1] = nullptr;
+			setup_common(index, path, thread, runner, tags_begin, tags_end);
+			return *this;
+		}
+
+		choice& choice::setup_lazy(const char* part, const char* second_part, int index, uint32_t path, thread_t thread,
+			internal::runner_impl* runner, uint32_t tags_begin, uint32_t tags_end)
+		{
+			_text = nullptr;
+			_parts[0] = part;
+			_parts[1] = second_part;
+			setup_common(index, path, thread, runner, tags_begin, tags_end);
+			return *this;
+		}
+
+		void choice::setup_common(int index, uint32_t path, thread_t thread,
+			internal::runner_impl* runner, uint32_t tags_begin, uint32_t tags_end)
 		{
-			char* text = nullptr;
-			// if we only have one item in our output stream
-			if (in.queued() == 2)
-			{
-				// If it's a string, just grab it. Otherwise, use allocation
-				const internal::value& data = in.peek();
-				switch (data.type())
-				{
-				case internal::value_type::string:
-					text = strings.duplicate(data.get<internal::value_type::string>());
-					in.discard(2);
-					break;
-				default:
-					text = in.get_alloc(strings, lists);
-				}
-			}
-			else
-			{
-				// Non-string. Must allocate
-				text = in.get_alloc(strings, lists);
-			}
-			char* end = text;
-			while(*end) { ++end; }
-			end = ink::runtime::internal::clean_string<true, true>(text, end);
-			*end = 0;
-			_text = text;
 			// Index/path
 			_index = index;
 			_path = path;
 			_thread = thread;
-			return *this;
+			// Tags
+			_runner = runner;
+			_tags_begin = tags_begin;
+			_tags_end = tags_end;
+		}
+
+		const char* choice::text() const
+		{
+			if (_text == nullptr)
+				_text = _runner->choice_text(_parts[0], _parts[1]);
+			return _text;
+		}
+
+		const char* choice::get_tag(size_t index) const
+		{
+			if (index >= num_tags()) {
+				inkFail("Choice tag index out of range");
+				return nullptr;
+			}
+			return _runner->get_choice_tag(_tags_begin + index);
 		}
 	}
 }
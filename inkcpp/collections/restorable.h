@@ -81,8 +81,8 @@ namespace ink::runtime::internal
 		// Creates a save point which can later be restored to or forgotten
 		void save()
 		{
-			inkAssert(_save == ~0, "Collection is already saved. You should never call save twice. Ignoring.");
 			if (_save != ~0) {
+				inkFail("Collection is already saved. You should never call save twice. Ignoring.");
 				return;
 			}
 
@@ -93,8 +93,8 @@ namespace ink::runtime::internal
 		// Restore to the last save point
 		void restore()
 		{
-			inkAssert(_save != ~0, "Collection can't be restored because it's not saved. Ignoring.");
 			if (_save == ~0) {
+				inkFail("Collection can't be restored because it's not saved. Ignoring.");
 				return;
 			}
 
@@ -109,8 +109,8 @@ namespace ink::runtime::internal
 		template<typename NullifyMethod>
 		void forget(NullifyMethod nullify)
 		{
-			inkAssert(_save != ~0, "Can't forget save point because there is none. Ignoring.");
 			if (_save == ~0) {
+				inkFail("Can't forget save point because there is none. Ignoring.");
 				return;
 			}
 
@@ -149,7 +149,14 @@ namespace ink::runtime::internal
 
 			// Overflow check
 			if (_pos >= _size)
+			{
 				overflow(_buffer, _size);
+				// out of memory, writes go to a scratch element until the error is handled
+				if (_pos >= _size) {
+					_overflow = elem;
+					return _overflow;
+				}
+			}
 
 			// Push onto the top
 			_buffer[_pos++] = elem;
@@ -163,7 +170,11 @@ namespace ink::runtime::internal
 		const ElementType& pop(IsNullPredicate isNull)
 		{
 			// Make sure we have something to pop
-			inkAssert(_pos > 0, "Can not pop. No elements to pop!");
+			if (_pos == 0)
+			{
+				inkFail("Can not pop. No elements to pop!");
+				return none();
+			}
 
 			// Jump over save data
 			if (_pos == _save)
@@ -181,7 +192,11 @@ namespace ink::runtime::internal
 		template<typename IsNullPredicate>
 		const ElementType& top(IsNullPredicate isNull) const
 		{
-			inkAssert(_pos > 0, "Can not top. No elememnts to show!");
+			if (_pos == 0)
+			{
+				inkFail("Can not top. No elememnts to show!");
+				return none();
+			}
 			auto pos = _pos;
 			if (_pos == _save)
 				pos = _jump;
@@ -192,12 +207,29 @@ namespace ink::runtime::internal
 
 		bool is_empty() const { return _pos == 0; }
 
+		// Position of an element in the buffer
+		size_t index_of(const ElementType& elem) const { return &elem - _buffer; }
+
 		void clear()
 		{
 			_pos = 0;
 			_save = _jump = ~0;
 		}
 
+		// Replaces the content of an unsaved collection with a copy of the given elements
+		void assign(const ElementType* elems, size_t count)
+		{
+			if (_save != ~0) {
+				inkFail("Can not assign to a saved collection");
+				return;
+			}
+			if (!reserve(count))
+				return;
+			for (size_t i = 0; i < count; ++i)
+				_buffer[i] = elems[i];
+			_pos = count;
+		}
+
 		// Forward iterate
 		template<typename CallbackMethod, typename IsNullPredicate>
 		void for_each(CallbackMethod callback, IsNullPredicate isNull) const
@@ -326,13 +358,107 @@ namespace ink::runtime::internal
 			return count;
 		}
 
+		// == Snapshots ==
+
+		// Writes positions and all elements, including data kept for a save point
+		template<typename Snapper>
+		void snap(Snapper& snapper) const
+		{
+			snapper.write(_pos);
+			snapper.write(_save);
+			snapper.write(_jump);
+			for (size_t i = 0; i < used(); ++i)
+				snapper.write(_buffer[i]);
+		}
+
+		// Replaces the content with data written by snap
+		template<typename Loader>
+		void snap_load(Loader& loader)
+		{
+			loader.read(_pos);
+			loader.read(_save);
+			loader.read(_jump);
+			if (!reserve(used()))
+				return;
+			for (size_t i = 0; i < used(); ++i)
+				loader.read(_buffer[i]);
+		}
+
+		// Writes positions and only the elements for which changed(index) is true
+		template<typename Snapper, typename ChangedPredicate>
+		void snap_changed(Snapper& snapper, ChangedPredicate changed) const
+		{
+			snapper.write(_pos);
+			snapper.write(_save);
+			snapper.write(_jump);
+			size_t count = 0;
+			for (size_t i = 0; i < used(); ++i)
+				if (changed(i))
+					++count;
+			snapper.write(count);
+			for (size_t i = 0; i < used(); ++i)
+			{
+				if (changed(i))
+				{
+					snapper.write(i);
+					snapper.write(_buffer[i]);
+				}
+			}
+		}
+
+		// Applies data written by snap_changed on top of the current content
+		template<typename Loader>
+		void snap_load_changed(Loader& loader)
+		{
+			loader.read(_pos);
+			loader.read(_save);
+			loader.read(_jump);
+			if (!reserve(used()))
+				return;
+			size_t count;
+			loader.read(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				size_t index;
+				loader.read(index);
+				if (index >= used())
+				{
+					inkFail("Snapshot element index out of range");
+					return;
+				}
+				loader.read(_buffer[index]);
+			}
+		}
+
 	protected:
 		// Called when we run out of space in buffer. 
 		virtual void overflow(ElementType*& buffer, size_t& size) {
-			throw ink_exception("Restorable run out of memory!");
+			inkFail("Restorable run out of memory!");
+		}
+
+		// Grows the buffer to at least count elements. False if it is out of memory
+		bool reserve(size_t count)
+		{
+			while (_size < count)
+			{
+				size_t size = _size;
+				overflow(_buffer, _size);
+				if (_size == size)
+					return false;
+			}
+			return true;
+		}
+
+		// Returned in place of an element after a failed assert
+		static const ElementType& none()
+		{
+			static const ElementType empty{};
+			return empty;
 		}
 
 	private:
+		// Number of buffer elements in use, including saved ones past _pos
+		size_t used() const { return _save != ~0 && _save > _pos ? _save : _pos; }
 
 		template<typename Predicate>
 		ElementType* reverse_find_impl(Predicate predicate) const
@@ -373,5 +499,8 @@ namespace ink::runtime::internal
 		// Jump and save points. Used when we've been saved.
 		size_t _jump;
 		size_t _save;
+
+		// Receives pushes which did not fit, so no live element is overwritten
+		ElementType _overflow{};
 	};
 }
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "system.h"
+#include "types.h"
+
+#ifndef INK_ENABLE_EXCEPTIONS
+namespace ink::runtime::internal
+{
+	// Without exceptions a failed assert records its message in the innermost
+	//  error_scope of the thread and returns. Code which can not go on after a
+	//  failed assert checks error_raised() and returns early, up to the call
+	//  which opened the scope. Errors outside of any scope abort.
+	class error_scope
+	{
+	public:
+		error_scope();
+		~error_scope();
+		error_scope(const error_scope&) = delete;
+		error_scope& operator=(const error_scope&) = delete;
+
+		bool failed() const { return _failed; }
+
+		// message of the first failed assert
+		const char* message() const { return _message; }
+
+	private:
+		error_scope* _prev;
+		bool _failed = false;
+		const char* _message = nullptr;
+
+		friend void raise_error(const char*);
+		friend bool error_raised();
+	};
+
+	// innermost scope of this thread
+	extern thread_local error_scope* current_error_scope;
+
+	// Records the error in the innermost scope, aborts if there is none
+	void raise_error(const char* message);
+
+	// Whether an assert failed in the innermost scope
+	inline bool error_raised()
+	{
+		return current_error_scope != nullptr && current_error_scope->_failed;
+	}
+}
+#else
+namespace ink::runtime::internal
+{
+	// Failed asserts throw, so code after one only runs if it held
+	constexpr bool error_raised() { return false; }
+}
+#endif
+
+namespace ink::runtime::internal
+{
+	template<typename T>
+	void drop(T*& obj) { delete obj; obj = nullptr; }
+	template<typename T>
+	void drop(story_ptr<T>& obj) { obj = nullptr; }
+
+	// Creates an object from loaded data. A failed check throws with
+	//  exceptions, without them the object is dropped and null returned.
+	//  result (if any) tells the caller which happened
+	template<typename Create>
+	auto checked_create(load_result* result, Create&& create) -> decltype(create())
+	{
+#ifdef INK_ENABLE_EXCEPTIONS
+		auto obj = create();
+		if (result)
+			*result = load_result{};
+#else
+		error_scope scope;
+		auto obj = create();
+		if (scope.failed())
+			drop(obj);
+		if (result)
+			*result = load_result{!scope.failed(), scope.message()};
+#endif
+		return obj;
+	}
+}
@@ -2,7 +2,7 @@
 
 namespace ink::runtime::internal
 {
-	functions::functions() : _list(nullptr), _last(nullptr)
+	functions::functions() : _list(nullptr), _last(nullptr), _alloc(current_allocator())
 	{
 	}
 
@@ -23,6 +23,7 @@ namespace ink::runtime::internal
 
 	void functions::add(hash_t name, function_base* func)
 	{
+		allocator_scope scope(_alloc);
 		entry* current = new entry;
 		current->name = name;
 		current->value = func;
@@ -21,7 +21,7 @@ namespace ink::runtime::internal
 		bool call(hash_t name, basic_eval_stack* stack, size_t num_arguments, string_table& strings);
 
 	private:
-		struct entry
+		struct entry : heap_object<alloc_category::registry>
 		{
 			hash_t name;
 			function_base* value;
@@ -31,5 +31,6 @@ namespace ink::runtime::internal
 		// TODO: Better than a linked list?
 		entry* _list;
 		entry* _last;
+		allocator* _alloc;
 	};
 }
\ No newline at end of file
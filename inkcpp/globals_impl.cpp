@@ -1,17 +1,24 @@
 #include "globals_impl.h"
 #include "story_impl.h"
 #include "runner_impl.h"
+#include "snapshot_impl.h"
+#include "journal_impl.h"
+#include "error.h"
 
 namespace ink::runtime::internal
 {
-	globals_impl::globals_impl(const story_impl* story)
+	globals_impl::globals_impl(const story_impl* story, const capacities& caps)
 		: _num_containers(story->num_containers())
 		, _visit_counts(_num_containers)
 		, _owner(story)
 		, _runners_start(nullptr)
 		, _lists(story->list_meta(), story->get_header())
+		, _capacities(caps)
+		, _variables(caps.global_variables)
 		, _globals_initialized(false)
+		, _variables_changed(caps.global_variables)
 	{
+		_lists.set_checkpoint(_checkpoint);
 		if (_lists) {
 			// initelize static lists
 			const list_flag* flags = story->lists();
@@ -23,6 +30,22 @@ namespace ink::runtime::internal
 				}
 				++flags;
 			}
+		}
+
+		define_globals();
+	}
+
+	void globals_impl::define_globals()
+	{
+		// Copy the variables the compiler evaluated, or define the list flags
+		//  and leave the global declarations to the first runner
+		size_t num_globals;
+		if (const entry* image = _owner->globals_image(num_globals)) {
+			_variables.assign(image, num_globals);
+			for (size_t i = 0; i < num_globals; ++i)
+				_variables_changed.push() = _checkpoint;
+			_globals_initialized = true;
+		} else if (_lists) {
 			for(const auto& flag : _lists.named_flags()) {
 				set_variable(hash_string(flag.name), value{}.set<value_type::list_flag>(
 						list_flag{
@@ -33,10 +56,107 @@ namespace ink::runtime::internal
 		}
 	}
 
+	globals_impl::visit_counts::visit_counts(size_t len)
+		: _pages{nullptr}, _len{len}, _alloc{current_allocator()}
+	{
+		// every page is our own from the start, so only forks copy pages
+		//  while the story plays
+		_pages = new_array<page*>(_alloc, alloc_category::registry, num_pages());
+		for (size_t i = 0; i < num_pages(); ++i)
+			_pages[i] = new page;
+	}
+
+	globals_impl::visit_counts::~visit_counts()
+	{
+		for (size_t i = 0; i < num_pages(); ++i)
+			release(_pages[i]);
+		delete_array(_alloc, alloc_category::registry, _pages, num_pages());
+	}
+
+	void globals_impl::visit_counts::release(page* p)
+	{
+		if (p->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			delete p;
+	}
+
+	globals_impl::visit_count& globals_impl::visit_counts::write(size_t i)
+	{
+		page*& p = _pages[i / PageSize];
+
+		// a page we own alone can't be shared concurrently, because sharing
+		//  happens through us
+		if (p->references.load(std::memory_order_acquire) != 1)
+		{
+			allocator_scope scope(_alloc);
+			page* copy = new page;
+			for (size_t j = 0; j < PageSize; ++j)
+				copy->data[j] = p->data[j];
+			release(p);
+			p = copy;
+		}
+		return p->data[i % PageSize];
+	}
+
+	void globals_impl::visit_counts::share(const visit_counts& other)
+	{
+		inkAssert(_len == other._len, "Can only share visit counts of the same story");
+		for (size_t i = 0; i < num_pages(); ++i)
+		{
+			other._pages[i]->references.fetch_add(1, std::memory_order_relaxed);
+			release(_pages[i]);
+			_pages[i] = other._pages[i];
+		}
+	}
+
+	void globals_impl::visit_counts::clear()
+	{
+		allocator_scope scope(_alloc);
+		for (size_t i = 0; i < num_pages(); ++i)
+		{
+			page*& p = _pages[i];
+			if (p->references.load(std::memory_order_acquire) != 1)
+			{
+				release(p);
+				p = new page;
+				continue;
+			}
+			for (size_t j = 0; j < PageSize; ++j)
+				p->data[j] = visit_count{};
+		}
+	}
+
+	void globals_impl::reset()
+	{
+		if (_journal)
+			_journal->reset_globals();
+		_visit_counts.clear();
+		_turn_count = 0;
+		_lists.clear();
+		bool saved = _variables.is_saved();
+		_variables.clear();
+		_variables_changed.clear();
+		_globals_initialized = false;
+
+		// earlier snapshots can't be the base of a delta anymore
+		_first_checkpoint = _checkpoint;
+		_checkpoint = _first_checkpoint + 1;
+		_lists.set_checkpoint(_checkpoint);
+		define_globals();
+
+		// runners at a save point still forget or restore it
+		if (saved)
+			_variables.save();
+
+		// drop strings, except the ones runners still hold
+		gc();
+	}
+
 	void globals_impl::visit(uint32_t container_id)
 	{
-		_visit_counts[container_id].visits += 1;
-		_visit_counts[container_id].turns  = 0;
+		visit_count& count = _visit_counts.write(container_id);
+		count.visits += 1;
+		count.last_turn = _turn_count;
+		count.changed = _checkpoint;
 	}
 
 	uint32_t globals_impl::visits(uint32_t container_id) const
@@ -46,28 +166,37 @@ namespace ink::runtime::internal
 
 	void globals_impl::turn()
 	{
-		for(size_t i = 0; i < _visit_counts.size(); ++i)
-		{
-			if(_visit_counts[i].turns != -1) {
-				_visit_counts[i].turns += 1;
-			}
-		}
+		++_turn_count;
 	}
 
 	uint32_t globals_impl::turns(uint32_t container_id) const
 	{
-		return _visit_counts[container_id].turns;
+		int32_t last_turn = _visit_counts[container_id].last_turn;
+		return last_turn == -1 ? -1 : _turn_count - last_turn;
 	}
 
 
 
+#ifdef INK_ENABLE_PROFILE
+	profile globals_impl::get_profile() const
+	{
+		profile result = _retired_profile;
+		for (auto iter = _runners_start; iter != nullptr; iter = iter->next)
+			result.merge(iter->object->get_profile());
+		return result;
+	}
+#endif
+
 	void globals_impl::add_runner(const runner_impl* runner)
 	{
 		// cache start of list
 		auto first = _runners_start;
 
 		// create new entry as start, linked to the previous start
-		_runners_start = new runner_entry{ runner, first };
+		allocator_scope scope(_alloc);
+		_runners_start = new runner_entry;
+		_runners_start->object = runner;
+		_runners_start->next = first;
 	}
 
 	void globals_impl::remove_runner(const runner_impl* runner)
@@ -79,6 +208,9 @@ namespace ink::runtime::internal
 		{
 			if (iter->object == runner)
 			{
+#ifdef INK_ENABLE_PROFILE
+				_retired_profile.merge(runner->get_profile());
+#endif
 				// Fixup next pointer
 				if (prev != nullptr)
 					prev->next = iter->next;
@@ -98,7 +230,23 @@ namespace ink::runtime::internal
 
 	void globals_impl::set_variable(hash_t name, const value& val)
 	{
-		_variables.set(name, val);
+		variable_changed(_variables.set(name, val));
+	}
+
+	value* globals_impl::modify_variable(hash_t name)
+	{
+		size_t index;
+		value* val = _variables.get(name, index);
+		if (val != nullptr)
+			variable_changed(index);
+		return val;
+	}
+
+	void globals_impl::variable_changed(size_t index)
+	{
+		while (_variables_changed.size() <= index)
+			_variables_changed.push() = 0;
+		_variables_changed[index] = _checkpoint;
 	}
 
 	const value* globals_impl::get_variable(hash_t name) const
@@ -131,26 +279,35 @@ namespace ink::runtime::internal
 		return fetch_variable<value_type::int32,int32_t>(get_variable(name));
 	}
 	bool globals_impl::set_int(hash_t name, int32_t i) {
-		return try_set_value<value_type::int32, int32_t>(get_variable(name), i);
+		bool set = try_set_value<value_type::int32, int32_t>(modify_variable(name), i);
+		if (set && _journal)
+			_journal->set_global(name, value{}.set<value_type::int32>(i));
+		return set;
 	}
 	optional<uint32_t> globals_impl::get_uint(hash_t name) const {
 		return fetch_variable<value_type::uint32,uint32_t>(get_variable(name));
 	}
 	bool globals_impl::set_uint(hash_t name, uint32_t i) {
-		return try_set_value<value_type::uint32, uint32_t>(get_variable(name), i);
+		bool set = try_set_value<value_type::uint32, uint32_t>(modify_variable(name), i);
+		if (set && _journal)
+			_journal->set_global(name, value{}.set<value_type::uint32>(i));
+		return set;
 	}
 	optional<float> globals_impl::get_float(hash_t name) const {
 		return fetch_variable<value_type::float32,float>(get_variable(name));
 	}
 	bool globals_impl::set_float(hash_t name, float i) {
-		return try_set_value<value_type::float32, float>(get_variable(name), i);
+		bool set = try_set_value<value_type::float32, float>(modify_variable(name), i);
+		if (set && _journal)
+			_journal->set_global(name, value{}.set<value_type::float32>(i));
+		return set;
 	}
 
 	optional<const char*> globals_impl::get_str(hash_t name) const {
 		return fetch_variable<value_type::string, const char*>(get_variable(name));
 	}
 	bool globals_impl::set_str(hash_t name, const char* val) {
-		value* v = get_variable(name);
+		value* v = modify_variable(name);
 		if (v->type() == value_type::string)
 		{
 			size_t size = 0;
@@ -164,11 +321,26 @@ namespace ink::runtime::internal
 			}
 			*ptr = 0;
 			*v = value{}.set<value_type::string>(static_cast<const char*>(new_string), true);
+			if (_journal)
+				_journal->set_global(name, *v);
 			return true;
 		}
 		return false;
 	}
 
+	bool globals_impl::set_recorded(hash_t name, const value& val)
+	{
+		switch (val.type())
+		{
+		case value_type::int32: return set_int(name, val.get<value_type::int32>());
+		case value_type::uint32: return set_uint(name, val.get<value_type::uint32>());
+		case value_type::float32: return set_float(name, val.get<value_type::float32>());
+		case value_type::string: return set_str(name, val.get<value_type::string>());
+		default: inkFail("Journal global variable has an unsupported type");
+		}
+		return false;
+	}
+
 	void globals_impl::initialize_globals(runner_impl* run)
 	{
 		// If no way to move there, then there are no globals.
@@ -180,6 +352,7 @@ namespace ink::runtime::internal
 
 		// execute one line to startup the globals
 		run->getline_silent();
+		_globals_initialized = true;
 	}
 
 	void globals_impl::gc()
@@ -216,4 +389,194 @@ namespace ink::runtime::internal
 	{
 		_variables.forget();
 	}
+
+	template<typename Callback>
+	snapshot* globals_impl::with_runners(Callback callback) const
+	{
+		// collect runners in creation order (the list is built back to front)
+		size_t num_runners = 0;
+		for (auto iter = _runners_start; iter != nullptr; iter = iter->next)
+			++num_runners;
+		managed_array<const runner_impl*, true, 4> runners;
+		for (size_t i = 0; i < num_runners; ++i)
+			runners.push() = nullptr;
+		size_t i = num_runners;
+		for (auto iter = _runners_start; iter != nullptr; iter = iter->next)
+			runners[--i] = iter->object;
+
+		return callback(runners.data(), num_runners);
+	}
+
+	snapshot* globals_impl::create_snapshot() const
+	{
+		return with_runners([this](const runner_impl* const* runners, size_t num_runners) {
+			return snapshot_impl::create(*this, runners, num_runners, next_snapshot_id());
+		});
+	}
+
+	snapshot* globals_impl::delta_since(uint32_t snapshot_id) const
+	{
+		// without exceptions an unknown base returns null instead of aborting
+		return checked_create(nullptr, [this, snapshot_id]() -> snapshot* {
+			if (snapshot_id < _first_checkpoint || snapshot_id >= _checkpoint) {
+				inkFail("No changes recorded since the requested snapshot");
+				return nullptr;
+			}
+			return with_runners([this, snapshot_id](const runner_impl* const* runners, size_t num_runners) {
+				return snapshot_impl::create(*this, runners, num_runners, next_snapshot_id(), snapshot_id);
+			});
+		});
+	}
+
+	uint32_t globals_impl::next_snapshot_id() const
+	{
+		_lists.set_checkpoint(_checkpoint + 1);
+		return _checkpoint++;
+	}
+
+	void globals_impl::snap(snapper& snapper) const
+	{
+		snapper.write(_num_containers);
+		snapper.write(_turn_count);
+
+		// only write visited containers
+		uint32_t num_visited = 0;
+		for (size_t i = 0; i < _visit_counts.size(); ++i)
+			if (_visit_counts[i] != visit_count{})
+				++num_visited;
+		snapper.write(num_visited);
+		for (size_t i = 0; i < _visit_counts.size(); ++i)
+		{
+			if (_visit_counts[i] != visit_count{})
+			{
+				snapper.write(static_cast<uint32_t>(i));
+				snapper.write(_visit_counts[i].visits);
+				snapper.write(_visit_counts[i].last_turn);
+			}
+		}
+
+		_lists.snap(snapper);
+		_variables.snap(snapper);
+	}
+
+	void globals_impl::snap_load(loader& loader)
+	{
+		uint32_t num_containers;
+		loader.read(num_containers);
+		if (num_containers != _num_containers) {
+			inkFail("Snapshot has a different number of containers than the story");
+			return;
+		}
+		loader.read(_turn_count);
+
+		for (size_t i = 0; i < _visit_counts.size(); ++i)
+			if (_visit_counts[i] != visit_count{} || _visit_counts[i].changed != 0)
+				_visit_counts.write(i) = visit_count{};
+		uint32_t num_visited;
+		loader.read(num_visited);
+		for (uint32_t i = 0; i < num_visited; ++i)
+		{
+			uint32_t index;
+			loader.read(index);
+			if (index >= _num_containers) {
+				inkFail("Snapshot container index out of range");
+				return;
+			}
+			visit_count& count = _visit_counts.write(index);
+			loader.read(count.visits);
+			loader.read(count.last_turn);
+		}
+
+		_lists.snap_load(loader);
+		_variables.snap_load(loader);
+
+		// everything loaded is unchanged relative to the loaded snapshot
+		_variables_changed.clear();
+		_first_checkpoint = loader.snapshot_id();
+		_checkpoint = _first_checkpoint + 1;
+		_lists.set_checkpoint(_checkpoint);
+
+		// variables are restored, don't run the global declarations again
+		_globals_initialized = true;
+	}
+
+	void globals_impl::snap_changed(snapper& snapper, uint32_t since) const
+	{
+		snapper.write(_num_containers);
+		snapper.write(_turn_count);
+
+		uint32_t num_changed = 0;
+		for (size_t i = 0; i < _visit_counts.size(); ++i)
+			if (_visit_counts[i].changed > since)
+				++num_changed;
+		snapper.write(num_changed);
+		for (size_t i = 0; i < _visit_counts.size(); ++i)
+		{
+			if (_visit_counts[i].changed > since)
+			{
+				snapper.write(static_cast<uint32_t>(i));
+				snapper.write(_visit_counts[i].visits);
+				snapper.write(_visit_counts[i].last_turn);
+			}
+		}
+
+		_lists.snap_changed(snapper, since);
+		_variables.snap_changed(snapper, [this, since](size_t i) {
+			return i < _variables_changed.size() && _variables_changed[i] > since;
+		});
+	}
+
+	void globals_impl::snap_load_changed(loader& loader)
+	{
+		uint32_t num_containers;
+		loader.read(num_containers);
+		if (num_containers != _num_containers) {
+			inkFail("Snapshot has a different number of containers than the story");
+			return;
+		}
+		loader.read(_turn_count);
+
+		uint32_t num_changed;
+		loader.read(num_changed);
+		for (uint32_t i = 0; i < num_changed; ++i)
+		{
+			uint32_t index;
+			loader.read(index);
+			if (index >= _num_containers) {
+				inkFail("Snapshot container index out of range");
+				return;
+			}
+			visit_count& count = _visit_counts.write(index);
+			loader.read(count.visits);
+			loader.read(count.last_turn);
+		}
+
+		_lists.snap_load_changed(loader);
+		_variables.snap_load_changed(loader);
+
+		_first_checkpoint = loader.snapshot_id();
+		_checkpoint = _first_checkpoint + 1;
+		_lists.set_checkpoint(_checkpoint);
+	}
+
+	void globals_impl::snap_fork(snapper& snapper) const
+	{
+		_lists.snap(snapper);
+		_variables.snap(snapper);
+	}
+
+	void globals_impl::fork_load(const globals_impl& parent, loader& loader)
+	{
+		_visit_counts.share(parent._visit_counts);
+		_turn_count = parent._turn_count;
+		_lists.snap_load(loader);
+		_variables.snap_load(loader);
+
+		// the fork starts a new line of snapshots, with its current state as base
+		_variables_changed.clear();
+		_first_checkpoint = parent._checkpoint;
+		_checkpoint = _first_checkpoint + 1;
+		_lists.set_checkpoint(_checkpoint);
+		_globals_initialized = true;
+	}
 }
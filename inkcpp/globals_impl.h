@@ -3,21 +3,27 @@
 #include "system.h"
 #include "array.h"
 #include "globals.h"
+#include "capacities.h"
 #include "string_table.h"
 #include "list_table.h"
 #include "stack.h"
 
+#include <atomic>
+
 namespace ink::runtime::internal
 {
 	class story_impl;
 	class runner_impl;
+	class snapper;
+	class loader;
+	class journal_writer;
 
 	// Implementation of the global store
-	class globals_impl : public globals_interface
+	class globals_impl : public globals_interface, public heap_object<alloc_category::story>
 	{
 	public:
 		// Initializes a new global store from the given story
-		globals_impl(const story_impl*);
+		globals_impl(const story_impl*, const capacities&);
 		virtual ~globals_impl() { }
 
 	protected:
@@ -34,11 +40,25 @@ namespace ink::runtime::internal
 		bool set_str(hash_t name, const char* value) override;
 
 	public:
+		// Creates a snapshot of this store and all runners using it
+		virtual snapshot* create_snapshot() const override;
+
+		// Creates a snapshot with only the globals changed since the given one
+		virtual snapshot* delta_since(uint32_t snapshot_id) const override;
+
+#ifdef INK_ENABLE_PROFILE
+		// Sums the profiles of all runners which used this store
+		virtual profile get_profile() const override;
+#endif
+
+		// Returns to the start of the story, keeping allocated memory
+		virtual void reset() override;
+
 		// Records a visit to a container
 		void visit(uint32_t container_id);
 
 		// Checks the number of visits to a container
-		uint32_t visits(uint32_t container_id) const;
+		virtual uint32_t visits(uint32_t container_id) const override final;
 
 		// Returnn number of turns since container was last visited
 		// \retval -1 if container was never visited before
@@ -61,11 +81,18 @@ namespace ink::runtime::internal
 		// checks if globals are initialized
 		bool are_globals_initialized() const { return _globals_initialized; }
 
+		// Capacities this store was created with
+		const capacities& get_capacities() const { return _capacities; }
+
 		// initializes globals using a runner
 		void initialize_globals(runner_impl*);
 
 		// gets the allocated string table
 		inline string_table& strings() { return _strings; }
+		inline const string_table& strings() const { return _strings; }
+
+		// gets the story this store belongs to
+		inline const story_impl& story() const { return *_owner; }
 
 		// gets list entries
 		list_table& lists() { return _lists; }
@@ -73,41 +100,99 @@ namespace ink::runtime::internal
 		// run garbage collection
 		void gc();
 
+		// Journal which records the variables set by the host, if any
+		journal_writer* journal() const { return _journal; }
+		void set_journal(journal_writer* journal) { _journal = journal; }
+		// Sets a variable as recorded in a journal
+		bool set_recorded(hash_t name, const value&);
+
 		// == Save/Restore ==
 		void save();
 		void restore();
 		void forget();
 
+		// == Snapshots ==
+		void snap(snapper&) const;
+		void snap_load(loader&);
+
+		// Only writes globals changed after the given snapshot
+		void snap_changed(snapper&, uint32_t since) const;
+		// Applies a delta on top of the current state
+		void snap_load_changed(loader&);
+
+		// Returns the id for a new snapshot. Later changes are recorded for the next one
+		uint32_t next_snapshot_id() const;
+
+		// == Forking ==
+		// Writes the state a fork copies. Visit counts are shared instead
+		void snap_fork(snapper&) const;
+		// Sets up this (new) store as a fork of parent
+		void fork_load(const globals_impl& parent, loader&);
+
 	private:
+		// Sets the variables to their initial values, if the story has them
+		void define_globals();
+
+		// Gets a variable to modify it in place
+		value* modify_variable(hash_t name);
+
+		// Marks a variable entry as changed
+		void variable_changed(size_t index);
+
+		// Collects runners using this store in creation order
+		template<typename Callback>
+		snapshot* with_runners(Callback) const;
+
 		// Store the number of containers. This is the length of most of our lists
 		const uint32_t _num_containers;
 
 		// Visit count array
 		struct visit_count {
 			uint32_t visits = 0;
-			int32_t turns = -1;
+			int32_t last_turn = -1;
+			uint32_t changed = 0;
 			bool operator==(const visit_count& vc) const {
-				return visits == vc.visits && turns == vc.turns;
+				return visits == vc.visits && last_turn == vc.last_turn;
 			}
 			bool operator!=(const visit_count& vc) const {
 				return !(*this == vc);
 			}
 		};
+		// Stored in pages, which forked stores share copy-on-write
 		class visit_counts{
-			visit_count* _data;
+			static constexpr size_t PageSize = 64;
+			struct page : heap_object<alloc_category::registry> {
+				std::atomic<uint32_t> references{1};
+				visit_count data[PageSize];
+			};
+			page** _pages;
 			size_t _len;
+			allocator* _alloc;
+			size_t num_pages() const { return (_len + PageSize - 1) / PageSize; }
+			static void release(page*);
 		public:
-			visit_counts(size_t len) 
-			: _data{new visit_count[len]}, _len{len} {}
+			visit_counts(size_t len);
+			~visit_counts();
+			visit_counts(const visit_counts&) = delete;
+			visit_counts& operator=(const visit_counts&) = delete;
 			size_t size() const { return _len; }
-			visit_count& operator[](size_t i) { return _data[i]; }
-			const visit_count& operator[](size_t i) const { return _data[i]; }
+			const visit_count& operator[](size_t i) const { return _pages[i / PageSize]->data[i % PageSize]; }
+			// gets an entry for writing, copying its page first if it is shared
+			visit_count& write(size_t i);
+			// drops our pages and shares the ones of other instead
+			void share(const visit_counts& other);
+			// sets all counts to unvisited, reusing pages we own alone
+			void clear();
 		} _visit_counts;
 
+		// Number of turns taken. Visits store the turn they happened in,
+		//  so a turn does not touch every container
+		int32_t _turn_count = 0;
+
 		// Pointer back to owner story.
 		const story_impl* const _owner;
 
-		struct runner_entry
+		struct runner_entry : heap_object<alloc_category::registry>
 		{
 			const runner_impl* object;
 			runner_entry* next = nullptr;
@@ -117,13 +202,33 @@ namespace ink::runtime::internal
 		//  Used for garbage collection of the global string table.
 		runner_entry* _runners_start;
 
+		// Memory source of this store
+		allocator* _alloc = current_allocator();
+
+		// records host changes for a recording runner
+		journal_writer* _journal = nullptr;
+
+#ifdef INK_ENABLE_PROFILE
+		// Profiles of runners which are gone
+		profile _retired_profile;
+#endif
+
 		// Allocated string table (shared by all runners using this global store)
 		mutable string_table _strings;
 		mutable list_table _lists;
 
 		//  Implemented as a stack (slow lookup) because it has save/restore functionality.
 		//  If I could create an avl tree with save/restore, that'd be great but seems super complex.
+		const capacities _capacities;
 		internal::stack<abs(config::limitGlobalVariables), config::limitGlobalVariables < 0> _variables;
 		bool _globals_initialized;
+
+		// == Change tracking ==
+		// Every change is marked with the id of the next snapshot. A delta since
+		//  a snapshot contains everything marked with a higher id.
+		mutable uint32_t _checkpoint = 1;
+		// First snapshot we know all changes since (the one we are loaded from)
+		uint32_t _first_checkpoint = 0;
+		managed_array<uint32_t, config::limitGlobalVariables < 0, abs(config::limitGlobalVariables)> _variables_changed;
 	};
 }
@@ -27,12 +27,23 @@ namespace ink::internal {
 			res.ink_bin_version_number =
 				swap_bytes(*reinterpret_cast<const vcpp_t*>(ptr));
 		} else {
-			throw ink_exception("Failed to parse endian encoding!");
+			inkFail("Failed to parse endian encoding!");
 		}
 
 		if (res.ink_bin_version_number != InkBinVersion) {
-			throw ink_exception("InkCpp-version mismatch: file was compiled with different InkCpp-version!");
+			inkFail("InkCpp-version mismatch: file was compiled with different InkCpp-version!");
 		}
+
+		// Buffer bounds follow the version
+		ptr += sizeof(vcpp_t);
+		auto read_u32 = [&res](const char*& at) {
+			uint32_t value = *reinterpret_cast<const uint32_t*>(at);
+			at += sizeof(uint32_t);
+			return res.endien == header::endian_types::differ ? swap_bytes(value) : value;
+		};
+		res.bounds_flags = read_u32(ptr);
+		for (size_t i = 0; i < NumBounds; ++i)
+			res.bounds[i] = read_u32(ptr);
 		return res;
 	}
 }
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "system.h"
+
+#include <cstddef>
+#include <new>
+
+namespace ink::runtime
+{
+	/**
+	 * Kinds of memory the runtime allocates. Allocations are counted per
+	 * category, see get_allocation_stats().
+	 */
+	enum class alloc_category : unsigned char
+	{
+		strings,   ///< dynamic strings: string table blocks
+		stacks,    ///< eval, call and container stacks, output and tags
+		lists,     ///< list table storage
+		choices,   ///< choice arrays
+		registry,  ///< bound functions, runner list, visit counts, initial globals
+		story,     ///< story, globals and runner objects
+		snapshots, ///< buffers of snapshots and forks being written
+		NUM_CATEGORIES
+	};
+
+	/**
+	 * Interface to the memory source of the runtime.
+	 *
+	 * All runtime allocations go through the installed allocator. It may be
+	 * replaced with set_allocator() before any story is loaded.
+	 */
+	class allocator
+	{
+	public:
+		virtual ~allocator() { }
+
+		/**
+		 * Allocates a block of memory
+		 *
+		 * @param size number of bytes
+		 * @param alignment required alignment, at most alignof(std::max_align_t)
+		 * @param category what the memory is used for
+		 * @return the block. Must not return nullptr
+		 */
+		virtual void* allocate(std::size_t size, std::size_t alignment, alloc_category category) = 0;
+
+		/**
+		 * Frees a block returned by allocate
+		 *
+		 * @param ptr block to free
+		 * @param size size it was allocated with
+		 * @param category category it was allocated with
+		 */
+		virtual void deallocate(void* ptr, std::size_t size, alloc_category category) = 0;
+	};
+
+	/**
+	 * Installs an allocator for the runtime
+	 *
+	 * Must not be changed while blocks of the previous allocator are alive,
+	 * so set it before loading any story.
+	 *
+	 * @param alloc allocator to use. nullptr restores the default heap allocator
+	 */
+	void set_allocator(allocator* alloc);
+
+	/** Returns the allocator in use */
+	allocator* get_allocator();
+
+	/// Allocation counters of one category
+	struct allocation_stats
+	{
+		std::size_t allocations;   ///< number of allocations
+		std::size_t deallocations; ///< number of deallocations
+		std::size_t bytes;         ///< bytes currently allocated
+		std::size_t peak_bytes;    ///< highest value of bytes
+	};
+
+	/** Returns the counters of a category since the last reset */
+	allocation_stats get_allocation_stats(alloc_category category);
+
+	/** Sums the counters of all categories */
+	allocation_stats get_allocation_stats();
+
+	/** Resets the allocation and deallocation counters. Peaks restart at the current usage */
+	void reset_allocation_stats();
+
+	/**
+	 * Forbids runtime allocations on the current thread while alive.
+	 *
+	 * Any allocation attempted throws an ink_exception instead. Without
+	 * exceptions it fails the current runner call, or aborts outside of
+	 * one. Wrap the
+	 * frame loop in a guard to verify that a story in steady state does not
+	 * touch the heap. Guards can be nested.
+	 */
+	class heap_guard
+	{
+	public:
+		heap_guard();
+		~heap_guard();
+
+		heap_guard(const heap_guard&) = delete;
+		heap_guard& operator=(const heap_guard&) = delete;
+	};
+
+	/**
+	 * Bump allocator for one session.
+	 *
+	 * Hands out memory from a chain of blocks and ignores deallocations, so
+	 * a runner, its globals, string table and list table can live in one
+	 * contiguous region which is freed in one step. Pass it to
+	 * story::new_globals() and story::new_runner(). It must outlive every
+	 * object created with it, and is not thread safe.
+	 */
+	class arena_allocator : public allocator
+	{
+	public:
+		/**
+		 * @param block_size size of the blocks requested from the heap.
+		 *                   Larger allocations get a block of their own
+		 */
+		arena_allocator(std::size_t block_size = 64 * 1024);
+		virtual ~arena_allocator();
+
+		arena_allocator(const arena_allocator&) = delete;
+		arena_allocator& operator=(const arena_allocator&) = delete;
+
+		virtual void* allocate(std::size_t size, std::size_t alignment, alloc_category category) override;
+		virtual void deallocate(void* /*ptr*/, std::size_t /*size*/, alloc_category /*category*/) override { }
+
+		/** Frees all memory but the first block, which is reused */
+		void reset();
+
+		/** Bytes handed out since construction or the last reset */
+		std::size_t used() const { return _used; }
+
+		/** Bytes held in blocks */
+		std::size_t reserved() const { return _reserved; }
+
+	private:
+		struct block
+		{
+			block* next;
+			std::size_t size;
+		};
+		void add_block(std::size_t min_size);
+
+		block* _blocks;
+		unsigned char* _ptr;
+		unsigned char* _end;
+		std::size_t _block_size;
+		std::size_t _used;
+		std::size_t _reserved;
+	};
+
+	namespace internal
+	{
+		// Allocator new objects take their memory from: the one of the
+		//  innermost allocator_scope on this thread, or the installed one
+		allocator* current_allocator();
+
+		// Makes current_allocator() return the given allocator while alive.
+		//  nullptr keeps the current one
+		class allocator_scope
+		{
+		public:
+			allocator_scope(allocator* alloc);
+			~allocator_scope();
+
+			allocator_scope(const allocator_scope&) = delete;
+			allocator_scope& operator=(const allocator_scope&) = delete;
+
+		private:
+			allocator* _previous;
+		};
+
+		// Allocates through the given allocator and counts it
+		void* allocate(allocator* alloc, alloc_category category, std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+		void deallocate(allocator* alloc, alloc_category category, void* ptr, std::size_t size);
+
+		// Allocates and default constructs an array
+		template<typename T>
+		T* new_array(allocator* alloc, alloc_category category, std::size_t count)
+		{
+			T* data = static_cast<T*>(allocate(alloc, category, sizeof(T) * count, alignof(T)));
+			for (std::size_t i = 0; i < count; ++i)
+				new(data + i) T();
+			return data;
+		}
+
+		// Destroys and frees an array from new_array
+		template<typename T>
+		void delete_array(allocator* alloc, alloc_category category, T* data, std::size_t count)
+		{
+			if (data == nullptr)
+				return;
+			for (std::size_t i = 0; i < count; ++i)
+				data[i].~T();
+			deallocate(alloc, category, data, sizeof(T) * count);
+		}
+
+		// Objects remember the allocator they came from in a header
+		void* allocate_object(alloc_category category, std::size_t size);
+		void deallocate_object(alloc_category category, void* ptr, std::size_t size);
+
+		// Base for classes created with new, routes them through current_allocator()
+		template<alloc_category Category>
+		struct heap_object
+		{
+			static void* operator new(std::size_t size) { return allocate_object(Category, size); }
+			static void operator delete(void* ptr, std::size_t size) { deallocate_object(Category, ptr, size); }
+		};
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "system.h"
+
+namespace ink::runtime
+{
+	/**
+	 * Capacities of the buffers of a runner or global store.
+	 *
+	 * Passed to story::new_runner() and story::new_globals(), so small
+	 * stories get lean runners while big ones get room to grow, without
+	 * recompiling. Buffers configured as dynamic in config.h (negative
+	 * limit) start with the given capacity and grow on demand. Buffers
+	 * configured as fixed keep their inline storage and never allocate;
+	 * for them a capacity is an upper limit and must not exceed the
+	 * compiled-in size. A value of 0 uses the default of the story.
+	 */
+	struct capacities
+	{
+		size_t runtime_stack = 0;    ///< temporary variables and callstack (limitRuntimeStack)
+		size_t reference_stack = 0;  ///< references (limitReferenceStack)
+		size_t eval_stack = 0;       ///< evaluation stack (limitEvalStackDepth)
+		size_t container_depth = 0;  ///< nesting of containers (limitContainerDepth)
+		size_t thread_depth = 0;     ///< nesting of threads (limitThreadDepth)
+		size_t choices = 0;          ///< simultaneous choices (maxChoices)
+		size_t tags = 0;             ///< simultaneous tags (limitActiveTags)
+		size_t global_variables = 0; ///< global variables (limitGlobalVariables)
+	};
+}
@@ -39,20 +39,59 @@ namespace ink
 			 * Choice text
 			 *
 			 * Text to display to the user for choosing this choice.
+			 * Choices made while the runner fast-forwards build their
+			 * text here, on the first call.
 			 *
 			 * @returns choice text as a string
 			 */
-			const char* text() const { return _text; }
+			const char* text() const;
+
+			/**
+			 * Checks if the choice has tags
+			 *
+			 * @returns true if tags are written in the text of the choice
+			 */
+			bool has_tags() const { return _tags_end != _tags_begin; }
+
+			/**
+			 * Number of tags of the choice
+			 *
+			 * @returns number of tags in the text of the choice
+			 */
+			size_t num_tags() const { return _tags_end - _tags_begin; }
+
+			/**
+			 * Tag of the choice
+			 *
+			 * Tags point into the story and stay valid as long as it is loaded.
+			 *
+			 * @param index tag id to fetch [0;num_tags())
+			 * @returns tag text
+			 */
+			const char* get_tag(size_t index) const;
 		private:
 			friend class internal::runner_impl;
 
 			uint32_t path() const { return _path; }
-			choice& setup(internal::basic_stream&, internal::string_table& strings, internal::list_table& lists, int index, uint32_t path, thread_t thread);
+			choice& setup(internal::basic_stream&, internal::string_table& strings, internal::list_table& lists, int index, uint32_t path, thread_t thread,
+				internal::runner_impl* runner, uint32_t tags_begin, uint32_t tags_end);
+			// keeps the parts of the text, text() joins them when needed
+			choice& setup_lazy(const char* part, const char* second_part, int index, uint32_t path, thread_t thread,
+				internal::runner_impl* runner, uint32_t tags_begin, uint32_t tags_end);
+			void setup_common(int index, uint32_t path, thread_t thread,
+				internal::runner_impl* runner, uint32_t tags_begin, uint32_t tags_end);
 		private:
-			const char* _text;
+			// nullptr until text() builds it from the parts
+			mutable const char* _text;
+			const char* _parts[2] = { nullptr, nullptr };
 			int _index;
 			uint32_t _path;
 			thread_t _thread;
+
+			// range of the tags in the choice tag list of the runner
+			internal::runner_impl* _runner = nullptr;
+			uint32_t _tags_begin = 0;
+			uint32_t _tags_end = 0;
 		};
 	}
 }
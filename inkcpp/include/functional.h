@@ -2,6 +2,7 @@
 
 #include "traits.h"
 #include "system.h"
+#include "allocator.h"
 
 namespace ink::runtime::internal
 {
@@ -9,7 +10,7 @@ namespace ink::runtime::internal
 	class string_table;
 
 	// base function container with virtual callback methods
-	class function_base
+	class function_base : public heap_object<alloc_category::registry>
 	{
 	public:
 		virtual ~function_base() { }
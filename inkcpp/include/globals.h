@@ -1,10 +1,12 @@
 #pragma once
 
 #include "system.h"
+#include "profile.h"
 
 namespace ink::runtime
 {
 	class globals_interface;
+	class snapshot;
 	namespace internal { class globals_impl;}
 
 	/**
@@ -42,6 +44,68 @@ namespace ink::runtime
 			return false;
 		}
 
+		/**
+		 * Creates a snapshot of the global store.
+		 *
+		 * Serializes the global store and all runners currently using it.
+		 * @see story::new_globals_from_snapshot
+		 * @see story::new_runner_from_snapshot
+		 *
+		 * @return new snapshot. The caller is responsible for deleting it
+		 */
+		virtual snapshot* create_snapshot() const = 0;
+
+		/**
+		 * Creates a delta snapshot.
+		 *
+		 * Like create_snapshot, but only the visit counts, variables and
+		 * lists changed since the given snapshot are written. Runners are
+		 * still written completely. Merge it onto that snapshot (or any
+		 * later full one) with story::apply_delta to load it.
+		 *
+		 * @param snapshot_id id of an earlier snapshot of this store
+		 * @return new snapshot. The caller is responsible for deleting it.
+		 *         nullptr if no changes are recorded since that snapshot
+		 *         and exceptions are disabled
+		 */
+		virtual snapshot* delta_since(uint32_t snapshot_id) const = 0;
+
+		/**
+		 * Returns the store to the start of the story.
+		 *
+		 * Clears visit and turn counts, lists and strings and sets the
+		 * variables to their initial values, keeping the allocated memory.
+		 * Use it with runner::reset to reuse a session instead of creating
+		 * a new one. If the global declarations of the story are not
+		 * constant, they run again in the next runner reset or created on
+		 * this store. Snapshots taken before can no longer be the base of
+		 * a delta.
+		 */
+		virtual void reset() = 0;
+
+		/**
+		 * Gets the number of visits to a container.
+		 *
+		 * Containers are knots, stitches and other blocks of content whose
+		 * visits ink counts.
+		 *
+		 * @param container_index index of the container, below story::num_containers()
+		 * @return number of times the container was visited
+		 */
+		virtual uint32_t visits(uint32_t container_index) const = 0;
+
+#ifdef INK_ENABLE_PROFILE
+		/**
+		 * Gets the execution statistics of all runners using this store.
+		 *
+		 * Includes runners which used the store and are destroyed by now.
+		 * Only available if inkcpp is built with INKCPP_PROFILE.
+		 *
+		 * @return summed counts and time spent per command
+		 */
+		virtual profile get_profile() const = 0;
+#endif
+
 		virtual ~globals_interface() = default;
 
 	protected:
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "system.h"
+#include "types.h"
+
+namespace ink::runtime
+{
+	/**
+	 * A recorded session of a runner.
+	 *
+	 * Contains what the host fed into a runner since it started
+	 * recording: the random seed, how far the story was read, the
+	 * chosen choices, the return values of external functions and
+	 * the global variables set from outside. Replaying it on a runner
+	 * in the same state as when the recording started reproduces the
+	 * session exactly, without the external functions being bound.
+	 *
+	 * A journal is append-only and much smaller than a snapshot, so
+	 * it can be kept for every session. Like a snapshot, it can only
+	 * be replayed with the story it was recorded from.
+	 *
+	 * @see runner_interface::start_journal
+	 * @see runner_interface::create_journal
+	 * @see runner_interface::replay
+	 */
+	class journal
+	{
+	public:
+		virtual ~journal() = default;
+
+		/**
+		 * Creates a journal from binary data.
+		 *
+		 * @param data journal data, as returned by get_data()
+		 * @param length length of data in bytes
+		 * @param freeOnDestroy if true, free this buffer once the journal is destroyed.
+		 *                      If loading fails the buffer stays with the caller
+		 * @param[out] result optional, whether the data is a valid journal
+		 * @return new journal object, nullptr if loading failed without exceptions
+		 */
+		static journal* from_binary(const unsigned char* data, size_t length, bool freeOnDestroy = true,
+			load_result* result = nullptr);
+
+#ifdef INK_ENABLE_STL
+		/**
+		 * Loads a journal from a file.
+		 *
+		 * @param filename file written with write_to_file()
+		 * @param[out] result optional, whether the file could be loaded
+		 * @return new journal object, nullptr if loading failed without exceptions
+		 */
+		static journal* from_file(const char* filename, load_result* result = nullptr);
+
+		/**
+		 * Writes the journal data into a file.
+		 *
+		 * @param filename file to (over)write
+		 * @return false if the file could not be written without exceptions
+		 */
+		bool write_to_file(const char* filename) const;
+#endif
+
+		/** @return pointer to the binary representation of the journal */
+		virtual const unsigned char* get_data() const = 0;
+
+		/** @return length of the binary representation in bytes */
+		virtual size_t get_data_len() const = 0;
+	};
+}
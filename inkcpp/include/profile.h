@@ -0,0 +1,77 @@
+#pragma once
+
+#include "system.h"
+
+#ifdef INK_ENABLE_STL
+#include <iosfwd>
+#endif
+
+namespace ink::runtime
+{
+	/**
+	 * Execution statistics of the ink virtual machine.
+	 *
+	 * Counts how often each command was executed and how much time
+	 * was spent executing it, operators included. Only recorded if
+	 * inkcpp is built with the CMake option INKCPP_PROFILE, which
+	 * defines INK_ENABLE_PROFILE. Without it, no instrumentation is
+	 * compiled into the runtime.
+	 *
+	 * @see runner_interface::get_profile
+	 * @see globals_interface::get_profile
+	 */
+	class profile
+	{
+	public:
+		profile() { reset(); }
+
+		/** @return number of commands, the upper bound of command indices */
+		static size_t num_commands();
+
+		/** @return name of the command with the given index */
+		static const char* name(size_t command);
+
+		/** @return number of times the command was executed */
+		uint64_t count(size_t command) const { return _count[command]; }
+
+		/** @return nanoseconds spent executing the command */
+		uint64_t nanoseconds(size_t command) const { return _nanoseconds[command]; }
+
+		/** @return number of commands executed */
+		uint64_t total_count() const;
+
+		/** @return nanoseconds spent executing commands */
+		uint64_t total_nanoseconds() const;
+
+		/** Adds the counters of another profile to this one */
+		void merge(const profile& other);
+
+		/** Sets all counters to zero */
+		void reset();
+
+#ifdef INK_ENABLE_STL
+		/**
+		 * Writes a histogram of the executed commands.
+		 *
+		 * One line per executed command, sorted by time spent, with
+		 * execution count, total and average time.
+		 *
+		 * @param out stream to write to
+		 */
+		void dump(std::ostream& out) const;
+#endif
+
+		// records one execution. internal use only
+		void record(size_t command, uint64_t nanoseconds)
+		{
+			_count[command] += 1;
+			_nanoseconds[command] += nanoseconds;
+		}
+
+	private:
+		static constexpr size_t MaxCommands = 256;
+
+		uint64_t _count[MaxCommands];
+		uint64_t _nanoseconds[MaxCommands];
+	};
+}
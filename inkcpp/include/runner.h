@@ -3,6 +3,8 @@
 #include "config.h"
 #include "system.h"
 #include "functional.h"
+#include "types.h"
+#include "profile.h"
 
 #ifdef INK_ENABLE_UNREAL
 #include "Containers/UnrealString.h"
@@ -11,6 +13,15 @@
 namespace ink::runtime
 {
 	class choice;
+	class snapshot;
+	class journal;
+
+	/** Outcome of the last line or choice of a runner, see runner_interface::last_result */
+	enum class run_result
+	{
+		ok,    ///< the call completed
+		error, ///< the call failed, the runner was reset and can not continue
+	};
 
 	/**
 	 * A runner to execute ink script from a story.
@@ -147,6 +158,170 @@ namespace ink::runtime
 		*/
 		virtual void choose(size_t index) = 0;
 
+		/**
+		 * Creates a snapshot of the runner.
+		 *
+		 * Serializes the runner together with its globals store, so
+		 * the runner can later be recreated with
+		 * story::new_runner_from_snapshot.
+		 *
+		 * @return new snapshot. The caller is responsible for deleting it
+		 */
+		virtual snapshot* create_snapshot() const = 0;
+
+		/**
+		 * Forks the runner.
+		 *
+		 * Creates a new runner with its own global store, which continues
+		 * independently from the current state of this runner. Useful to
+		 * look ahead at the outcome of a choice.
+		 *
+		 * Only the visit counts, which grow with the story, are shared
+		 * copy-on-write with this runner's store. Variables, lists, the
+		 * stacks, choices, output and dynamic strings are copied, so a fork
+		 * costs about as much as writing and loading a snapshot without the
+		 * visit counts. The first visit into a shared page of visit counts
+		 * copies that page, so a forked runner may allocate while it plays.
+		 * External functions are not copied and must be bound again.
+		 *
+		 * @return managed pointer to the new runner
+		 */
+		virtual runner fork() = 0;
+
+		/**
+		 * Returns the runner to the start of the story.
+		 *
+		 * Clears the callstack, threads, choices, tags and output, keeping
+		 * the allocated memory, so a pooled runner can start a new session
+		 * without being created again. Bound external functions stay bound.
+		 * The global store is not reset; call globals::reset for that.
+		 */
+		virtual void reset() = 0;
+
+		/**
+		 * Starts recording a journal of this runner.
+		 *
+		 * From now on the random state, how far the story is read, the
+		 * choices, the return values of external functions and the
+		 * global variables set by the host are recorded, so the session
+		 * can later be reproduced with replay. Start right after creating
+		 * the runner and its globals, or after loading a snapshot, and
+		 * replay onto the same state. A journal that was already being
+		 * recorded is dropped.
+		 *
+		 * @see journal
+		 */
+		virtual void start_journal() = 0;
+
+		/** Stops recording and drops the journal */
+		virtual void stop_journal() = 0;
+
+		/**
+		 * Copies the journal recorded so far.
+		 *
+		 * Recording continues, later journals contain this one.
+		 *
+		 * @return new journal, nullptr if not recording. The caller is responsible for deleting it
+		 */
+		virtual journal* create_journal() const = 0;
+
+		/**
+		 * Replays a journal.
+		 *
+		 * Reads the story, chooses and sets globals as recorded, with
+		 * external functions returning the recorded values, so the
+		 * runner ends up in the state the recording runner had when the
+		 * journal was created. Text is skipped as with set_fast_forward.
+		 * If the runner is recording, the replay is recorded too.
+		 *
+		 * @param log journal recorded from the same story and state
+		 */
+		virtual void replay(const journal& log) = 0;
+
+		/**
+		 * Skips the text of the story while advancing.
+		 *
+		 * While enabled, getline and getall only run the control flow
+		 * and return empty text. The output is dropped without being
+		 * converted to text, lists are not printed and choice texts are
+		 * built on the first call of choice::text. Tags, variables and
+		 * visit counts change as usual. Useful to replay the choices of
+		 * a recorded session quickly.
+		 *
+		 * @param enable whether to skip the text
+		 */
+		virtual void set_fast_forward(bool enable) = 0;
+
+		/** Whether the runner skips text, see set_fast_forward */
+		virtual bool is_fast_forward() const = 0;
+
+		/**
+		 * Outcome of the last call which advanced the story.
+		 *
+		 * Calls to getline, getall and choose update it. A failing call
+		 * clears the runner's callstack, choices and output, so it can not
+		 * continue until it is moved or reset. If inkcpp is built with
+		 * exceptions the error is thrown after the state is cleared, else
+		 * (INK_DISABLE_EXCEPTIONS) the call returns early and the error is
+		 * only reported here.
+		 *
+		 * @see last_error
+		 * @return run_result::error if the last call failed
+		 */
+		virtual run_result last_result() const = 0;
+
+		/**
+		 * Describes the error of the last call which advanced the story.
+		 *
+		 * @see last_result
+		 * @return message of the error without exceptions, else nullptr
+		 */
+		virtual const char* last_error() const = 0;
+
+		/**
+		 * Gets the global store this runner uses.
+		 *
+		 * @return managed pointer to the global store
+		 */
+		virtual globals get_globals() = 0;
+
+		/**
+		 * Gets the allocator this runner takes its memory from.
+		 *
+		 * @see story::new_runner
+		 * @return the allocator passed at creation, or the one installed then
+		 */
+		virtual allocator* get_allocator() const = 0;
+
+#ifdef INK_ENABLE_PROFILE
+		/**
+		 * Gets the execution statistics of this runner.
+		 *
+		 * Only available if inkcpp is built with INKCPP_PROFILE.
+		 *
+		 * @return counts and time spent per command since creation or the last reset
+		 */
+		virtual const profile& get_profile() const = 0;
+
+		/** Sets the execution statistics of this runner to zero */
+		virtual void reset_profile() = 0;
+
+#ifdef INK_ENABLE_STL
+		/**
+		 * Writes where this runner spent its time, in folded stack format.
+		 *
+		 * One line per stack of containers (knots, stitches, ...) with the
+		 * nanoseconds spent in its top container. Tunnels and functions
+		 * appear as nested frames of the container they were called from.
+		 * The output can be fed to flamegraph.pl and compatible tools.
+		 *
+		 * @param out stream to write to
+		 * @param count_commands write the number of executed commands instead of time
+		 */
+		virtual void write_folded_stacks(std::ostream& out, bool count_commands = false) const = 0;
+#endif
+#endif
+
 		virtual bool has_tags() const = 0;
 		virtual size_t num_tags() const = 0;
 		virtual const char* get_tag(size_t index) const = 0;
@@ -167,6 +342,7 @@ namespace ink::runtime
 		template<typename F>
 		inline void bind(hash_t name, F function)
 		{
+			internal::allocator_scope scope(get_allocator());
 			internal_bind(name, new internal::function(function));
 		}
 
@@ -189,6 +365,7 @@ namespace ink::runtime
 		template<typename D>
 		void bind_delegate(hash_t name, D functionDelegate)
 		{
+			internal::allocator_scope scope(get_allocator());
 			internal_bind(name, new internal::function_array_delegate(functionDelegate));
 		}
 #endif
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "system.h"
+#include "types.h"
+
+namespace ink::runtime
+{
+	/**
+	 * A serialized runtime state.
+	 *
+	 * Contains the state of a global store (variables, visit counts,
+	 * lists and dynamic strings) and of the runners which use it
+	 * (instruction pointer, callstack, evaluation stack, threads, choices,
+	 * tags, pending output and random state) in a compact, versioned
+	 * binary blob. A snapshot can only be loaded by the story it was
+	 * created from.
+	 *
+	 * External functions bound to a runner are not part of the snapshot
+	 * and must be bound again after loading.
+	 *
+	 * Snapshots of a global store are numbered. A delta snapshot
+	 * (see globals_interface::delta_since) only contains the globals
+	 * changed since an earlier snapshot and must be merged onto it with
+	 * story::apply_delta before it can be loaded.
+	 *
+	 * @see globals_interface::create_snapshot
+	 * @see runner_interface::create_snapshot
+	 * @see story::new_globals_from_snapshot
+	 * @see story::new_runner_from_snapshot
+	 */
+	class snapshot
+	{
+	public:
+		virtual ~snapshot() = default;
+
+		/**
+		 * Creates a snapshot from binary data.
+		 *
+		 * @param data snapshot data, as returned by get_data()
+		 * @param length length of data in bytes
+		 * @param freeOnDestroy if true, free this buffer once the snapshot is destroyed.
+		 *                      If loading fails the buffer stays with the caller
+		 * @param[out] result optional, whether the data is a valid snapshot
+		 * @return new snapshot object, nullptr if loading failed without exceptions
+		 */
+		static snapshot* from_binary(const unsigned char* data, size_t length, bool freeOnDestroy = true,
+			load_result* result = nullptr);
+
+#ifdef INK_ENABLE_STL
+		/**
+		 * Loads a snapshot from a file.
+		 *
+		 * @param filename file written with write_to_file()
+		 * @param[out] result optional, whether the file could be loaded
+		 * @return new snapshot object, nullptr if loading failed without exceptions
+		 */
+		static snapshot* from_file(const char* filename, load_result* result = nullptr);
+
+		/**
+		 * Writes the snapshot data into a file.
+		 *
+		 * @param filename file to (over)write
+		 * @return false if the file could not be written without exceptions
+		 */
+		bool write_to_file(const char* filename) const;
+#endif
+
+		/** @return pointer to the binary representation of the snapshot */
+		virtual const unsigned char* get_data() const = 0;
+
+		/** @return length of the binary representation in bytes */
+		virtual size_t get_data_len() const = 0;
+
+		/** @return number of runners stored in this snapshot */
+		virtual size_t num_runners() const = 0;
+
+		/** @return id of this snapshot, unique for the global store it was taken from */
+		virtual uint32_t id() const = 0;
+
+		/** @return true if this snapshot only contains changes since another one */
+		virtual bool is_delta() const = 0;
+
+		/**
+		 * Hashes the stored state.
+		 *
+		 * Snapshots of equal states have equal hashes, independent of
+		 * their ids. Useful to detect states reached more than once.
+		 *
+		 * @return 64 bit hash of the snapshot data
+		 */
+		virtual uint64_t state_hash() const = 0;
+	};
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "types.h"
+#include "capacities.h"
 
 namespace ink::runtime
 {
@@ -13,12 +14,19 @@ namespace ink::runtime
 	 * share globals (variables, visit counts, etc). through the
 	 * globals object. By default, each runner gets its own newly
 	 * created globals store.
+	 *
+	 * A story is never modified after it has been loaded, so a single
+	 * story may be shared by runners and globals living on different
+	 * threads. Each runner and globals object must itself only be used
+	 * by one thread at a time, and the story must outlive all of them.
 	 * @see runner_interface
 	 * @see globals
 	*/
 	class story
 	{
 	public:
+		virtual ~story() = default;
+
 #pragma region Interface Methods
 		/**
 		 * Creates a new global store
@@ -27,9 +35,12 @@ namespace ink::runtime
 		 * creating new runners for this story. Note: Can not be
 		 * used for other stories. It is tied to this story.
 		 *
+		 * @param alloc allocator for all memory of the store, its string
+		 *              and list tables. nullptr uses the installed allocator
+		 * @param caps capacities of the store's buffers. nullptr uses the story's defaults
 		 * @return managed pointer to a new global store
 		*/
-		virtual globals new_globals() = 0;
+		virtual globals new_globals(allocator* alloc = nullptr, const capacities* caps = nullptr) = 0;
 
 		/**
 		 * Creates a new runner
@@ -38,9 +49,83 @@ namespace ink::runtime
 		 * is the first instruction in this story. If no global
 		 * store is passed, a new one will be created for the runner.
 		 *
+		 * @param store global store the runner should use
+		 * @param alloc allocator for all memory of the runner, and of the
+		 *              store if one is created. nullptr uses the installed allocator
+		 * @param caps capacities of the runner's buffers, and of the store if one
+		 *             is created. nullptr uses the story's defaults
 		 * @return managed pointer to a new runner
 		*/
-		virtual runner new_runner(globals store = nullptr) = 0;
+		virtual runner new_runner(globals store = nullptr, allocator* alloc = nullptr, const capacities* caps = nullptr) = 0;
+
+		/**
+		 * Creates a new global store from a snapshot
+		 *
+		 * Recreates the global store (variables, visit counts, lists
+		 * and strings) saved in the snapshot.
+		 *
+		 * @param snapshot snapshot created from this story
+		 * @param alloc allocator for the store, nullptr uses the installed allocator
+		 * @param[out] result optional, whether the snapshot could be loaded
+		 * @return managed pointer to a new global store, nullptr if loading failed
+		 *         without exceptions
+		*/
+		virtual globals new_globals_from_snapshot(const snapshot&, allocator* alloc = nullptr,
+			load_result* result = nullptr) = 0;
+
+		/**
+		 * Creates a new runner from a snapshot
+		 *
+		 * Recreates a runner saved in the snapshot. If no global store
+		 * is passed, a new one is created from the snapshot as well.
+		 * A passed store should be created from the same snapshot.
+		 *
+		 * @param snapshot snapshot created from this story
+		 * @param store global store the runner should use
+		 * @param runner_id index of the runner in the snapshot
+		 * @param alloc allocator for the runner, nullptr uses the installed allocator
+		 * @param[out] result optional, whether the snapshot could be loaded
+		 * @return managed pointer to a new runner, nullptr if loading failed
+		 *         without exceptions
+		*/
+		virtual runner new_runner_from_snapshot(const snapshot&, globals store = nullptr, size_t runner_id = 0,
+			allocator* alloc = nullptr, load_result* result = nullptr) = 0;
+
+		/**
+		 * Applies a delta snapshot onto its base
+		 *
+		 * @param base full snapshot, taken at or after the snapshot the delta is based on
+		 * @param delta delta snapshot, taken from the same global store after base
+		 * @param[out] result optional, whether the snapshots could be merged
+		 * @return new full snapshot, equivalent to the state the delta was taken at.
+		 *         The caller is responsible for deleting it. nullptr if merging
+		 *         failed without exceptions
+		*/
+		virtual snapshot* apply_delta(const snapshot& base, const snapshot& delta,
+			load_result* result = nullptr) = 0;
+
+		/**
+		 * Number of containers in the story
+		 *
+		 * @see globals_interface::visits
+		 * @return number of containers whose visits are counted
+		*/
+		virtual uint32_t num_containers() const = 0;
+
+		/**
+		 * Buffer sizes the story needs at most
+		 *
+		 * Computed by the compiler from the call graph of tunnels, functions
+		 * and threads. Runners created without explicit capacities size
+		 * their dynamic buffers from these bounds once, so they neither
+		 * grow during play nor reserve the generic configured limits.
+		 *
+		 * @param[out] caps bounds of the story. Fields which depend on
+		 *                  recursion or on a loop without a choice are 0
+		 * @return false if the story is unbounded because a tunnel,
+		 *         function or thread calls itself
+		*/
+		virtual bool static_bounds(capacities& caps) const = 0;
 #pragma endregion
 
 #pragma region Factory Methods
@@ -52,9 +137,10 @@ namespace ink::runtime
 		 * necessary to load the file and close it.
 		 *
 		 * @param filename filename of the binary ink data
-		 * @return new story object
+		 * @param[out] result optional, whether the story could be loaded
+		 * @return new story object, nullptr if loading failed without exceptions
 		*/
-		static story* from_file(const char* filename);
+		static story* from_file(const char* filename, load_result* result = nullptr);
 
 		/**
 		 * Create a new story object from binary buffer
@@ -65,10 +151,13 @@ namespace ink::runtime
 		 *
 		 * @param data binary data
 		 * @param length of the binary data in bytes
-		 * @param freeOnDestroy if true, free this buffer once the story is destroyed
-		 * @return new story object
+		 * @param freeOnDestroy if true, free this buffer once the story is destroyed.
+		 *                      If loading fails the buffer stays with the caller
+		 * @param[out] result optional, whether the story could be loaded
+		 * @return new story object, nullptr if loading failed without exceptions
 		*/
-		static story* from_binary(unsigned char* data, size_t length, bool freeOnDestroy = true);
+		static story* from_binary(unsigned char* data, size_t length, bool freeOnDestroy = true,
+			load_result* result = nullptr);
 #pragma endregion
 	};
 }
\ No newline at end of file
@@ -1,20 +1,25 @@
 #pragma once
 
 #include "system.h"
+#include "allocator.h"
+
+#include <atomic>
 
 namespace ink::runtime
 {
 	namespace internal
 	{
-		struct ref_block
+		struct ref_block : heap_object<alloc_category::story>
 		{
 			ref_block()
 				: references(0)
 				, valid(true)
 			{ }
 
-			size_t references;
-			bool valid;
+			// reference counts are atomic so story pointers can be copied and
+			//  destroyed on different threads (see story)
+			std::atomic<size_t> references;
+			std::atomic<bool> valid;
 
 			static void remove_reference(ref_block*&);
 		};
@@ -11,7 +11,21 @@ namespace ink::runtime
 {
 	class globals_interface;
 	class runner_interface;
+	class snapshot;
 
 	typedef story_ptr<globals_interface> globals;
 	typedef story_ptr<runner_interface> runner;
+
+	/**
+	 * Outcome of loading a story, snapshot or journal.
+	 *
+	 * With exceptions a failed load throws an ink_exception, without
+	 * them (INK_DISABLE_EXCEPTIONS) the loader returns nullptr and
+	 * reports the error here.
+	 */
+	struct load_result
+	{
+		bool ok = true;              ///< false if the data could not be loaded
+		const char* error = nullptr; ///< what went wrong, nullptr if ok
+	};
 }
\ No newline at end of file
@@ -0,0 +1,369 @@
+#include "journal_impl.h"
+#include "story_impl.h"
+#include "value.h"
+#include "platform.h"
+#include "error.h"
+
+#ifdef INK_ENABLE_STL
+#include <memory>
+#endif
+
+namespace ink::runtime
+{
+	journal* journal::from_binary(const unsigned char* data, size_t length, bool freeOnDestroy, load_result* result)
+	{
+		return internal::checked_create(result, [=]() -> journal* {
+			return new internal::journal_impl(data, length, freeOnDestroy);
+		});
+	}
+
+#ifdef INK_ENABLE_STL
+	journal* journal::from_file(const char* filename, load_result* result)
+	{
+		return internal::checked_create(result, [filename]() -> journal* {
+			std::ifstream ifs(filename, std::ios::binary | std::ios::ate);
+			if (!ifs.is_open()) {
+				inkFail("Failed to open journal file");
+				return nullptr;
+			}
+
+			size_t length = static_cast<size_t>(ifs.tellg());
+			std::unique_ptr<unsigned char[]> data{new unsigned char[length]};
+			ifs.seekg(0, std::ios::beg);
+			ifs.read(reinterpret_cast<char*>(data.get()), length);
+			ifs.close();
+
+			// the journal only owns the buffer once it loaded
+			journal* loaded = new internal::journal_impl(data.get(), length, true);
+			if (!internal::error_raised())
+				data.release();
+			return loaded;
+		});
+	}
+
+	bool journal::write_to_file(const char* filename) const
+	{
+		std::ofstream ofs(filename, std::ios::binary);
+		if (!ofs.is_open()) {
+			inkFail("Failed to open file to write journal");
+			return false;
+		}
+		ofs.write(reinterpret_cast<const char*>(get_data()), get_data_len());
+		return true;
+	}
+#endif
+}
+
+namespace ink::runtime::internal
+{
+	namespace
+	{
+		// Value encodings, a kind byte followed by the data
+		enum class value_kind : unsigned char
+		{
+			none,
+			boolean, // one byte
+			int32,   // zigzag varint
+			uint32,  // varint
+			float32, // 4 bytes
+			string,  // null terminated
+		};
+	}
+
+	void journal_writer::start(const story_impl& story, uint32_t seed)
+	{
+		clear();
+		uint32_t endian_version = 0x0001 | (static_cast<uint32_t>(journal_impl::Version) << 16);
+		write_u32(journal_impl::Magic);
+		write_u32(endian_version);
+		write_u32(story.fingerprint());
+		this->seed(seed);
+	}
+
+	void journal_writer::clear()
+	{
+		_data.clear();
+		_run_count = 0;
+		_open = false;
+	}
+
+	void journal_writer::seed(uint32_t seed)
+	{
+		begin(journal_entry::seed);
+		write_u32(seed);
+	}
+
+	void journal_writer::choose(size_t index)
+	{
+		begin(journal_entry::choose);
+		// the fallback choice is ~0, which becomes 0
+		write_varint(static_cast<uint64_t>(index + 1));
+	}
+
+	void journal_writer::external(const value& val)
+	{
+		begin(journal_entry::external);
+		write(val);
+	}
+
+	void journal_writer::set_global(hash_t name, const value& val)
+	{
+		begin(journal_entry::set_global);
+		write_u32(name);
+		write(val);
+	}
+
+	void journal_writer::move_to(hash_t path)
+	{
+		begin(journal_entry::move_to);
+		write_u32(path);
+	}
+
+	void journal_writer::reset()
+	{
+		begin(journal_entry::reset);
+	}
+
+	void journal_writer::reset_globals()
+	{
+		begin(journal_entry::reset_globals);
+	}
+
+	void journal_writer::flush_run()
+	{
+		if (_run_count == 0)
+			return;
+		write_byte(static_cast<unsigned char>(_run_kind));
+		write_varint(_run_count);
+		_run_count = 0;
+	}
+
+	void journal_writer::begin(journal_entry kind)
+	{
+		if (_open) {
+			// the entry happens while advancing, e.g. an external function
+			_open = false;
+			run(journal_entry::advances);
+		}
+		flush_run();
+		write_byte(static_cast<unsigned char>(kind));
+	}
+
+	void journal_writer::write_varint(uint64_t val)
+	{
+		while (val >= 0x80) {
+			write_byte(static_cast<unsigned char>(val | 0x80));
+			val >>= 7;
+		}
+		write_byte(static_cast<unsigned char>(val));
+	}
+
+	void journal_writer::write_u32(uint32_t val)
+	{
+		const unsigned char* src = reinterpret_cast<const unsigned char*>(&val);
+		for (size_t i = 0; i < sizeof(val); ++i)
+			write_byte(src[i]);
+	}
+
+	void journal_writer::write(const value& val)
+	{
+		switch (val.type())
+		{
+		case value_type::boolean:
+			write_byte(static_cast<unsigned char>(value_kind::boolean));
+			write_byte(val.get<value_type::boolean>() ? 1 : 0);
+			break;
+		case value_type::int32:
+		{
+			int32_t i = val.get<value_type::int32>();
+			write_byte(static_cast<unsigned char>(value_kind::int32));
+			write_varint((static_cast<uint32_t>(i) << 1) ^ static_cast<uint32_t>(i >> 31));
+		} break;
+		case value_type::uint32:
+			write_byte(static_cast<unsigned char>(value_kind::uint32));
+			write_varint(val.get<value_type::uint32>());
+			break;
+		case value_type::float32:
+		{
+			float f = val.get<value_type::float32>();
+			uint32_t bits;
+			const unsigned char* src = reinterpret_cast<const unsigned char*>(&f);
+			unsigned char* dst = reinterpret_cast<unsigned char*>(&bits);
+			for (size_t i = 0; i < sizeof(f); ++i)
+				dst[i] = src[i];
+			write_byte(static_cast<unsigned char>(value_kind::float32));
+			write_u32(bits);
+		} break;
+		case value_type::string:
+		{
+			write_byte(static_cast<unsigned char>(value_kind::string));
+			const char* str = val.get<value_type::string>();
+			do {
+				write_byte(static_cast<unsigned char>(*str));
+			} while (*str++);
+		} break;
+		case value_type::none:
+			write_byte(static_cast<unsigned char>(value_kind::none));
+			break;
+		default:
+			inkFail("Journal can not record values of this type");
+		}
+	}
+
+	unsigned char* journal_writer::copy(size_t& length) const
+	{
+		// the counted lines are written into the copy
+		journal_writer tail;
+		tail._run_kind = _run_kind;
+		tail._run_count = _run_count;
+		if (_open)
+			tail.run(journal_entry::advances);
+		tail.flush_run();
+
+		length = _data.size() + tail._data.size();
+		unsigned char* data = new unsigned char[length];
+		for (size_t i = 0; i < _data.size(); ++i)
+			data[i] = _data[i];
+		for (size_t i = 0; i < tail._data.size(); ++i)
+			data[_data.size() + i] = tail._data[i];
+		return data;
+	}
+
+	journal_impl::journal_impl(const unsigned char* data, size_t length, bool manage)
+		: _data(data), _length(length), _managed(false), _fingerprint(0)
+	{
+		// parse header
+		auto field = [this](size_t offset) {
+			uint32_t val;
+			for (size_t i = 0; i < sizeof(uint32_t); ++i)
+				reinterpret_cast<unsigned char*>(&val)[i] = _data[offset + i];
+			return val;
+		};
+		if (_length < HeaderSize || field(0) != Magic) {
+			inkFail("Data is not an ink journal");
+			return;
+		}
+		uint32_t endian_version = field(4);
+		if ((endian_version & 0xFFFF) != 0x0001) {
+			inkFail("Journal was recorded on a machine with different endianness");
+			return;
+		}
+		if ((endian_version >> 16) != Version) {
+			inkFail("Journal version mismatch: journal was recorded by a different InkCpp-version");
+			return;
+		}
+		_fingerprint = field(8);
+
+		// a journal which failed to load leaves the data to the caller
+		_managed = manage;
+	}
+
+	journal_impl::~journal_impl()
+	{
+		if (_managed)
+			delete[] _data;
+		_data = nullptr;
+	}
+
+	bool journal_impl::check_story(const story_impl& story) const
+	{
+		if (story.fingerprint() != _fingerprint) {
+			inkFail("Journal was recorded with a different story");
+			return false;
+		}
+		return true;
+	}
+
+	journal_reader::journal_reader(const journal_impl& log)
+		: _ptr(log.get_data() + journal_impl::HeaderSize), _end(log.get_data() + log.get_data_len())
+	{ }
+
+	journal_entry journal_reader::next()
+	{
+		unsigned char tag = read_byte();
+		if (tag < static_cast<unsigned char>(journal_entry::seed)
+			|| tag > static_cast<unsigned char>(journal_entry::reset_globals)) {
+			inkFail("Journal entry is corrupt");
+			return journal_entry::drops;
+		}
+		return static_cast<journal_entry>(tag);
+	}
+
+	unsigned char journal_reader::read_byte()
+	{
+		if (_ptr == _end) {
+			inkFail("Unexpected end of journal data");
+			return 0;
+		}
+		return *_ptr++;
+	}
+
+	uint64_t journal_reader::read_varint()
+	{
+		uint64_t val = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			unsigned char byte = read_byte();
+			val |= static_cast<uint64_t>(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				return val;
+		}
+		inkFail("Journal number is corrupt");
+		return 0;
+	}
+
+	uint32_t journal_reader::read_u32()
+	{
+		uint32_t val;
+		for (size_t i = 0; i < sizeof(val); ++i)
+			reinterpret_cast<unsigned char*>(&val)[i] = read_byte();
+		return val;
+	}
+
+	value journal_reader::read_value()
+	{
+		switch (static_cast<value_kind>(read_byte()))
+		{
+		case value_kind::none:
+			return value{};
+		case value_kind::boolean:
+			return value{}.set<value_type::boolean>(read_byte() != 0);
+		case value_kind::int32:
+		{
+			uint32_t zigzag = static_cast<uint32_t>(read_varint());
+			return value{}.set<value_type::int32>(static_cast<int32_t>((zigzag >> 1) ^ (~(zigzag & 1) + 1)));
+		}
+		case value_kind::uint32:
+			return value{}.set<value_type::uint32>(static_cast<uint32_t>(read_varint()));
+		case value_kind::float32:
+		{
+			uint32_t bits = read_u32();
+			float f;
+			const unsigned char* src = reinterpret_cast<const unsigned char*>(&bits);
+			unsigned char* dst = reinterpret_cast<unsigned char*>(&f);
+			for (size_t i = 0; i < sizeof(f); ++i)
+				dst[i] = src[i];
+			return value{}.set<value_type::float32>(f);
+		}
+		case value_kind::string:
+		{
+			const char* str = reinterpret_cast<const char*>(_ptr);
+			while (read_byte() != 0) { }
+			if (error_raised())
+				return value{};
+			return value{}.set<value_type::string>(str, false);
+		}
+		}
+		inkFail("Journal value is corrupt");
+		return value{};
+	}
+
+	value journal_reader::external()
+	{
+		if (done() || next() != journal_entry::external) {
+			inkFail("Journal does not match the story: expected an external function call");
+			return value{};
+		}
+		return read_value();
+	}
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "journal.h"
+#include "system.h"
+#include "array.h"
+
+namespace ink::runtime::internal
+{
+	class story_impl;
+	class string_table;
+	class value;
+
+	// Entries of a journal. Each is a tag byte followed by its data,
+	//  numbers are written as varints
+	enum class journal_entry : unsigned char
+	{
+		seed = 1,      // uint32 random state
+		lines,         // count: lines read, each advanced and extracted
+		advances,      // count: advances whose output was not extracted yet
+		drops,         // count: extractions of the output
+		choose,        // index + 1, 0 for the fallback choice
+		external,      // value: return value of an external function
+		set_global,    // hash, value: global variable set by the host
+		move_to,       // hash: path the runner was moved to
+		reset,         // the runner was reset
+		reset_globals, // the global store was reset
+	};
+
+	/**
+	 * Appends the entries of a journal into a growing byte buffer.
+	 *
+	 * Reading the story happens once per line, so lines are counted and
+	 * only written as one entry when something else happens. That keeps
+	 * recording cheap and the journal short.
+	 */
+	class journal_writer
+	{
+	public:
+		// Starts a new journal for the story, at the given random state
+		void start(const story_impl& story, uint32_t seed);
+		void clear();
+
+		void seed(uint32_t seed);
+		void advance()
+		{
+			// a previous advance was not extracted, e.g. by getall
+			if (_open)
+				run(journal_entry::advances);
+			_open = true;
+		}
+		void drop()
+		{
+			if (_open) {
+				_open = false;
+				run(journal_entry::lines);
+			} else {
+				run(journal_entry::drops);
+			}
+		}
+		void choose(size_t index);
+		void external(const value&);
+		void set_global(hash_t name, const value&);
+		void move_to(hash_t path);
+		void reset();
+		void reset_globals();
+
+		// Copies the journal, including the lines still counted.
+		//  Ownership of the buffer moves to the caller
+		unsigned char* copy(size_t& length) const;
+
+	private:
+		void run(journal_entry kind)
+		{
+			if (_run_kind == kind) {
+				++_run_count;
+			} else {
+				flush_run();
+				_run_kind = kind;
+				_run_count = 1;
+			}
+		}
+		void flush_run();
+		// Flushes counted entries and writes the tag of a new one
+		void begin(journal_entry kind);
+
+		void write_byte(unsigned char byte) { _data.push() = byte; }
+		void write_varint(uint64_t);
+		void write_u32(uint32_t);
+		void write(const value&);
+
+		managed_array<unsigned char, true, 64> _data;
+		journal_entry _run_kind = journal_entry::lines;
+		size_t _run_count = 0;
+		bool _open = false;
+	};
+
+	// Journal data with a parsed header
+	class journal_impl : public journal
+	{
+	public:
+		// Takes ownership of data if manage is set
+		journal_impl(const unsigned char* data, size_t length, bool manage);
+		virtual ~journal_impl();
+
+		// == Non-Copyable ==
+		journal_impl(const journal_impl&) = delete;
+		journal_impl& operator=(const journal_impl&) = delete;
+
+		virtual const unsigned char* get_data() const override { return _data; }
+		virtual size_t get_data_len() const override { return _length; }
+
+		// Fails if this journal was not recorded with the given story
+		bool check_story(const story_impl&) const;
+
+		static constexpr uint32_t Magic = 0x4a4b4e49; // "INKJ"
+		static constexpr uint16_t Version = 1;
+
+		// Header layout (all fields host endian)
+		//  uint32 magic | uint16 endian | uint16 version | uint32 story fingerprint
+		static constexpr size_t HeaderSize = 3 * sizeof(uint32_t);
+
+	private:
+		const unsigned char* _data;
+		size_t _length;
+		bool _managed;
+		hash_t _fingerprint;
+	};
+
+	// Reads the entries of a journal in order
+	class journal_reader
+	{
+	public:
+		journal_reader(const journal_impl&);
+
+		bool done() const { return _ptr == _end; }
+		journal_entry next();
+
+		uint64_t read_varint();
+		uint32_t read_u32();
+		// Strings point into the journal data
+		value read_value();
+
+		// Reads the value of the next entry, which must be an external call
+		value external();
+
+	private:
+		unsigned char read_byte();
+
+		const unsigned char* _ptr;
+		const unsigned char* _end;
+	};
+}
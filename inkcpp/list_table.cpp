@@ -3,6 +3,7 @@
 #include "header.h"
 #include "random.h"
 #include "string_utils.h"
+#include "snapshot_impl.h"
 
 #ifdef INK_ENABLE_STL
 #include <ostream>
@@ -55,6 +56,7 @@ namespace ink::runtime::internal
 		for(int i = 0; i < _entry_state.size(); ++i) {
 			if (_entry_state[i] == state::empty) {
 				_entry_state[i] = state::used;
+				changed(i);
 				return list(i);
 			}
 		}
@@ -62,6 +64,7 @@ namespace ink::runtime::internal
 		list new_entry(_entry_state.size());
 		// TODO: initelized unused?
 		_entry_state.push() = state::used;
+		_entry_changed.push() = _checkpoint;
 		for(int i = 0; i < _entrySize; ++i) {
 			_data.push() = 0;
 		}
@@ -85,6 +88,20 @@ namespace ink::runtime::internal
 		for(int i = 0; i < _entry_state.size(); ++i) {
 			if (_entry_state[i] == state::unused) {
 				_entry_state[i] = state::empty;
+				changed(i);
+				data_t* entry = getPtr(i);
+				for(int j = 0; j != _entrySize; ++j) {
+					entry[j] = 0;
+				}
+			}
+		}
+	}
+
+	void list_table::clear() {
+		for(int i = 0; i < _entry_state.size(); ++i) {
+			if (_entry_state[i] != state::permanent && _entry_state[i] != state::empty) {
+				_entry_state[i] = state::empty;
+				changed(i);
 				data_t* entry = getPtr(i);
 				for(int j = 0; j != _entrySize; ++j) {
 					entry[j] = 0;
@@ -214,6 +231,7 @@ namespace ink::runtime::internal
 	list_table::list& list_table::add_inplace(list& lh, list_flag rh) {
 		if(rh.list_id < 0) return lh; // empty or null flag (skip)
 		data_t* l = getPtr(lh.lid);
+		changed(lh.lid);
 		setList(l, rh.list_id);
 		if(rh.flag >= 0) {  // origin entry
 			setFlag(l, toFid(rh));
@@ -612,6 +630,7 @@ namespace ink::runtime::internal
 		}
 		if(!has_origin) {
 			copy_lists(l, r);
+			changed(rh.lid);
 		}
 
 		for(int i = 0; i < _entrySize; ++i) {
@@ -620,6 +639,80 @@ namespace ink::runtime::internal
 		return res;
 	}
 
+	void list_table::snap(snapper& snapper) const
+	{
+		// list definitions come from the story, only entries are written
+		snapper.write(_entry_state.size());
+		for (state s : _entry_state)
+			snapper.write(s);
+		for (data_t d : _data)
+			snapper.write(d);
+	}
+
+	void list_table::snap_load(loader& loader)
+	{
+		size_t num_entries;
+		loader.read(num_entries);
+		_entry_state.clear();
+		_data.clear();
+		for (size_t i = 0; i < num_entries; ++i)
+			loader.read(_entry_state.push());
+		for (size_t i = 0; i < num_entries * _entrySize; ++i)
+			loader.read(_data.push());
+		_entry_changed.clear();
+		for (size_t i = 0; i < num_entries; ++i)
+			_entry_changed.push() = 0;
+	}
+
+	void list_table::snap_changed(snapper& snapper, uint32_t since) const
+	{
+		snapper.write(_entry_state.size());
+		uint32_t count = 0;
+		for (uint32_t c : _entry_changed)
+			if (c > since)
+				++count;
+		snapper.write(count);
+		for (size_t i = 0; i < _entry_changed.size(); ++i)
+		{
+			if (_entry_changed[i] > since)
+			{
+				snapper.write(static_cast<uint32_t>(i));
+				snapper.write(_entry_state[i]);
+				const data_t* entry = getPtr(i);
+				for (int j = 0; j < _entrySize; ++j)
+					snapper.write(entry[j]);
+			}
+		}
+	}
+
+	void list_table::snap_load_changed(loader& loader)
+	{
+		// entries are never removed, only new ones are appended
+		size_t num_entries;
+		loader.read(num_entries);
+		inkAssert(num_entries >= _entry_state.size(), "Snapshot delta has less list entries than its base");
+		while (_entry_state.size() < num_entries)
+		{
+			_entry_state.push() = state::empty;
+			_entry_changed.push() = 0;
+			for (int i = 0; i < _entrySize; ++i)
+				_data.push() = 0;
+		}
+
+		uint32_t count;
+		loader.read(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			uint32_t index;
+			loader.read(index);
+			inkAssert(index < num_entries, "Snapshot list entry out of range");
+			loader.read(_entry_state[index]);
+			data_t* entry = getPtr(index);
+			for (int j = 0; j < _entrySize; ++j)
+				loader.read(entry[j]);
+		}
+	}
+
 #ifdef INK_ENABLE_STL
 	std::ostream& list_table::write(std::ostream& os, list l) const {
 		bool first = true;
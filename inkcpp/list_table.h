@@ -13,6 +13,8 @@ namespace ink::internal {
 namespace ink::runtime::internal
 {
 	class prng;
+	class snapper;
+	class loader;
 
 	// TODO: move to utils
 	// memory segments
@@ -56,6 +58,9 @@ namespace ink::runtime::internal
 		/// delete unused lists
 		void gc();
 
+		/// delete all lists but the predefined ones
+		void clear();
+
 
 		// function to setup list_table
 		list create_permament();
@@ -146,7 +151,19 @@ namespace ink::runtime::internal
 		}
 		list range(list l, int min, int max);
 
+		// == Snapshots ==
+		void snap(snapper&) const;
+		void snap_load(loader&);
+
+		/// entries changed from now on are marked with this checkpoint
+		void set_checkpoint(uint32_t checkpoint) { _checkpoint = checkpoint; }
+
+		/// only writes entries changed after the given checkpoint
+		void snap_changed(snapper&, uint32_t since) const;
+		void snap_load_changed(loader&);
+
 	private:
+		void changed(int lid) { _entry_changed[lid] = _checkpoint; }
 		void copy_lists(const data_t* src, data_t* dst);
 		static constexpr int bits_per_data = sizeof(data_t) * 8;
 		int listBegin(int lid) const {
@@ -203,7 +220,7 @@ namespace ink::runtime::internal
 		}
 
 		template<typename T, int config>
-		using managed_array = managed_array<T, config < 0, abs(config)>;
+		using managed_array = managed_array<T, config < 0, abs(config), alloc_category::lists>;
 
 		static constexpr int maxMemorySize = 
 			(config::maxListTypes < 0
@@ -221,6 +238,9 @@ namespace ink::runtime::internal
 		// entries (created lists)
 		managed_array<data_t, maxMemorySize> _data;
 		managed_array<state, config::maxLists> _entry_state;
+		// checkpoint of the last change of each entry
+		managed_array<uint32_t, config::maxLists> _entry_changed;
+		uint32_t _checkpoint = 0;
 
 		// defined list (meta data)
 		managed_array<int, config::maxListTypes> _list_end;
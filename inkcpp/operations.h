@@ -54,7 +54,7 @@ namespace ink::runtime::internal {
 		 * @param vs array of values, first one = first argument etc
 		 */
 		void operator()(basic_eval_stack& stack, value* vs) {
-			throw ink_exception("operation not implemented!");
+			inkFail("operation not implemented!");
 		}
 	};
 }
@@ -1,6 +1,7 @@
 #include "output.h"
 #include "string_table.h"
 #include "list_table.h"
+#include "snapshot_impl.h"
 #include <system.h>
 #include "string_utils.h"
 
@@ -15,7 +16,7 @@ namespace ink
 		namespace internal
 		{
 			basic_stream::basic_stream(value* buffer, size_t len)
-				: _data(buffer), _max(len), _size(0), _save(~0)
+				: _last_char(0), _data(buffer), _max(len), _size(0), _save(~0)
 			{}
 
 			void basic_stream::append(const value& in)
@@ -34,45 +35,42 @@ namespace ink
 					return;
 
 				// Add to data stream
-				inkAssert(_size < _max, "Output stream overflow");
+				if (_size >= _max) {
+					inkFail("Output stream overflow");
+					return;
+				}
+				if (past_save(_size) && is_text(in))
+					++_text_past_save;
+				if (in.type() == value_type::marker)
+					_markers.push() = _size;
 				_data[_size++] = in;
 
+				if (is_trimmable(in))
+					return;
+
 				// Special: Incoming glue. Trim whitespace/newlines prior
 				//  This also applies when a function ends to trim trailing whitespace.
-				if ((in.type() == value_type::glue || in.type() == value_type::func_end) && _size > 1)
+				if (in.type() == value_type::glue || in.type() == value_type::func_end)
 				{
-					// Run backwards
-					size_t i = _size - 2;
-					while(true)
+					for (size_t i = _trim_start; i < _size - 1; ++i)
 					{
-						value& d = _data[i];
-
-						// Nullify newlines
-						if (d.type() == value_type::newline) {
-							d = value{};
-						}
-
-						// Nullify whitespace
-						else if ( d.type() == value_type::string 
-							&& is_whitespace(d.get<value_type::string>()))
-							d = value{};
-
-						// If it's not a newline or whitespace, stop
-						else break;
-
-						// If we've hit the end, break
-						if (i == 0)
-							break;
-
-						// Move on to next element
-						i--;
+						// a string of newlines is text past the save
+						if (past_save(i) && is_text(_data[i]))
+							--_text_past_save;
+						_data[i] = value{};
 					}
 				}
+				_trim_start = _size;
 			}
 
 			void basic_stream::append(const value* in, unsigned int length)
 			{
-				// TODO: Better way to bulk while still executing glue checks?
+				// Glue only looks back to the last value it can't trim, so
+				//  each value is handled once
+				if (_size + length > _max) {
+					inkFail("Output stream overflow");
+					return;
+				}
 				for (size_t i = 0; i < length; i++)
 					append(in[i]);
 			}
@@ -89,6 +87,12 @@ namespace ink
 				(*output++) = c;
 			}
 
+			template<>
+			inline void write_char(managed_array<char, true, 256>& output, char c)
+			{
+				output.push() = c;
+			}
+
 			template<>
 			inline void write_char(std::stringstream& output, char c)
 			{
@@ -135,12 +139,14 @@ namespace ink
 				}
 
 				// Reset stream size to where we last held the marker
-				_size = start;
+				truncate(start);
 
 				// Return processed string
 				// remove mulitple accourencies of ' '
 				std::string result = str.str();
 				auto end = clean_string<true, false>(result.begin(), result.end());
+				if (end == result.begin())
+					return "";
 				_last_char = *(end-1);
 				result.resize(end - result.begin() - (_last_char == ' ' ? 1 : 0));
 				return result;
@@ -183,7 +189,7 @@ namespace ink
 				}
 
 				// Reset stream size to where we last held the marker
-				_size = start;
+				truncate(start);
 
 				// Return processed string
 				return str;
@@ -198,16 +204,103 @@ namespace ink
 
 			const value& basic_stream::peek() const
 			{
-				inkAssert(_size > 0, "Attempting to peek empty stream!");
+				if (_size == 0) {
+					inkFail("Attempting to peek empty stream!");
+					return _data[0];
+				}
 				return _data[_size - 1];
 			}
 
 			void basic_stream::discard(size_t length)
 			{
 				// discard elements
-				_size -= length;
-				if (_size < 0)
-					_size = 0;
+				truncate(length < _size ? _size - length : 0);
+			}
+
+			namespace
+			{
+				// Runs characters through the rules of clean_string<true, false>,
+				//  only keeping the last character it would keep
+				class clean_tail
+				{
+				public:
+					void push(char c)
+					{
+						if (_has_current)
+							keep(c, false);
+						_previous = _current;
+						_current = c;
+						_first = !_has_current;
+						_has_current = true;
+					}
+					// last kept character, 0 if none
+					char finish()
+					{
+						if (_has_current)
+							keep(0, true);
+						_has_current = false;
+						return _last;
+					}
+
+				private:
+					void keep(char next, bool at_end)
+					{
+						char c = _current;
+						bool space = c == ' ' || c == '\n';
+						if (_first) {
+							if (space) { return; }
+						}
+						else if (_previous == '\n' && space) { return; }
+						else if (c == ' ' && !at_end && (next == ' ' || next == '\n')) { return; }
+						else if (c == '\n' && _last == '\n') { return; }
+						_last = c;
+					}
+
+					char _previous = 0;
+					char _current = 0;
+					char _last = 0;
+					bool _first = false;
+					bool _has_current = false;
+				};
+			}
+
+			void basic_stream::skip()
+			{
+				size_t start = find_start();
+
+				bool hasGlue = false, lastNewline = false;
+				clean_tail tail;
+				for (size_t i = start; i < _size; i++)
+				{
+					if (should_skip(i, hasGlue, lastNewline))
+						continue;
+					const value& v = _data[i];
+					switch (v.type())
+					{
+					case value_type::string:
+						for (const char* c = v.get<value_type::string>(); *c; ++c)
+							tail.push(*c);
+						break;
+					case value_type::newline:
+						tail.push('\n');
+						break;
+					case value_type::list:
+						// only the ends of the text matter, which are never spaces
+						if (_lists_table == nullptr || _lists_table->stringLen(v.get<value_type::list>()) > 0)
+							tail.push('x');
+						break;
+					default:
+						// numbers, booleans and list flags print without spaces
+						if (v.printable())
+							tail.push('x');
+						break;
+					}
+				}
+
+				truncate(start);
+				char last = tail.finish();
+				if (last != 0)
+					_last_char = last;
 			}
 
 			void basic_stream::get(value* ptr, size_t length)
@@ -226,7 +319,10 @@ namespace ink
 						continue;
 
 					// Make sure we can fit the next element
-					inkAssert(ptr < end, "Insufficient space in data array to store stream contents!");
+					if (ptr >= end) {
+						inkFail("Insufficient space in data array to store stream contents!");
+						break;
+					}
 
 					// Copy any value elements
 					if (_data[i].printable()) {
@@ -235,19 +331,12 @@ namespace ink
 				}
 
 				// Reset stream size to where we last held the marker
-				_size = start;
+				truncate(start);
 			}
 
 			bool basic_stream::has_marker() const
 			{
-				// TODO: Cache?
-				for (size_t i = 0; i < _size; i++)
-				{
-					if (_data[i].type() == value_type::marker)
-						return true;
-				}
-
-				return false;
+				return _markers.size() != 0;
 			}
 
 			bool basic_stream::ends_with(value_type type) const
@@ -260,7 +349,10 @@ namespace ink
 
 			bool basic_stream::saved_ends_with(value_type type) const
 			{
-				inkAssert(_save != ~0, "Stream is not saved!");
+				if (_save == ~0) {
+					inkFail("Stream is not saved!");
+					return false;
+				}
 
 				if (_save == 0)
 					return false;
@@ -270,62 +362,76 @@ namespace ink
 
 			void basic_stream::save()
 			{
-				inkAssert(_save == ~0, "Can not save over existing save point!");
+				if (_save != ~0) {
+					inkFail("Can not save over existing save point!");
+					return;
+				}
 
 				// Save the current size
 				_save = _size;
+				_text_past_save = 0;
 			}
 
 			void basic_stream::restore()
 			{
-				inkAssert(_save != ~0, "No save point to restore!");
+				if (_save == ~0) {
+					inkFail("No save point to restore!");
+					return;
+				}
 
 				// Restore size to saved position
-				_size = _save;
+				if (_save <= _size) {
+					truncate(_save);
+				} else {
+					_size = _save;
+					reindex();
+				}
 				_save = ~0;
+				_text_past_save = 0;
 			}
 
 			void basic_stream::forget()
 			{
-				inkAssert(_save != ~0, "No save point to forget!");
+				if (_save == ~0) {
+					inkFail("No save point to forget!");
+					return;
+				}
 
 				// Just null the save point and continue as normal
 				_save = ~0;
+				_text_past_save = 0;
 			}
 			
-			template char* basic_stream::get_alloc<true>(string_table& strings, list_table& lists);
-			template char* basic_stream::get_alloc<false>(string_table& strings, list_table& lists);
+			template const char* basic_stream::get_alloc<true>(string_table& strings, list_table& lists);
+			template const char* basic_stream::get_alloc<false>(string_table& strings, list_table& lists);
+			template const char* basic_stream::get_alloc<true, true>(string_table& strings, list_table& lists);
 
-			template<bool RemoveTail>
-			char* basic_stream::get_alloc(string_table& strings, list_table& lists)
+			template<bool RemoveTail, bool Trim>
+			const char* basic_stream::get_alloc(string_table& strings, list_table& lists)
 			{
 				size_t start = find_start();
 
-				// Two passes. First for length
-				size_t length = 0;
-				bool hasGlue = false, lastNewline = false;
-				for (size_t i = start; i < _size; i++)
+				// A marker and a clean string: reuse the string, the stream holds no other reference
+				if (_size - start == 2 && _data[start].type() == value_type::marker
+					&& _data[start + 1].type() == value_type::string)
 				{
-					if (should_skip(i, hasGlue, lastNewline))
-						continue;
-					++length; // potenzial space to sperate 
-					if (_data[i].printable()) {
-						switch(_data[i].type()) {
-							case value_type::list:
-								length += lists.stringLen(_data[i].get<value_type::list>());
-								break;
-							case value_type::list_flag:
-								length += lists.stringLen(_data[i].get<value_type::list_flag>());
-							default: length += value_length(_data[i]);
-						}
+					const char* str = _data[start + 1].get<value_type::string>();
+					const char* str_end = str + c_str_len(str);
+					bool clean = Trim
+						? is_clean_string<true, true>(str, str_end)
+						: is_clean_string<false, false>(str, str_end) && !(RemoveTail && str != str_end && str_end[-1] == ' ');
+					if (clean)
+					{
+						if (str != str_end)
+							_last_char = str_end[-1];
+						truncate(start);
+						return str;
 					}
 				}
 
-				// Allocate
-				char* buffer = strings.create(length + 1);
-				char* end = buffer + length + 1;
-				char* ptr = buffer;
-				hasGlue = false; lastNewline = false;
+				// Single pass into the scratch buffer, the string table gets the cleaned result
+				_scratch.clear();
+				bool hasGlue = false, lastNewline = false;
 				for (size_t i = start; i < _size; i++)
 				{
 					if (should_skip(i, hasGlue, lastNewline))
@@ -336,58 +442,63 @@ namespace ink
 					case value_type::int32:
 					case value_type::float32:
 					case value_type::uint32:
-						// Convert to string and advance
-						toStr(ptr, end - ptr, _data[i]);
-						while (*ptr != 0) ptr++;
-
-						break;
-					case value_type::string:
 					{
-						// Copy string and advance
-						const char* value = _data[i].get<value_type::string>(); 
-						copy_string(value, i, ptr);
+						// Convert to string and drop the unused tail
+						size_t length = value_length(_data[i]) + 1;
+						char* ptr = _scratch.push(length);
+						toStr(ptr, length, _data[i]);
+						_scratch.resize(ptr - _scratch.begin() + c_str_len(ptr));
 					}	break;
+					case value_type::string:
+						copy_string(_data[i].get<value_type::string>(), i, _scratch);
+						break;
 					case value_type::newline:
-						*ptr = '\n'; ptr++;
+						_scratch.push() = '\n';
 						break;
 					case value_type::list:
-						ptr = lists.toString(ptr, _data[i].get<value_type::list>());
-						break;
+					{
+						list_table::list l = _data[i].get<value_type::list>();
+						char* ptr = _scratch.push(lists.stringLen(l));
+						_scratch.resize(lists.toString(ptr, l) - _scratch.begin());
+					}	break;
 					case value_type::list_flag:
-						ptr = lists.toString(ptr, _data[i].get<value_type::list>());
-						break;
-					default: throw ink_exception("cant convert expression to string!");
+					{
+						const char* name = lists.toString(_data[i].get<value_type::list_flag>());
+						if (name != nullptr)
+							copy_string(name, i, _scratch);
+					}	break;
+					default: inkFail("cant convert expression to string!");
 					}
 				}
 
-				// Make sure last character is a null
-				*ptr = 0;
-
 				// Reset stream size to where we last held the marker
-				_size = start;
+				truncate(start);
+
+				// Clean up spaces before sizing the string
+				char* end = clean_string<false,false>(_scratch.begin(), _scratch.end());
+				if (end != _scratch.begin()) {
+					_last_char = end[-1];
+					if constexpr (RemoveTail) {
+						if (_last_char == ' ') { --end; }
+					}
+				}
+				if constexpr (Trim) {
+					end = clean_string<true,true>(_scratch.begin(), end);
+				}
 
 				// Return processed string
-				{
-				 auto end = clean_string<false,false>(buffer, buffer+length);
-				 *end = 0;
-				 _last_char = end[-1];
-				 if constexpr (RemoveTail) {
-					 if (_last_char == ' ') { end[-1] = 0; }
-				 }
-				}
+				size_t length = end - _scratch.begin();
+				char* buffer = strings.create(length + 1);
+				for (size_t i = 0; i < length; ++i)
+					buffer[i] = _scratch[i];
+				buffer[length] = 0;
 				return buffer;
 			}
 
 			size_t basic_stream::find_start() const
 			{
 				// Find marker (or start)
-				size_t start = _size;
-				while (start > 0)
-				{
-					start--;
-					if (_data[start].type() == value_type::marker)
-						break;
-				}
+				size_t start = _markers.size() != 0 ? _markers.back() : 0;
 
 				// Make sure we're not violating a save point
 				if (_save != ~0 && start < _save) {
@@ -424,15 +535,8 @@ namespace ink
 					{
 						lastNewline = false;
 						// an empty string don't count as glued I095
-						for(const char* i=_data[iter].get<value_type::string>();
-								*i; ++i)
-						{
-							// isspace only supports characters in [0, UCHAR_MAX]
-							if (!isspace(static_cast<unsigned char>(*i))) {
-								hasGlue = false;
-								break;
-							}
-						}
+						if (!_data[iter].get<value_type::string>().is_space())
+							hasGlue = false;
 					} break;
 					default:
 						break;
@@ -444,26 +548,65 @@ namespace ink
 
 			bool basic_stream::text_past_save() const
 			{
-				// Check if there is text past the save
-				for (size_t i = _save; i < _size; i++)
+				return _text_past_save != 0;
+			}
+
+			bool basic_stream::is_text(const value& d)
+			{
+				return d.type() == value_type::string
+					&& !d.get<value_type::string>().is_whitespace(false);
+			}
+
+			bool basic_stream::is_trimmable(const value& d)
+			{
+				return d.type() == value_type::newline
+					|| (d.type() == value_type::string && d.get<value_type::string>().is_whitespace());
+			}
+
+			void basic_stream::truncate(size_t size)
+			{
+				// Forget text and markers which leave the stream
+				for (size_t i = size; i < _size; ++i)
+					if (past_save(i) && is_text(_data[i]))
+						--_text_past_save;
+				size_t num_markers = _markers.size();
+				while (num_markers > 0 && _markers[num_markers - 1] >= size)
+					--num_markers;
+				_markers.resize(num_markers);
+				_size = size;
+
+				// The new end may be in a run glue can trim
+				if (_trim_start > _size)
 				{
-					const value& d = _data[i];
-					if (d.type() == value_type::string)
-					{
-						// TODO: Cache what counts as whitespace?
-						if (!is_whitespace(d.get<value_type::string>(), false))
-							return true;
-					}
+					_trim_start = _size;
+					while (_trim_start > 0 && is_trimmable(_data[_trim_start - 1]))
+						--_trim_start;
 				}
+			}
 
-				// No text
-				return false;
+			void basic_stream::reindex()
+			{
+				_markers.clear();
+				_text_past_save = 0;
+				_trim_start = 0;
+				for (size_t i = 0; i < _size; ++i)
+				{
+					if (_data[i].type() == value_type::marker)
+						_markers.push() = i;
+					if (past_save(i) && is_text(_data[i]))
+						++_text_past_save;
+					if (!is_trimmable(_data[i]))
+						_trim_start = i + 1;
+				}
 			}
 
 			void basic_stream::clear()
 			{
 				_save = ~0;
 				_size = 0;
+				_text_past_save = 0;
+				_trim_start = 0;
+				_markers.clear();
 			}
 
 			void basic_stream::mark_strings(string_table& strings) const
@@ -480,6 +623,33 @@ namespace ink
 				}
 			}
 
+			void basic_stream::snap(snapper& snapper) const
+			{
+				snapper.write(_last_char);
+				snapper.write(_size);
+				snapper.write(_save);
+				size_t used = _save != ~0 && _save > _size ? _save : _size;
+				for (size_t i = 0; i < used; ++i)
+					snapper.write(_data[i]);
+			}
+
+			void basic_stream::snap_load(loader& loader)
+			{
+				loader.read(_last_char);
+				loader.read(_size);
+				loader.read(_save);
+				size_t used = _save != ~0 && _save > _size ? _save : _size;
+				if (used > _max) {
+					inkFail("Snapshot does not fit into output stream");
+					_size = 0;
+					_save = ~0;
+					return;
+				}
+				for (size_t i = 0; i < used; ++i)
+					loader.read(_data[i]);
+				reindex();
+			}
+
 #ifdef INK_ENABLE_STL
 			std::ostream& operator<<(std::ostream& out, basic_stream& in)
 			{
@@ -2,6 +2,7 @@
 
 #include "value.h"
 #include "platform.h"
+#include "array.h"
 
 namespace ink
 {
@@ -11,6 +12,8 @@ namespace ink
 		{
 			class string_table;
 			class list_table;
+			class snapper;
+			class loader;
 			class basic_stream
 			{
 			protected:
@@ -38,17 +41,24 @@ namespace ink
 				// discards data
 				void discard(size_t length);
 
+				// Drops what get() would extract without building the text, but
+				//  remembers its last character like get() does
+				void skip();
+
 				// Extract into a data array
 				void get(value*, size_t length);
 
 				/** Extract to a newly allocated string
+				 * A single string which needs no cleaning is returned as it is,
+				 * so story literals are not copied.
 				 * @param string_table place to allocate new string in
 				 * @param list_table needed do parse list values to string
 				 * @tparam RemoveTail if we should remove a tailing space
-				 * @return newly allocated string
+				 * @tparam Trim if we should remove leading and tailing whitespace
+				 * @return newly allocated or existing string
 				 */
-				template<bool RemoveTail = true>
-				char* get_alloc(string_table&, list_table&);
+				template<bool RemoveTail = true, bool Trim = false>
+				const char* get_alloc(string_table&, list_table&);
 
 #ifdef INK_ENABLE_STL
 				// Extract into a string
@@ -99,8 +109,27 @@ namespace ink
 
 				bool saved() const { return _save != ~0; }
 
+				// == Snapshots ==
+				void snap(snapper&) const;
+				void snap_load(loader&);
+
 			private:
 				size_t find_start() const;
+
+				// Shrinks the stream to the given size
+				void truncate(size_t size);
+
+				// Rebuilds markers, trim start and text count from the data
+				void reindex();
+
+				// Whether an element at this position is past the save point
+				bool past_save(size_t index) const { return _save != ~0 && index >= _save; }
+
+				// Whether a value counts as new text after a newline
+				static bool is_text(const value&);
+
+				// Whether glue removes a value before it
+				static bool is_trimmable(const value&);
 				bool should_skip(size_t iter, bool& hasGlue, bool& lastNewline) const;
 
 				template<typename OUT>
@@ -119,6 +148,18 @@ namespace ink
 				// save point
 				size_t _save;
 
+				// number of non-whitespace strings past the save point
+				size_t _text_past_save = 0;
+
+				// positions of the markers in the stream
+				managed_array<size_t, true, 4> _markers;
+
+				// start of the newlines and whitespace at the end, which glue trims
+				size_t _trim_start = 0;
+
+				// text of get_alloc before it is copied into the string table
+				managed_array<char, true, 256> _scratch;
+
 				const list_table* _lists_table = nullptr;
 			};
 
@@ -0,0 +1,109 @@
+#include "profile.h"
+#include "command.h"
+
+#ifdef INK_ENABLE_STL
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <vector>
+#endif
+
+namespace ink::runtime
+{
+	namespace
+	{
+		// Command names for reports, in enumeration order
+		const char* command_names[] = {
+			"STR", "INT", "BOOL", "FLOAT", "VALUE_POINTER", "DIVERT_VAL", "LIST",
+			"NEWLINE", "GLUE", "VOID", "TAG",
+			"DIVERT", "DIVERT_TO_VARIABLE", "TUNNEL", "FUNCTION",
+			"DONE", "END", "TUNNEL_RETURN", "FUNCTION_RETURN",
+			"DEFINE_TEMP", "SET_VARIABLE",
+			"START_EVAL", "END_EVAL", "OUTPUT", "POP", "DUPLICATE", "PUSH_VARIABLE_VALUE",
+			"VISIT", "READ_COUNT", "SEQUENCE", "SEED",
+			"START_STR", "END_STR",
+			"CHOICE",
+			"THREAD",
+			"LIST_RANGE",
+			"ADD", "SUBTRACT", "DIVIDE", "MULTIPLY", "MOD", "RANDOM",
+			"IS_EQUAL", "GREATER_THAN", "LESS_THAN", "GREATER_THAN_EQUALS", "LESS_THAN_EQUALS", "NOT_EQUAL",
+			"AND", "OR", "MIN", "MAX", "HAS", "HASNT", "INTERSECTION", "LIST_INT",
+			"NOT", "NEGATE", "LIST_COUNT", "LIST_MIN", "LIST_MAX", "READ_COUNT_VAR", "TURNS", "lrnd",
+			"FLOOR", "CEILING", "INT_CAST", "LIST_ALL", "LIST_INVERT", "LIST_VALUE", "CHOICE_COUNT",
+			"START_CONTAINER_MARKER", "END_CONTAINER_MARKER",
+			"CALL_EXTERNAL",
+		};
+		static_assert(sizeof(command_names) / sizeof(const char*) == static_cast<size_t>(Command::NUM_COMMANDS),
+			"command_names must match the Command enumeration");
+	}
+
+	size_t profile::num_commands()
+	{
+		return static_cast<size_t>(Command::NUM_COMMANDS);
+	}
+
+	const char* profile::name(size_t command)
+	{
+		return command < num_commands() ? command_names[command] : "<invalid>";
+	}
+
+	uint64_t profile::total_count() const
+	{
+		uint64_t total = 0;
+		for (size_t i = 0; i < num_commands(); ++i)
+			total += _count[i];
+		return total;
+	}
+
+	uint64_t profile::total_nanoseconds() const
+	{
+		uint64_t total = 0;
+		for (size_t i = 0; i < num_commands(); ++i)
+			total += _nanoseconds[i];
+		return total;
+	}
+
+	void profile::merge(const profile& other)
+	{
+		for (size_t i = 0; i < num_commands(); ++i)
+		{
+			_count[i] += other._count[i];
+			_nanoseconds[i] += other._nanoseconds[i];
+		}
+	}
+
+	void profile::reset()
+	{
+		for (size_t i = 0; i < MaxCommands; ++i)
+		{
+			_count[i] = 0;
+			_nanoseconds[i] = 0;
+		}
+	}
+
+#ifdef INK_ENABLE_STL
+	void profile::dump(std::ostream& out) const
+	{
+		std::vector<size_t> commands;
+		for (size_t i = 0; i < num_commands(); ++i)
+			if (_count[i] > 0)
+				commands.push_back(i);
+		std::sort(commands.begin(), commands.end(), [this](size_t a, size_t b) {
+			return _nanoseconds[a] != _nanoseconds[b] ? _nanoseconds[a] > _nanoseconds[b] : a < b;
+		});
+
+		uint64_t total = total_nanoseconds();
+		out << std::left << std::setw(24) << "command" << std::right
+			<< std::setw(12) << "count" << std::setw(14) << "total ns"
+			<< std::setw(10) << "avg ns" << std::setw(8) << "%" << '\n';
+		for (size_t i : commands)
+		{
+			out << std::left << std::setw(24) << name(i) << std::right
+				<< std::setw(12) << _count[i] << std::setw(14) << _nanoseconds[i]
+				<< std::setw(10) << _nanoseconds[i] / _count[i]
+				<< std::setw(8) << std::fixed << std::setprecision(1)
+				<< (total > 0 ? 100.0 * _nanoseconds[i] / total : 0.0) << '\n';
+		}
+	}
+#endif
+}
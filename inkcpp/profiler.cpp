@@ -0,0 +1,91 @@
+#include "profiler.h"
+
+#ifdef INK_ENABLE_PROFILE
+#include "story_impl.h"
+
+#include <ostream>
+
+namespace ink::runtime::internal
+{
+	call_profile::call_profile()
+	{
+		reset();
+	}
+
+	size_t call_profile::node(container_t top)
+	{
+		size_t base = _frames.empty() ? 0 : _frames.back();
+		if (base == _last_base && top == _last_top)
+			return _last_node;
+
+		uint64_t key = (static_cast<uint64_t>(base) << 32) | top;
+		auto iter = _children.find(key);
+		size_t result;
+		if (iter != _children.end())
+			result = iter->second;
+		else
+		{
+			result = _nodes.size();
+			_nodes.push_back(entry{ base, top, 0, 0 });
+			_children.emplace(key, result);
+		}
+
+		_last_base = base;
+		_last_top = top;
+		_last_node = result;
+		return result;
+	}
+
+	void call_profile::reset()
+	{
+		_nodes.clear();
+		_nodes.push_back(entry{ 0, None, 0, 0 });
+		_children.clear();
+		_frames.clear();
+		_last_base = ~size_t(0);
+		_last_top = None;
+		_last_node = 0;
+	}
+
+	void call_profile::write_folded(std::ostream& out, const story_impl& story, bool count_commands) const
+	{
+		for (size_t i = 1; i < _nodes.size(); ++i)
+		{
+			uint64_t value = count_commands ? _nodes[i].count : _nodes[i].nanoseconds;
+			if (value == 0)
+				continue;
+			write_stack(out, story, i);
+			out << ' ' << value << '\n';
+		}
+	}
+
+	void call_profile::write_stack(std::ostream& out, const story_impl& story, size_t node) const
+	{
+		const entry& e = _nodes[node];
+		if (e.parent != 0)
+		{
+			write_stack(out, story, e.parent);
+			out << ';';
+		}
+		write_container(out, story, e.container);
+	}
+
+	void call_profile::write_container(std::ostream& out, const story_impl& story, container_t container) const
+	{
+		if (container == None)
+		{
+			out << "<root>";
+			return;
+		}
+
+		// a frame per enclosing counted container, outermost first
+		container_t parent = story.container_parent(container);
+		if (parent != None)
+		{
+			write_container(out, story, parent);
+			out << ';';
+		}
+		out << story.container_name(container);
+	}
+}
+#endif
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "system.h"
+
+// Instrumentation of runner_impl::step(). Compiles to nothing unless
+//  INK_ENABLE_PROFILE is defined (CMake option INKCPP_PROFILE).
+#ifdef INK_ENABLE_PROFILE
+#include "profile.h"
+#include "command.h"
+
+#include <chrono>
+#include <vector>
+#include <unordered_map>
+#include <iosfwd>
+
+namespace ink::runtime::internal
+{
+	class story_impl;
+
+	// Attributes executed commands and time to the containers on the ink
+	//  callstack. Each node is a container entered below its parent node,
+	//  either directly or through a tunnel or function call.
+	class call_profile
+	{
+	public:
+		call_profile();
+
+		// Node of the given top container in the current frame
+		size_t node(container_t top);
+
+		void record(size_t node, uint64_t nanoseconds)
+		{
+			_nodes[node].count += 1;
+			_nodes[node].nanoseconds += nanoseconds;
+		}
+
+		// A tunnel or function is entered from the given container
+		void push_frame(container_t top) { _frames.push_back(node(top)); }
+		void pop_frame() { if (!_frames.empty()) _frames.pop_back(); }
+		void clear_frames() { _frames.clear(); }
+
+		// Drops all recorded data
+		void reset();
+
+		// One line per node: the container paths down to it and its nanoseconds or count
+		void write_folded(std::ostream&, const story_impl&, bool count_commands) const;
+
+	private:
+		struct entry
+		{
+			size_t parent;
+			container_t container;
+			uint64_t count;
+			uint64_t nanoseconds;
+		};
+		static constexpr container_t None = ~0u;
+
+		void write_stack(std::ostream&, const story_impl&, size_t node) const;
+		void write_container(std::ostream&, const story_impl&, container_t) const;
+
+		// node 0 is the root, which has no container
+		std::vector<entry> _nodes;
+		// node index by parent node and container
+		std::unordered_map<uint64_t, size_t> _children;
+		// nodes tunnels and functions were called from
+		std::vector<size_t> _frames;
+
+		// last lookup
+		size_t _last_base;
+		container_t _last_top;
+		size_t _last_node;
+	};
+
+	// Records the time between construction and destruction for a command
+	class profile_scope
+	{
+	public:
+		profile_scope(profile& commands, call_profile& calls, container_t top, Command cmd)
+			: _commands(commands), _calls(calls), _node(calls.node(top)), _cmd(cmd)
+			, _start(std::chrono::steady_clock::now())
+		{ }
+		~profile_scope()
+		{
+			auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - _start).count();
+			_commands.record(static_cast<size_t>(_cmd), elapsed);
+			_calls.record(_node, elapsed);
+		}
+
+		profile_scope(const profile_scope&) = delete;
+		profile_scope& operator=(const profile_scope&) = delete;
+
+	private:
+		profile& _commands;
+		call_profile& _calls;
+		size_t _node;
+		Command _cmd;
+		std::chrono::steady_clock::time_point _start;
+	};
+}
+
+#define INK_PROFILE_COMMAND(commands, calls, top, cmd) ::ink::runtime::internal::profile_scope ink_profile_scope_(commands, calls, top, cmd)
+#else
+#define INK_PROFILE_COMMAND(commands, calls, top, cmd)
+#endif
@@ -18,11 +18,18 @@ namespace ink::runtime::internal {
 			_x = (A*_x+ C) % M;
 			return _x;
 		}
+		// current state, srand with it continues the same sequence
+		uint32_t state() const { return _x; }
 		int32_t rand(int32_t max) {
 			uint64_t prod = rand();
 			prod *= max;
 			return static_cast<int32_t>(prod / M);
 		}
+
+		template<typename Snapper>
+		void snap(Snapper& snapper) const { snapper.write(_x); }
+		template<typename Loader>
+		void snap_load(Loader& loader) { loader.read(_x); }
 	private:
 		uint32_t _x = 1337;
 	};
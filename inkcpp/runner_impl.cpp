@@ -5,12 +5,17 @@
 #include "globals_impl.h"
 #include "header.h"
 #include "string_utils.h"
+#include "snapshot_impl.h"
+#include "error.h"
 
 namespace ink::runtime
 {
 	const choice* runner_interface::get_choice(size_t index) const
 	{
-		inkAssert(index < num_choices(), "Choice out of bounds!");
+		if (index >= num_choices()) {
+			inkFail("Choice out of bounds!");
+			return nullptr;
+		}
 		return begin() + index;
 	}
 
@@ -124,7 +129,11 @@ namespace ink::runtime::internal
 	{
 		using header = ink::internal::header;
 		// Sanity
-		inkAssert(_ptr + sizeof(T) <= _story->end(), "Unexpected EOF in Ink execution");
+		if (_ptr + sizeof(T) > _story->end())
+		{
+			inkFail("Unexpected EOF in Ink execution");
+			return T{};
+		}
 
 		// Read memory
 		T val = *(const T*)_ptr;
@@ -158,6 +167,9 @@ namespace ink::runtime::internal
 		// TODO: Garbage collection? ? which garbage ?
 		_fallback_choice = nullopt;
 		_choices.clear();
+		_fallback_choice = nullopt;
+		_choice_tags.clear();
+		_choice_tags_begin = 0;
 	}
 
 	void runner_impl::clear_tags()
@@ -273,6 +285,9 @@ namespace ink::runtime::internal
 			_ref_stack.push_frame<type>(address, bEvaluationMode);
 		}
 		bEvaluationMode = false; // unset eval mode when enter function or tunnel
+#ifdef INK_ENABLE_PROFILE
+		_call_profile.push_frame(_container.empty() ? ~0u : _container.top());
+#endif
 
 		// Do the jump
 		inkAssert(_story->instructions() + target < _story->end(), "Diverting past end of story data!");
@@ -285,6 +300,9 @@ namespace ink::runtime::internal
 		_ref_stack.fetch_values(_stack);
 		frame_type type;
 		offset_t offset = _stack.pop_frame(&type,bEvaluationMode);
+#ifdef INK_ENABLE_PROFILE
+		_call_profile.pop_frame();
+#endif
 		_ref_stack.push_values(_stack);
 		{ 	frame_type t; bool eval;
 			// TODO: write all refs to new frame 
@@ -315,8 +333,8 @@ namespace ink::runtime::internal
 		return type;
 	}
 
-	runner_impl::runner_impl(const story_impl* data, globals global)
-		: _story(data), _globals(global.cast<globals_impl>()), _container(~0),
+	runner_impl::runner_impl(const story_impl* data, globals global, const capacities& caps)
+		: _story(data), _capacities(caps), _globals(global.cast<globals_impl>()),
 		_operations(
 				global.cast<globals_impl>()->strings(),
 				global.cast<globals_impl>()->lists(),
@@ -324,7 +342,10 @@ namespace ink::runtime::internal
 				*global.cast<globals_impl>(),
 				*data,
 				static_cast<const runner_interface&>(*this)),
-		_backup(nullptr), _done(nullptr), _choices()
+		_backup(nullptr), _done(nullptr),
+		_stack(caps.runtime_stack), _ref_stack(caps.reference_stack), _eval(caps.eval_stack),
+		_threads(caps.thread_depth), _choices(caps.choices), _tags(caps.tags), _choice_tags(caps.tags),
+		_container(~0, caps.container_depth)
 	{
 		_ptr = _story->instructions();
 		bEvaluationMode = false;
@@ -341,7 +362,7 @@ namespace ink::runtime::internal
 			_globals->initialize_globals(this);
 
 			// Set us back to the beginning of the story
-			reset();
+			reset_state();
 			_ptr = _story->instructions();
 		}
 	}
@@ -350,11 +371,18 @@ namespace ink::runtime::internal
 	{
 		// unregister with globals
 		_globals->remove_runner(this);
+		if (_globals->journal() == &_journal)
+			_globals->set_journal(nullptr);
 	}
 
 #ifdef INK_ENABLE_STL
 	std::string runner_impl::getline()
 	{
+		if (_fast_forward) {
+			skip_line();
+			return "";
+		}
+
 		std::string result{""};
 		bool fill = false;
 		do {
@@ -366,6 +394,8 @@ namespace ink::runtime::internal
 			// Read line into std::string
 			std::string part;
 			_output >> part;
+			if (_recording)
+				_journal.drop();
 			result += part;
 			fill = _output.last_char() == ' ';
 		} while(_ptr != nullptr && _output.last_char() != '\n');
@@ -380,6 +410,11 @@ namespace ink::runtime::internal
 
 	void runner_impl::getline(std::ostream& out)
 	{
+		if (_fast_forward) {
+			skip_line();
+			return;
+		}
+
 		bool fill = false;
 		do {
 			if (fill) { out << " "; }
@@ -387,6 +422,8 @@ namespace ink::runtime::internal
 			advance_line();
 			// Write into out
 			out << _output;
+			if (_recording)
+				_journal.drop();
 			fill = _output.last_char() == ' ';
 		} while(_ptr != nullptr && _output.last_char() != '\n');
 
@@ -415,11 +452,17 @@ namespace ink::runtime::internal
 	void runner_impl::getall(std::ostream& out)
 	{
 		// Advance interpreter until we're stopped
-		while (can_continue())
-			advance_line();
+		while (can_continue()) {
+			if (_fast_forward)
+				skip_line();
+			else
+				advance_line();
+		}
 
 		// Send output into stream
 		out << _output;
+		if (_recording)
+			_journal.drop();
 
 		// Return result
 		inkAssert(_output.is_empty(), "Output should be empty after getall!");
@@ -430,12 +473,18 @@ namespace ink::runtime::internal
 	FString runner_impl::getline()
 	{
 		inkAssert(false, "Fix (see getline for std)");
+		if (_fast_forward) {
+			skip_line();
+			return FString();
+		}
 		// Advance interpreter one line
 		advance_line();
 
 		// Read line into std::string
 		FString result;
 		_output >> result;
+		if (_recording)
+			_journal.drop();
 
 		// Return result
 		inkAssert(_output.is_empty(), "Output should be empty after getline!");
@@ -444,18 +493,77 @@ namespace ink::runtime::internal
 #endif
 
 	void runner_impl::advance_line()
+	{
+		if (_recording)
+			_journal.advance();
+		_last_result = run_result::ok;
+		_last_error = nullptr;
+		// errors are caught once per line instead of once per instruction
+#ifdef INK_ENABLE_EXCEPTIONS
+		try
+		{
+			run_line();
+		}
+		catch (...)
+		{
+			fail(nullptr);
+			throw;
+		}
+#else
+		error_scope scope;
+		if (run_line() != run_result::ok || scope.failed())
+			fail(scope.message());
+#endif
+	}
+
+	void runner_impl::choose(size_t index)
+	{
+		if (_recording)
+			_journal.choose(index);
+		_last_result = run_result::ok;
+		_last_error = nullptr;
+#ifdef INK_ENABLE_EXCEPTIONS
+		try
+		{
+			make_choice(index);
+		}
+		catch (...)
+		{
+			fail(nullptr);
+			throw;
+		}
+#else
+		error_scope scope;
+		if (make_choice(index) != run_result::ok || scope.failed())
+			fail(scope.message());
+#endif
+	}
+
+	void runner_impl::fail(const char* message)
+	{
+		// Reset our whole state as it's probably corrupt
+		reset_state();
+		_last_result = run_result::error;
+		_last_error = message;
+	}
+
+	run_result runner_impl::run_line()
 	{
 		// Step while we still have instructions to execute
 		while (_ptr != nullptr)
 		{
-			// Stop if we hit a new line
-			if (line_step())
+			// Stop if we hit a new line or failed
+			step_result result = line_step();
+			if (result == step_result::error)
+				return run_result::error;
+			if (result == step_result::line_end)
 				break;
 		}
 
 		// can be in save state becaues of choice
 		// Garbage collection TODO: How often do we want to do this?
 		_globals->gc();
+		return run_result::ok;
 	}
 
 	bool runner_impl::can_continue() const
@@ -463,10 +571,11 @@ namespace ink::runtime::internal
 		return _ptr != nullptr;
 	}
 
-	void runner_impl::choose(size_t index)
+	run_result runner_impl::make_choice(size_t index)
 	{
-		if(has_choices()) {
-			inkAssert(index < _choices.size(), "Choice index out of range");
+		if(has_choices() ? index >= _choices.size() : !_fallback_choice) {
+			inkFail("Choice index out of range");
+			return run_result::error;
 		}
 		restore(); // restore to stack state when choice was maked
 		_globals->turn();
@@ -484,7 +593,10 @@ namespace ink::runtime::internal
 			prev = _threads.get(choiceThread);
 
 		// Make sure we have a previous pointer
-		inkAssert(prev != nullptr, "No 'done' point recorded before finishing choice output");
+		if (prev == nullptr) {
+			inkFail("No 'done' point recorded before finishing choice output");
+			return run_result::error;
+		}
 
 		// Move to the previous pointer so we track our movements correctly
 		jump(prev, false);
@@ -500,15 +612,49 @@ namespace ink::runtime::internal
 		if(!_container.empty()){ _globals->visit(_container.top()); }
 		clear_choices();
 		clear_tags();
+		return error_raised() ? run_result::error : run_result::ok;
+	}
+
+	void runner_impl::skip_line()
+	{
+		// like getline, but the output is dropped instead of converted
+		do {
+			advance_line();
+			drop_output();
+		} while(_ptr != nullptr && _output.last_char() != '\n');
+
+		if(!has_choices() && _fallback_choice) { choose(~0); }
+	}
+
+	void runner_impl::drop_output()
+	{
+		// removes what getline would extract
+		_output.skip();
+		if (_recording)
+			_journal.drop();
 	}
 
 	void runner_impl::getline_silent()
 	{
-		// advance and clear output stream
+		// advance without building text and clear output stream
+		bool fast_forward = _fast_forward;
+		_fast_forward = true;
 		advance_line();
+		_fast_forward = fast_forward;
 		_output.clear();
 	}
 
+	const char* runner_impl::choice_text(const char* part, const char* second_part)
+	{
+		// same text as the CHOICE command builds in the output
+		stream<2> text;
+		if (part)
+			text << value{}.set<value_type::string>(part);
+		if (second_part)
+			text << value{}.set<value_type::string>(second_part);
+		return text.get_alloc<true, true>(_globals->strings(), _globals->lists());
+	}
+
 	bool runner_impl::has_tags() const
 	{
 		return _tags.size() > 0;
@@ -521,7 +667,10 @@ namespace ink::runtime::internal
 
 	const char* runner_impl::get_tag(size_t index) const
 	{
-		inkAssert(index < _tags.size(), "Tag index exceeds _num_tags");
+		if (index >= _tags.size()) {
+			inkFail("Tag index exceeds _num_tags");
+			return nullptr;
+		}
 		return _tags[index];
 	}
 
@@ -544,8 +693,11 @@ namespace ink::runtime::internal
 			return false;
 		}
 		
+		if (_recording)
+			_journal.move_to(path);
+
 		// Clear state and move to destination
-		reset();
+		reset_state();
 		_ptr = _story->instructions();
 		jump(destination);
 
@@ -579,12 +731,14 @@ namespace ink::runtime::internal
 			return change_type::extended_past_newline;
 
 		inkFail("Invalid change detction. Never should be here!");
+		return change_type::no_change;
 	}
 
-	bool runner_impl::line_step()
+	runner_impl::step_result runner_impl::line_step()
 	{
 		// Step the interpreter
-		step();
+		if (step() != run_result::ok)
+			return step_result::error;
 
 		// If we're not within string evaluation
 		if (!_output.has_marker())
@@ -599,7 +753,7 @@ namespace ink::runtime::internal
 				case change_type::extended_past_newline:
 					// We've gone too far. Restore to before we moved past the newline and return that we are done
 					restore();
-					return true;
+					return step_result::line_end;
 				case change_type::newline_removed:
 					// Newline was removed. Proceed as if we never hit it
 					forget();
@@ -636,507 +790,561 @@ namespace ink::runtime::internal
 			}
 		}
 
-		return false;
+		return step_result::proceed;
 	}
 
-	void runner_impl::step()
+	run_result runner_impl::step()
 	{
-		try
+		if (_ptr == nullptr)
 		{
-			inkAssert(_ptr != nullptr, "Can not step! Do not have a valid pointer");
+			inkFail("Can not step! Do not have a valid pointer");
+			return run_result::error;
+		}
 
-			// Load current command
-			Command cmd = read<Command>();
-			CommandFlag flag = read<CommandFlag>();
+		// Load current command
+		Command cmd = read<Command>();
+		CommandFlag flag = read<CommandFlag>();
+		INK_PROFILE_COMMAND(_profile, _call_profile, _container.empty() ? ~0u : _container.top(), cmd);
 
-			// If we're falling and we hit a non-fallthrough command, stop the fall.
-			if (_is_falling && !((cmd == Command::DIVERT && flag & CommandFlag::DIVERT_IS_FALLTHROUGH) || cmd == Command::END_CONTAINER_MARKER))
-			{
-				_is_falling = false;
-				set_done_ptr(nullptr);
-			}
-			if (cmd >= Command::OP_BEGIN && cmd < Command::OP_END)
-			{
-				_operations(cmd, _eval);
-			}
-			else switch (cmd)
-			{
-				// == Value Commands ==
-			case Command::STR:
-			{
-				const char* str = read<const char*>();
-				if (bEvaluationMode)
-					_eval.push(value{}.set<value_type::string>(str));
-				else
-					_output << value{}.set<value_type::string>(str);
-			}
-			break;
-			case Command::INT:
-			{
-				int val = read<int>();
-				if (bEvaluationMode)
-					_eval.push(value{}.set<value_type::int32>(val));
-				// TEST-CASE B006 don't print integers
-			}
-			break;
-			case Command::BOOL:
-			{
-				bool val = read<int>() ? true : false;
-				if(bEvaluationMode)
-					_eval.push(value{}.set<value_type::boolean>(val));
-				else
-					_output << value{}.set<value_type::boolean>(val);
-			}
-			break;
-			case Command::FLOAT:
-			{
-				float val = read<float>();
-				if (bEvaluationMode)
-					_eval.push(value{}.set<value_type::float32>(val));
-				// TEST-CASE B006 don't print floats
-			} break;
-			case Command::VALUE_POINTER:
-			{
-				hash_t val = read<hash_t>();
-				if(bEvaluationMode) {
-					_eval.push(value{}.set<value_type::value_pointer>(val, static_cast<char>(flag) - 1));
-				} else {
-					throw ink_exception("never conciderd what should happend here! (value pointer print)");
-				}
+		// If we're falling and we hit a non-fallthrough command, stop the fall.
+		if (_is_falling && !((cmd == Command::DIVERT && flag & CommandFlag::DIVERT_IS_FALLTHROUGH) || cmd == Command::END_CONTAINER_MARKER))
+		{
+			_is_falling = false;
+			set_done_ptr(nullptr);
+		}
+		if (cmd >= Command::OP_BEGIN && cmd < Command::OP_END)
+		{
+			_operations(cmd, _eval);
+		}
+		else switch (cmd)
+		{
+			// == Value Commands ==
+		case Command::STR:
+		{
+			// flags classify the text, see string_type
+			string_type str{read<const char*>(), true, flag};
+			if (bEvaluationMode)
+				_eval.push(value{}.set<value_type::string>(str));
+			else
+				_output << value{}.set<value_type::string>(str);
+		}
+		break;
+		case Command::INT:
+		{
+			int val = read<int>();
+			if (bEvaluationMode)
+				_eval.push(value{}.set<value_type::int32>(val));
+			// TEST-CASE B006 don't print integers
+		}
+		break;
+		case Command::BOOL:
+		{
+			bool val = read<int>() ? true : false;
+			if(bEvaluationMode)
+				_eval.push(value{}.set<value_type::boolean>(val));
+			else
+				_output << value{}.set<value_type::boolean>(val);
+		}
+		break;
+		case Command::FLOAT:
+		{
+			float val = read<float>();
+			if (bEvaluationMode)
+				_eval.push(value{}.set<value_type::float32>(val));
+			// TEST-CASE B006 don't print floats
+		} break;
+		case Command::VALUE_POINTER:
+		{
+			hash_t val = read<hash_t>();
+			if(bEvaluationMode) {
+				_eval.push(value{}.set<value_type::value_pointer>(val, static_cast<char>(flag) - 1));
+			} else {
+				inkFail("never conciderd what should happend here! (value pointer print)");
 			}
-			break;
-			case Command::LIST:
-			{
-				list_table::list list(read<int>());
-				if(bEvaluationMode)
-					_eval.push(value{}.set<value_type::list>(list));
-				else {
-					char* str = _globals->strings().create(_globals->lists().stringLen(
-								list)+1);
-					_globals->lists().toString(str, list)[0] = 0;
-					_output << value{}.set<value_type::string>(str);
-				}
+		}
+		break;
+		case Command::LIST:
+		{
+			list_table::list list(read<int>());
+			if(bEvaluationMode)
+				_eval.push(value{}.set<value_type::list>(list));
+			else if (_fast_forward && !_output.has_marker()) {
+				// the text is dropped, only whether there is some matters
+				_output << value{}.set<value_type::string>(
+						_globals->lists().stringLen(list) ? "list" : "");
+			} else {
+				char* str = _globals->strings().create(_globals->lists().stringLen(
+							list)+1);
+				_globals->lists().toString(str, list)[0] = 0;
+				_output << value{}.set<value_type::string>(str);
 			}
-			break;
-			case Command::DIVERT_VAL:
-			{
-				inkAssert(bEvaluationMode, "Can not push divert value into the output stream!");
+		}
+		break;
+		case Command::DIVERT_VAL:
+		{
+			inkAssert(bEvaluationMode, "Can not push divert value into the output stream!");
 
-				// Push the divert target onto the stack
-				uint32_t target = read<uint32_t>();
-				_eval.push(value{}.set<value_type::divert>(target));
-			}
-			break;
-			case Command::NEWLINE:
-			{
-				if (bEvaluationMode)
-					_eval.push(values::newline);
-				else
-					_output << values::newline;
-			}
-			break;
-			case Command::GLUE:
-			{
-				if (bEvaluationMode)
-					_eval.push(values::glue);
-				else
-					_output << values::glue;
-			}
-			break;
-			case Command::VOID:
-			{
-				if (bEvaluationMode)
-					_eval.push(values::null); // TODO: void type?
-			}
-			break;
+			// Push the divert target onto the stack
+			uint32_t target = read<uint32_t>();
+			_eval.push(value{}.set<value_type::divert>(target));
+		}
+		break;
+		case Command::NEWLINE:
+		{
+			if (bEvaluationMode)
+				_eval.push(values::newline);
+			else
+				_output << values::newline;
+		}
+		break;
+		case Command::GLUE:
+		{
+			if (bEvaluationMode)
+				_eval.push(values::glue);
+			else
+				_output << values::glue;
+		}
+		break;
+		case Command::VOID:
+		{
+			if (bEvaluationMode)
+				_eval.push(values::null); // TODO: void type?
+		}
+		break;
+
+		// == Divert commands
+		case Command::DIVERT:
+		{
+			// Find divert address
+			uint32_t target = read<uint32_t>();
 
-			// == Divert commands
-			case Command::DIVERT:
+			// Check for condition
+			if (flag & CommandFlag::DIVERT_HAS_CONDITION && !_eval.pop().get<value_type::boolean>())
+				break;
+
+			// SPECIAL: Fallthrough divert. We're starting to fall out of containers
+			if (flag & CommandFlag::DIVERT_IS_FALLTHROUGH && !_is_falling)
 			{
-				// Find divert address
-				uint32_t target = read<uint32_t>();
+				// Record the position of the instruction pointer at the first fallthrough.
+				//  We'll use this if we run out of content and hit an implied "done" to restore
+				//  our position when a choice is chosen. See ::choose
+				set_done_ptr(_ptr);
+				_is_falling = true;
+			}
 
-				// Check for condition
-				if (flag & CommandFlag::DIVERT_HAS_CONDITION && !_eval.pop().get<value_type::boolean>())
-					break;
+			// If we're falling out of the story, then we're hitting an implied done 
+			if (_is_falling && _story->instructions() + target == _story->end()) {
+				// Wait! We may be returning from a function!
+				frame_type type;
+				if (_stack.has_frame(&type) && type == frame_type::function) // implicit return is only for functions
+				{
+					// push null and return
+					_eval.push(values::null);
 
-				// SPECIAL: Fallthrough divert. We're starting to fall out of containers
-				if (flag & CommandFlag::DIVERT_IS_FALLTHROUGH && !_is_falling)
+					// HACK
+					_ptr += sizeof(Command) + sizeof(CommandFlag);
+					execute_return();
+				}
+				else 
 				{
-					// Record the position of the instruction pointer at the first fallthrough.
-					//  We'll use this if we run out of content and hit an implied "done" to restore
-					//  our position when a choice is chosen. See ::choose
-					set_done_ptr(_ptr);
-					_is_falling = true;
+					on_done(false);
 				}
+				break;
+			}
 
-				// If we're falling out of the story, then we're hitting an implied done 
-				if (_is_falling && _story->instructions() + target == _story->end()) {
-					// Wait! We may be returning from a function!
-					frame_type type;
-					if (_stack.has_frame(&type) && type == frame_type::function) // implicit return is only for functions
-					{
-						// push null and return
-						_eval.push(values::null);
+			// Do the jump
+			inkAssert(_story->instructions() + target < _story->end(), "Diverting past end of story data!");
+			jump(_story->instructions() + target);
+		}
+		break;
+		case Command::DIVERT_TO_VARIABLE:
+		{
+			// Get variable value
+			hash_t variable = read<hash_t>();
 
-						// HACK
-						_ptr += sizeof(Command) + sizeof(CommandFlag);
-						execute_return();
-					}
-					else 
-					{
-						on_done(false);
-					}
-					break;
-				}
+			// Check for condition
+			if (flag & CommandFlag::DIVERT_HAS_CONDITION && !_eval.pop().get<value_type::boolean>())
+				break;
 
-				// Do the jump
-				inkAssert(_story->instructions() + target < _story->end(), "Diverting past end of story data!");
-				jump(_story->instructions() + target);
+			const value* val = get_var(variable);
+			if (val == nullptr) {
+				inkFail("Jump destiniation needs to be defined!");
+				break;
 			}
-			break;
-			case Command::DIVERT_TO_VARIABLE:
-			{
-				// Get variable value
-				hash_t variable = read<hash_t>();
 
-				// Check for condition
-				if (flag & CommandFlag::DIVERT_HAS_CONDITION && !_eval.pop().get<value_type::boolean>())
-					break;
-
-				const value* val = get_var(variable);
-				inkAssert(val, "Jump destiniation needs to be defined!");
+			// Move to location
+			jump(_story->instructions() + val->get<value_type::divert>());
+			inkAssert(_ptr < _story->end(), "Diverted past end of story data!");
+		}
+		break;
 
-				// Move to location
-				jump(_story->instructions() + val->get<value_type::divert>());
-				inkAssert(_ptr < _story->end(), "Diverted past end of story data!");
-			}
+		// == Terminal commands
+		case Command::DONE:
+			on_done(true);
 			break;
 
-			// == Terminal commands
-			case Command::DONE:
-				on_done(true);
-				break;
-
-			case Command::END:
-				_ptr = nullptr;
-				break;
+		case Command::END:
+			_ptr = nullptr;
+			break;
 
-			// == Tunneling
-			case Command::TUNNEL:
-			{
-				uint32_t target;
-				// Find divert address
-				if(flag & CommandFlag::TUNNEL_TO_VARIABLE) {
-					hash_t var_name = read<hash_t>();
-					const value* val = get_var(var_name);
-					inkAssert(val != nullptr);
-					target = val->get<value_type::divert>();
-				} else {
-					target = read<uint32_t>();
+		// == Tunneling
+		case Command::TUNNEL:
+		{
+			uint32_t target;
+			// Find divert address
+			if(flag & CommandFlag::TUNNEL_TO_VARIABLE) {
+				hash_t var_name = read<hash_t>();
+				const value* val = get_var(var_name);
+				if (val == nullptr) {
+					inkFail("Divert target needs to be defined!");
+					break;
 				}
-				start_frame<frame_type::tunnel>(target);
+				target = val->get<value_type::divert>();
+			} else {
+				target = read<uint32_t>();
 			}
-			break;
-			case Command::FUNCTION:
-			{
-				uint32_t target;
-				// Find divert address
-				if(flag & CommandFlag::FUNCTION_TO_VARIABLE) {
-					hash_t var_name = read<hash_t>();
-					const value* val = get_var(var_name);
-					inkAssert(val != nullptr);
-					target  = val->get<value_type::divert>();
-				} else {
-					target = read<uint32_t>();
+			start_frame<frame_type::tunnel>(target);
+		}
+		break;
+		case Command::FUNCTION:
+		{
+			uint32_t target;
+			// Find divert address
+			if(flag & CommandFlag::FUNCTION_TO_VARIABLE) {
+				hash_t var_name = read<hash_t>();
+				const value* val = get_var(var_name);
+				if (val == nullptr) {
+					inkFail("Divert target needs to be defined!");
+					break;
 				}
-				start_frame<frame_type::function>(target);
+				target  = val->get<value_type::divert>();
+			} else {
+				target = read<uint32_t>();
 			}
-			break;
-			case Command::TUNNEL_RETURN:
-			case Command::FUNCTION_RETURN:
+			start_frame<frame_type::function>(target);
+		}
+		break;
+		case Command::TUNNEL_RETURN:
+		case Command::FUNCTION_RETURN:
+		{
+			execute_return();
+		}
+		break;
+
+		case Command::THREAD:
+		{
+			// Push a thread frame so we can return easily
+			// TODO We push ahead of a single divert. Is that correct in all cases....?????
+			auto returnTo = _ptr + CommandSize<uint32_t>;
+			_stack.push_frame<frame_type::thread>(returnTo - _story->instructions(), bEvaluationMode);
+			_ref_stack.push_frame<frame_type::thread>(returnTo - _story->instructions(), bEvaluationMode);
+
+			// Fork a new thread on the callstack
+			thread_t thread = _stack.fork_thread();
 			{
-				execute_return();
+				thread_t t = _ref_stack.fork_thread();
+				inkAssert(t == thread, "ref_stack and stack should be in sync!");
 			}
-			break;
 
-			case Command::THREAD:
-			{
-				// Push a thread frame so we can return easily
-				// TODO We push ahead of a single divert. Is that correct in all cases....?????
-				auto returnTo = _ptr + CommandSize<uint32_t>;
-				_stack.push_frame<frame_type::thread>(returnTo - _story->instructions(), bEvaluationMode);
-				_ref_stack.push_frame<frame_type::thread>(returnTo - _story->instructions(), bEvaluationMode);
-
-				// Fork a new thread on the callstack
-				thread_t thread = _stack.fork_thread();
-				{
-					thread_t t = _ref_stack.fork_thread();
-					inkAssert(t == thread, "ref_stack and stack should be in sync!");
-				}
+			// Push that thread onto our thread stack
+			_threads.push(thread);
+		}
+		break;
 
-				// Push that thread onto our thread stack
-				_threads.push(thread);
-			}
-			break;
+		// == set temporärie variable
+		case Command::DEFINE_TEMP:
+		{
+			hash_t variableName = read<hash_t>();
+			bool is_redef = flag & CommandFlag::ASSIGNMENT_IS_REDEFINE;
 
-			// == set temporärie variable
-			case Command::DEFINE_TEMP:
-			{
-				hash_t variableName = read<hash_t>();
-				bool is_redef = flag & CommandFlag::ASSIGNMENT_IS_REDEFINE;
+			// Get the top value and put it into the variable
+			value v = _eval.pop();
+			set_var<Scope::LOCAL>(variableName, v, is_redef);
+		}
+		break;
 
-				// Get the top value and put it into the variable
-				value v = _eval.pop();
-				set_var<Scope::LOCAL>(variableName, v, is_redef);
+		case Command::SET_VARIABLE:
+		{
+			hash_t variableName = read<hash_t>();
+
+			// Check if it's a redefinition (not yet used, seems important for pointers later?)
+			bool is_redef = flag & CommandFlag::ASSIGNMENT_IS_REDEFINE;
+
+			// If not, we're setting a global (temporary variables are explicitely defined as such,
+			//  where globals are defined using SET_VARIABLE).
+			value val = _eval.pop();
+			if(is_redef) {
+				set_var(variableName, val, is_redef);
+			} else {
+				set_var<Scope::GLOBAL>(variableName, val, is_redef);
 			}
-			break;
+		}
+		break;
 
-			case Command::SET_VARIABLE:
-			{
-				hash_t variableName = read<hash_t>();
+		// == Function calls
+		case Command::CALL_EXTERNAL:
+		{
+			// Read function name
+			hash_t functionName = read<hash_t>();
 
-				// Check if it's a redefinition (not yet used, seems important for pointers later?)
-				bool is_redef = flag & CommandFlag::ASSIGNMENT_IS_REDEFINE;
+			// Interpret flag as argument count
+			int numArguments = (int)flag;
 
-				// If not, we're setting a global (temporary variables are explicitely defined as such,
-				//  where globals are defined using SET_VARIABLE).
-				value val = _eval.pop();
-				if(is_redef) {
-					set_var(variableName, val, is_redef);
-				} else {
-					set_var<Scope::GLOBAL>(variableName, val, is_redef);
-				}
+			// A replay returns what the function returned when it was recorded
+			bool success = false;
+			if (_replay == nullptr)
+			{
+				// find and execute. will automatically push a valid if applicable
+				success = _functions.call(functionName, &_eval, numArguments, _globals->strings());
 			}
-			break;
 
-			// == Function calls
-			case Command::CALL_EXTERNAL:
+			// If we failed, we need to at least pretend so our state doesn't get fucked
+			if (!success)
 			{
-				// Read function name
-				hash_t functionName = read<hash_t>();
-
-				// Interpret flag as argument count
-				int numArguments = (int)flag;
+				// pop arguments
+				for (int i = 0; i < numArguments; i++)
+					_eval.pop();
 
-				// find and execute. will automatically push a valid if applicable
-				bool success = _functions.call(functionName, &_eval, numArguments, _globals->strings());
+				// push void or the recorded value
+				_eval.push(_replay ? replay_external() : value());
+			}
 
-				// If we failed, we need to at least pretend so our state doesn't get fucked
-				if (!success)
-				{
-					// pop arguments
-					for (int i = 0; i < numArguments; i++)
-						_eval.pop();
+			if (_recording)
+				_journal.external(_eval.top_value());
 
-					// push void
-					_eval.push(value());
-				}
+			// TODO: Verify something was found?
+		}
+		break;
 
-				// TODO: Verify something was found?
-			}
+		// == Evaluation stack
+		case Command::START_EVAL:
+			bEvaluationMode = true;
 			break;
+		case Command::END_EVAL:
+			bEvaluationMode = false;
 
-			// == Evaluation stack
-			case Command::START_EVAL:
-				bEvaluationMode = true;
-				break;
-			case Command::END_EVAL:
-				bEvaluationMode = false;
-
-				// Assert stack is empty? Is that necessary?
-				break;
-			case Command::OUTPUT:
-			{
-				value v = _eval.pop();
-				_output << v;
-			}
+			// Assert stack is empty? Is that necessary?
 			break;
-			case Command::POP:
-				_eval.pop();
-				break;
-			case Command::DUPLICATE:
-				_eval.push(_eval.top_value());
-				break;
-			case Command::PUSH_VARIABLE_VALUE:
-			{
-				// Try to find in local stack
-				hash_t variableName = read<hash_t>();
-				const value* val = get_var(variableName);
+		case Command::OUTPUT:
+		{
+			value v = _eval.pop();
+			_output << v;
+		}
+		break;
+		case Command::POP:
+			_eval.pop();
+			break;
+		case Command::DUPLICATE:
+			_eval.push(_eval.top_value());
+			break;
+		case Command::PUSH_VARIABLE_VALUE:
+		{
+			// Try to find in local stack
+			hash_t variableName = read<hash_t>();
+			const value* val = get_var(variableName);
 
-				inkAssert(val != nullptr, "Could not find variable!");
-				_eval.push(*val);
+			if (val == nullptr) {
+				inkFail("Could not find variable!");
 				break;
 			}
-			case Command::START_STR:
-			{
-				inkAssert(bEvaluationMode, "Can not enter string mode while not in evaluation mode!");
-				bEvaluationMode = false;
-				_output << values::marker;
-			} break;
-			case Command::END_STR:
-			{
-				// TODO: Assert we really had a marker on there?
-				inkAssert(!bEvaluationMode, "Must be in evaluation mode");
-				bEvaluationMode = true;
-
-				// Load value from output stream
-				// Push onto stack
-				_eval.push(value{}.set<value_type::string>(_output.get_alloc<false>(
-								_globals->strings(),
-								_globals->lists())));
-			} break;
-
-			// == Choice commands
-			case Command::CHOICE:
-			{
-				// Read path
-				uint32_t path = read<uint32_t>();
-
-				// If we're a once only choice, make sure our destination hasn't
-				//  been visited
-				if (flag & CommandFlag::CHOICE_IS_ONCE_ONLY) {
-					// Need to convert offset to container index
-					container_t destination = -1;
-					if (_story->get_container_id(_story->instructions() + path, destination))
-					{
-						// Ignore the choice if we've visited the destination before
-						if (_globals->visits(destination) > 0)
-							break;
-					}
-					else
-					{
-						inkAssert(false, "Destination for choice block does not have counting flags.");
-					}
-				}
-
-				// Choice is conditional
-				if (flag & CommandFlag::CHOICE_HAS_CONDITION) {
-					// Only show if the top of the eval stack is 'truthy'
-					if (!_eval.pop().get<value_type::boolean>())
+			_eval.push(*val);
+			break;
+		}
+		case Command::START_STR:
+		{
+			inkAssert(bEvaluationMode, "Can not enter string mode while not in evaluation mode!");
+			bEvaluationMode = false;
+			if (flag & CommandFlag::STRING_EVAL_IS_CHOICE_TEXT)
+				++_choice_text_depth;
+			_output << values::marker;
+		} break;
+		case Command::END_STR:
+		{
+			// TODO: Assert we really had a marker on there?
+			inkAssert(!bEvaluationMode, "Must be in evaluation mode");
+			bEvaluationMode = true;
+			if (flag & CommandFlag::STRING_EVAL_IS_CHOICE_TEXT)
+				--_choice_text_depth;
+
+			// Load value from output stream
+			// Push onto stack
+			_eval.push(value{}.set<value_type::string>(_output.get_alloc<false>(
+							_globals->strings(),
+							_globals->lists())));
+		} break;
+
+		// == Choice commands
+		case Command::CHOICE:
+		{
+			// Read path
+			uint32_t path = read<uint32_t>();
+
+			// Tags in the text belong to this choice, also if it is not shown
+			uint32_t tags_begin = static_cast<uint32_t>(_choice_tags_begin);
+			_choice_tags_begin = _choice_tags.size();
+			uint32_t tags_end = static_cast<uint32_t>(_choice_tags_begin);
+
+			// If we're a once only choice, make sure our destination hasn't
+			//  been visited
+			if (flag & CommandFlag::CHOICE_IS_ONCE_ONLY) {
+				// Need to convert offset to container index
+				container_t destination = -1;
+				if (_story->get_container_id(_story->instructions() + path, destination))
+				{
+					// Ignore the choice if we've visited the destination before
+					if (_globals->visits(destination) > 0)
 						break;
 				}
+				else
+				{
+					inkAssert(false, "Destination for choice block does not have counting flags.");
+				}
+			}
 
-				// Use a marker to start compiling the choice text
-				_output << values::marker;
-				value stack[2];
-				int sc = 0;
+			// Choice is conditional
+			if (flag & CommandFlag::CHOICE_HAS_CONDITION) {
+				// Only show if the top of the eval stack is 'truthy'
+				if (!_eval.pop().get<value_type::boolean>())
+					break;
+			}
 
-				if (flag & CommandFlag::CHOICE_HAS_START_CONTENT) {
-					stack[sc++] = _eval.pop();
-				}
-				if (flag & CommandFlag::CHOICE_HAS_CHOICE_ONLY_CONTENT) {
-					stack[sc++] = _eval.pop();
-				}
-				for(;sc;--sc) { _output << stack[sc-1]; }
+			value stack[2];
+			int sc = 0;
 
-				// Create choice and record it
+			if (flag & CommandFlag::CHOICE_HAS_START_CONTENT) {
+				stack[sc++] = _eval.pop();
+			}
+			if (flag & CommandFlag::CHOICE_HAS_CHOICE_ONLY_CONTENT) {
+				stack[sc++] = _eval.pop();
+			}
+
+			if (_fast_forward) {
+				// keep the parts, the text is built if it is asked for
+				const char* parts[2] = { nullptr, nullptr };
+				for (int i = 0; sc; --sc, ++i) { parts[i] = stack[sc-1].get<value_type::string>(); }
 				if (flag & CommandFlag::CHOICE_IS_INVISIBLE_DEFAULT) {
-					_fallback_choice
-						= choice{}.setup(_output, _globals->strings(), _globals->lists(), _choices.size(), path, current_thread());
+					_fallback_choice = choice{}.setup_lazy(parts[0], parts[1], _choices.size(), path, current_thread(),
+						this, tags_begin, tags_end);
 				} else {
-					add_choice().setup(_output, _globals->strings(), _globals->lists(), _choices.size(), path, current_thread());
+					add_choice().setup_lazy(parts[0], parts[1], _choices.size(), path, current_thread(),
+						this, tags_begin, tags_end);
 				}
-				// save stack at last choice
 				if(_saved) { forget(); }
 				save();
-			} break;
-			case Command::START_CONTAINER_MARKER:
-			{
-				// Keep track of current container
-				_container.push(read<uint32_t>());
+				break;
+			}
 
-				// Increment visit count
-				if (flag & CommandFlag::CONTAINER_MARKER_TRACK_VISITS)
-				{
-					_globals->visit(_container.top());
-				}
+			// Use a marker to start compiling the choice text
+			_output << values::marker;
+			for(;sc;--sc) { _output << stack[sc-1]; }
 
-				// TODO Turn counts
-			} break;
-			case Command::END_CONTAINER_MARKER:
+			// Create choice and record it
+			if (flag & CommandFlag::CHOICE_IS_INVISIBLE_DEFAULT) {
+				_fallback_choice
+					= choice{}.setup(_output, _globals->strings(), _globals->lists(), _choices.size(), path, current_thread(),
+						this, tags_begin, tags_end);
+			} else {
+				add_choice().setup(_output, _globals->strings(), _globals->lists(), _choices.size(), path, current_thread(),
+					this, tags_begin, tags_end);
+			}
+			// save stack at last choice
+			if(_saved) { forget(); }
+			save();
+		} break;
+		case Command::START_CONTAINER_MARKER:
+		{
+			// Keep track of current container
+			_container.push(read<uint32_t>());
+
+			// Increment visit count
+			if (flag & CommandFlag::CONTAINER_MARKER_TRACK_VISITS)
 			{
-				container_t index = read<container_t>();
-				inkAssert(_container.top() == index, "Leaving container we are not in!");
+				_globals->visit(_container.top());
+			}
 
-				// Move up out of the current container
-				_container.pop();
+			// TODO Turn counts
+		} break;
+		case Command::END_CONTAINER_MARKER:
+		{
+			container_t index = read<container_t>();
+			inkAssert(_container.top() == index, "Leaving container we are not in!");
 
-				// SPECIAL: If we've popped all containers, then there's an implied 'done' command or return
-				if (_container.empty())
-				{
-					_is_falling = false;
+			// Move up out of the current container
+			_container.pop();
 
-					frame_type type;
-					if (!_threads.empty())
-					{
-						on_done(false);
-						return;
-					}
-					else if (_stack.has_frame(&type) && type == frame_type::function) // implicit return is only for functions
-					{
-						// push null and return
-						_eval.push(values::null);
+			// SPECIAL: If we've popped all containers, then there's an implied 'done' command or return
+			if (_container.empty())
+			{
+				_is_falling = false;
 
-						// HACK
-						_ptr += sizeof(Command) + sizeof(CommandFlag);
-						execute_return();
-					}
-					/*else TODO I had to remove this to make a test work.... is this important? Have I broken something?
-					{
-						on_done(false); // do we need to not set _done here? It wasn't set in the original code #implieddone
-						return;
-					}*/
+				frame_type type;
+				if (!_threads.empty())
+				{
+					on_done(false);
+					break;
 				}
-			} break;
-			case Command::VISIT:
-			{
-				// Push the visit count for the current container to the top
-				//  is 0-indexed for some reason. idk why but this is what ink expects
-				_eval.push(value{}.set<value_type::int32>((int)_globals->visits(_container.top()) - 1));
-			} break;
-			case Command::SEQUENCE:
-			{
-				// TODO: The C# ink runtime does a bunch of fancy logic
-				//  to make sure each element is picked at least once in every
-				//  iteration loop. I don't feel like replicating that right now.
-				// So, let's just return a random number and *shrug*
-				int sequenceLength = _eval.pop().get<value_type::int32>();
-				int index = _eval.pop().get<value_type::int32>();
-
-				_eval.push(value{}.set<value_type::int32>(_rng.rand(sequenceLength)));
-			} break;
-			case Command::SEED:
-			{
-				int32_t seed = _eval.pop().get<value_type::int32>();
-				_rng.srand(seed);
+				else if (_stack.has_frame(&type) && type == frame_type::function) // implicit return is only for functions
+				{
+					// push null and return
+					_eval.push(values::null);
 
-				_eval.push(values::null);
-			} break;
+					// HACK
+					_ptr += sizeof(Command) + sizeof(CommandFlag);
+					execute_return();
+				}
+				/*else TODO I had to remove this to make a test work.... is this important? Have I broken something?
+				{
+					on_done(false); // do we need to not set _done here? It wasn't set in the original code #implieddone
+					return;
+				}*/
+			}
+		} break;
+		case Command::VISIT:
+		{
+			// Push the visit count for the current container to the top
+			//  is 0-indexed for some reason. idk why but this is what ink expects
+			_eval.push(value{}.set<value_type::int32>((int)_globals->visits(_container.top()) - 1));
+		} break;
+		case Command::SEQUENCE:
+		{
+			// TODO: The C# ink runtime does a bunch of fancy logic
+			//  to make sure each element is picked at least once in every
+			//  iteration loop. I don't feel like replicating that right now.
+			// So, let's just return a random number and *shrug*
+			int sequenceLength = _eval.pop().get<value_type::int32>();
+			int index = _eval.pop().get<value_type::int32>();
+
+			_eval.push(value{}.set<value_type::int32>(_rng.rand(sequenceLength)));
+		} break;
+		case Command::SEED:
+		{
+			int32_t seed = _eval.pop().get<value_type::int32>();
+			_rng.srand(seed);
 
-			case Command::READ_COUNT:
-			{
-				// Get container index
-				container_t container = read<container_t>();
+			_eval.push(values::null);
+		} break;
 
-				// Push the read count for the requested container index
-				_eval.push(value{}.set<value_type::int32>((int)_globals->visits(container)));
-			} break;
-			case Command::TAG:
-			{
-				_tags.push() = read<const char*>();
-			} break;
-			default:
-				inkAssert(false, "Unrecognized command!");
-				break;
-			}
-		}
-		catch (...)
+		case Command::READ_COUNT:
 		{
-			// Reset our whole state as it's probably corrupt
-			reset();
-			throw;
+			// Get container index
+			container_t container = read<container_t>();
+
+			// Push the read count for the requested container index
+			_eval.push(value{}.set<value_type::int32>((int)_globals->visits(container)));
+		} break;
+		case Command::TAG:
+		{
+			// tags in the text of a choice belong to the choice
+			if (_choice_text_depth > 0)
+				_choice_tags.push() = read<const char*>();
+			else
+				_tags.push() = read<const char*>();
+		} break;
+		default:
+			inkFail("Unrecognized command!");
+			break;
 		}
+		return error_raised() ? run_result::error : run_result::ok;
 	}
 
 	void runner_impl::on_done(bool setDone)
@@ -1179,6 +1387,34 @@ namespace ink::runtime::internal
 
 	void runner_impl::reset()
 	{
+		if (_recording)
+			_journal.reset();
+
+		// the store may have been reset to declarations which need a runner
+		if (!_globals->are_globals_initialized())
+		{
+			// replaying the reset runs them again, they are not recorded
+			bool recording = _recording;
+			_recording = false;
+			_globals->initialize_globals(this);
+			_recording = recording;
+		}
+
+		reset_state();
+		clear_tags();
+		_backup_choice_len = 0;
+		_backup_choice_tags_len = 0;
+		_is_falling = false;
+		bSavedEvaluationMode = false;
+		_backup = nullptr;
+		_rng = prng{};
+		_ptr = _story->instructions();
+	}
+
+	void runner_impl::reset_state()
+	{
+		// keep what ran after the save point, the globals are shared
+		forget();
 		_eval.clear();
 		_output.clear();
 		_stack.clear();
@@ -1187,9 +1423,15 @@ namespace ink::runtime::internal
 		bEvaluationMode = false;
 		_saved = false;
 		_choices.clear();
+		_choice_tags.clear();
+		_choice_tags_begin = 0;
+		_choice_text_depth = 0;
 		_ptr = nullptr;
 		_done = nullptr;
 		_container.clear();
+#ifdef INK_ENABLE_PROFILE
+		_call_profile.clear_frames();
+#endif
 	}
 
 	void runner_impl::mark_strings(string_table& strings) const
@@ -1200,14 +1442,24 @@ namespace ink::runtime::internal
 		// ref_stack has no strings!
 		_eval.mark_strings(strings);
 
-		// Take into account choice text
+		// Take into account choice text, or its parts if it is not built yet
+		auto mark_choice = [](string_table& strings, const choice& c) {
+			strings.mark_used(c._text);
+			strings.mark_used(c._parts[0]);
+			strings.mark_used(c._parts[1]);
+		};
 		for (int i = 0; i < _choices.size(); i++)
-			strings.mark_used(_choices[i]._text);
+			mark_choice(strings, _choices[i]);
+		if (_fallback_choice)
+			mark_choice(strings, *_fallback_choice);
 	}
 
 	void runner_impl::save()
 	{
-		inkAssert(!_saved, "Runner state already saved");
+		if (_saved) {
+			inkFail("Runner state already saved");
+			return;
+		}
 
 		_saved = true;
 		_output.save();
@@ -1219,6 +1471,7 @@ namespace ink::runtime::internal
 		_eval.save();
 		_threads.save();
 		_backup_choice_len = _choices.size();
+		_backup_choice_tags_len = _choice_tags.size();
 		bSavedEvaluationMode = bEvaluationMode;
 
 		// Not doing this anymore. There can be lingering stack entries from function returns
@@ -1227,7 +1480,10 @@ namespace ink::runtime::internal
 
 	void runner_impl::restore()
 	{
-		inkAssert(_saved, "Can't restore. No runner state saved.");
+		if (!_saved) {
+			inkFail("Can't restore. No runner state saved.");
+			return;
+		}
 		// the output can be restored without the rest
 		if(_output.saved()) {_output.restore(); }
 		_stack.restore();
@@ -1238,6 +1494,9 @@ namespace ink::runtime::internal
 		_eval.restore();
 		_threads.restore();
 		_choices.resize(_backup_choice_len);
+		_choice_tags.resize(_backup_choice_tags_len);
+		_choice_tags_begin = _choice_tags.size();
+		_choice_text_depth = 0;
 		bEvaluationMode = bSavedEvaluationMode;
 
 		// Not doing this anymore. There can be lingering stack entries from function returns
@@ -1252,7 +1511,8 @@ namespace ink::runtime::internal
 		if (!_saved)
 			return;
 
-		_output.forget();
+		// the output can be restored or forgotten without the rest
+		if(_output.saved()) { _output.forget(); }
 		_stack.forget();
 		_ref_stack.forget();
 		_container.forget();
@@ -1265,6 +1525,264 @@ namespace ink::runtime::internal
 		_saved = false;
 	}
 
+	snapshot* runner_impl::create_snapshot() const
+	{
+		const runner_impl* self = this;
+		return snapshot_impl::create(*_globals.get(), &self, 1, _globals->next_snapshot_id());
+	}
+
+	runner runner_impl::fork()
+	{
+		return _story->fork(*this, *_globals, _alloc, _capacities);
+	}
+
+	void runner_impl::start_journal()
+	{
+		_journal.start(*_story, _rng.state());
+		_recording = true;
+		_globals->set_journal(&_journal);
+	}
+
+	void runner_impl::stop_journal()
+	{
+		if (_globals->journal() == &_journal)
+			_globals->set_journal(nullptr);
+		_recording = false;
+		_journal.clear();
+	}
+
+	journal* runner_impl::create_journal() const
+	{
+		if (!_recording)
+			return nullptr;
+		size_t length;
+		unsigned char* data = _journal.copy(length);
+		return new journal_impl(data, length, true);
+	}
+
+	void runner_impl::replay(const journal& log)
+	{
+		const journal_impl& data = static_cast<const journal_impl&>(log);
+#ifdef INK_ENABLE_EXCEPTIONS
+		data.check_story(*_story);
+#else
+		error_scope scope;
+		data.check_story(*_story);
+		if (scope.failed())
+		{
+			_last_result = run_result::error;
+			_last_error = scope.message();
+			return;
+		}
+#endif
+		journal_reader reader(data);
+
+		// the replay only needs the control flow
+		bool fast_forward = _fast_forward;
+		_fast_forward = true;
+		_replay = &reader;
+#ifdef INK_ENABLE_EXCEPTIONS
+		try
+		{
+			run_replay(reader);
+		}
+		catch (...)
+		{
+			_replay = nullptr;
+			_fast_forward = fast_forward;
+			fail(nullptr);
+			throw;
+		}
+#else
+		run_replay(reader);
+		if (scope.failed())
+			fail(scope.message());
+#endif
+		_replay = nullptr;
+		_fast_forward = fast_forward;
+	}
+
+	void runner_impl::run_replay(journal_reader& reader)
+	{
+		while (!reader.done() && _last_result == run_result::ok && !error_raised())
+		{
+			switch (reader.next())
+			{
+			case journal_entry::seed:
+			{
+				uint32_t seed = reader.read_u32();
+				if (_recording && seed != _rng.state())
+					_journal.seed(seed);
+				_rng.srand(static_cast<int32_t>(seed));
+			} break;
+			case journal_entry::lines:
+				for (uint64_t n = reader.read_varint(); n > 0 && _last_result == run_result::ok; --n)
+				{
+					advance_line();
+					drop_output();
+				}
+				break;
+			case journal_entry::advances:
+				for (uint64_t n = reader.read_varint(); n > 0 && _last_result == run_result::ok; --n)
+					advance_line();
+				break;
+			case journal_entry::drops:
+				for (uint64_t n = reader.read_varint(); n > 0; --n)
+					drop_output();
+				break;
+			case journal_entry::choose:
+				// 0 is the fallback choice, ~0
+				choose(static_cast<size_t>(reader.read_varint()) - 1);
+				break;
+			case journal_entry::external:
+				inkFail("Journal does not match the story: external function result outside of a line");
+				return;
+			case journal_entry::set_global:
+			{
+				hash_t name = reader.read_u32();
+				_globals->set_recorded(name, reader.read_value());
+			} break;
+			case journal_entry::move_to:
+				move_to(reader.read_u32());
+				break;
+			case journal_entry::reset:
+				reset();
+				break;
+			case journal_entry::reset_globals:
+				_globals->reset();
+				break;
+			}
+		}
+	}
+
+	value runner_impl::replay_external()
+	{
+		value val = _replay->external();
+		if (val.type() != value_type::string)
+			return val;
+
+		// the string points into the journal, keep a copy
+		const char* src = val.get<value_type::string>();
+		size_t len = internal::c_str_len(src);
+		char* str = _globals->strings().create(len + 1);
+		for (size_t i = 0; i <= len; ++i)
+			str[i] = src[i];
+		return value{}.set<value_type::string>(static_cast<const char*>(str), true);
+	}
+
+#if defined(INK_ENABLE_PROFILE) && defined(INK_ENABLE_STL)
+	void runner_impl::write_folded_stacks(std::ostream& out, bool count_commands) const
+	{
+		_call_profile.write_folded(out, *_story, count_commands);
+	}
+#endif
+
+	void runner_impl::snap(snapper& snapper) const
+	{
+		snapper.write(_ptr);
+		snapper.write(_backup);
+		snapper.write(_done);
+
+		_output.snap(snapper);
+		_stack.snap(snapper);
+		_ref_stack.snap(snapper);
+		snapper.write(bEvaluationMode);
+		snapper.write(bSavedEvaluationMode);
+		_eval.snap(snapper);
+		_threads.snap(snapper);
+
+		// choices
+		auto snap_choice = [&snapper](const choice& c) {
+			snapper.write(c.text());
+			snapper.write(c._index);
+			snapper.write(c._path);
+			snapper.write(c._thread);
+			snapper.write(c._tags_begin);
+			snapper.write(c._tags_end);
+		};
+		snapper.write(_choices.size());
+		for (const choice& c : _choices)
+			snap_choice(c);
+		snapper.write(_fallback_choice.has_value());
+		if (_fallback_choice)
+			snap_choice(*_fallback_choice);
+		snapper.write(_backup_choice_len);
+
+		// tags
+		snapper.write(_tags.size());
+		for (const char* tag : _tags)
+			snapper.write(tag);
+		snapper.write(_choice_tags.size());
+		for (const char* tag : _choice_tags)
+			snapper.write(tag);
+		snapper.write(_choice_tags_begin);
+		snapper.write(_backup_choice_tags_len);
+
+		_container.snap(snapper);
+		snapper.write(_is_falling);
+		snapper.write(_saved);
+		_rng.snap(snapper);
+	}
+
+	void runner_impl::snap_load(loader& loader)
+	{
+		loader.read(_ptr);
+		loader.read(_backup);
+		loader.read(_done);
+
+		_output.snap_load(loader);
+		_stack.snap_load(loader);
+		_ref_stack.snap_load(loader);
+		loader.read(bEvaluationMode);
+		loader.read(bSavedEvaluationMode);
+		_eval.snap_load(loader);
+		_threads.snap_load(loader);
+
+		// choices
+		auto load_choice = [&loader, this](choice& c) {
+			loader.read(c._text);
+			loader.read(c._index);
+			loader.read(c._path);
+			loader.read(c._thread);
+			loader.read(c._tags_begin);
+			loader.read(c._tags_end);
+			c._runner = this;
+		};
+		size_t num_choices;
+		loader.read(num_choices);
+		_choices.clear();
+		for (size_t i = 0; i < num_choices; ++i)
+			load_choice(add_choice());
+		bool has_fallback;
+		loader.read(has_fallback);
+		_fallback_choice = nullopt;
+		if (has_fallback)
+		{
+			choice c;
+			load_choice(c);
+			_fallback_choice = c;
+		}
+		loader.read(_backup_choice_len);
+
+		// tags
+		size_t num_tags;
+		loader.read(num_tags);
+		_tags.clear();
+		for (size_t i = 0; i < num_tags; ++i)
+			loader.read(_tags.push());
+		loader.read(num_tags);
+		_choice_tags.clear();
+		for (size_t i = 0; i < num_tags; ++i)
+			loader.read(_choice_tags.push());
+		loader.read(_choice_tags_begin);
+		loader.read(_backup_choice_tags_len);
+
+		_container.snap_load(loader);
+		loader.read(_is_falling);
+		loader.read(_saved);
+		_rng.snap_load(loader);
+	}
+
 #ifdef INK_ENABLE_STL
 	std::ostream& operator<<(std::ostream& out, runner_impl& in)
 	{
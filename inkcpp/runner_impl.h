@@ -13,27 +13,34 @@
 #include "list_table.h"
 #include "array.h"
 #include "random.h"
+#include "journal_impl.h"
 
 #include "runner.h"
+#include "capacities.h"
 #include "choice.h"
 
 #include "executioner.h"
+#include "profiler.h"
 
 namespace ink::runtime::internal
 {
 	class story_impl;
 	class globals_impl;
 
-	class runner_impl : public runner_interface
+	class runner_impl : public runner_interface, public heap_object<alloc_category::story>
 	{
 	public:
 		// Creates a new runner at the start of a loaded ink story
-		runner_impl(const story_impl*, globals);
+		runner_impl(const story_impl*, globals, const capacities&);
 		virtual ~runner_impl();
 
 		// used by the globals object to do garbage collection
 		void mark_strings(string_table&) const;
 
+		// == Snapshots ==
+		void snap(snapper&) const;
+		void snap_load(loader&);
+
 #pragma region runner Implementation
 
 		// Checks that the runner can continue
@@ -48,6 +55,42 @@ namespace ink::runtime::internal
 		// Chooses a choice by index
 		virtual void choose(size_t index) override;
 
+		// Creates a snapshot of this runner and its globals
+		virtual snapshot* create_snapshot() const override;
+
+		// Creates a copy of this runner with its own globals
+		virtual runner fork() override;
+
+		// == Journal ==
+		virtual void start_journal() override;
+		virtual void stop_journal() override;
+		virtual journal* create_journal() const override;
+		virtual void replay(const journal&) override;
+
+		virtual globals get_globals() override { return _globals.cast<globals_interface>(); }
+
+		virtual allocator* get_allocator() const override { return _alloc; }
+
+		// Returns to the start of the story, keeping allocated memory
+		virtual void reset() override;
+
+		virtual void set_fast_forward(bool enable) override { _fast_forward = enable; }
+		virtual bool is_fast_forward() const override { return _fast_forward; }
+
+		virtual run_result last_result() const override { return _last_result; }
+		virtual const char* last_error() const override { return _last_error; }
+
+		// Capacities this runner was created with
+		const capacities& get_capacities() const { return _capacities; }
+
+#ifdef INK_ENABLE_PROFILE
+		virtual const profile& get_profile() const override { return _profile; }
+		virtual void reset_profile() override { _profile.reset(); _call_profile.reset(); }
+#ifdef INK_ENABLE_STL
+		virtual void write_folded_stacks(std::ostream&, bool count_commands = false) const override;
+#endif
+#endif
+
 		// runs silently
 		void getline_silent();
 
@@ -55,6 +98,12 @@ namespace ink::runtime::internal
 		virtual size_t num_tags() const override;
 		virtual const char* get_tag(size_t index) const override;
 
+		// Joins the text of a choice made while fast-forwarding, see choice::text
+		const char* choice_text(const char* part, const char* second_part);
+
+		// Tag in the text of a choice of this turn, see choice::get_tag
+		const char* get_choice_tag(size_t index) const { return _choice_tags[index]; }
+
 
 #ifdef INK_ENABLE_CSTD
 		// c-style getline
@@ -87,17 +136,37 @@ namespace ink::runtime::internal
 		virtual void internal_bind(hash_t name, internal::function_base* function) override;
 	private:
 		// Advances the interpreter by a line. This fills the output buffer
+		//  Resets the state and records the error if the line fails
 		void advance_line();
+		run_result run_line();
+
+		// Advances by a line and drops the output unread
+		void skip_line();
+		// Drops the output a getline would extract
+		void drop_output();
+
+		// Runs the entries of a journal, see replay
+		void run_replay(journal_reader&);
+		// Next recorded return value of an external function
+		value replay_external();
+
+		// Moves to the chosen branch, see choose
+		run_result make_choice(size_t index);
+
+		// Resets the state after an error and records it
+		void fail(const char* message);
+
+		enum class step_result { proceed, line_end, error };
 
 		// Steps the interpreter a single instruction and returns
-		//  when it has hit a new line
-		bool line_step();
+		//  whether it has hit a new line or failed
+		step_result line_step();
 
 		// Steps the interpreter a single instruction
-		void step();
+		run_result step();
 
-		// Resets the runtime
-		void reset();
+		// Clears the execution state
+		void reset_state();
 
 		// == Save/Restore
 		void save();
@@ -148,6 +217,8 @@ namespace ink::runtime::internal
 
 	private:
 		const story_impl* const _story;
+		allocator* const _alloc = current_allocator();
+		const capacities _capacities;
 		story_ptr<globals_impl> _globals;
 		executer _operations;
 
@@ -177,17 +248,20 @@ namespace ink::runtime::internal
 			static constexpr size_t N = abs(config::limitThreadDepth);
 		public:
 			template<bool ... D, bool con = dynamic,  enable_if_t<con, bool> = true >
-			threads()
+			threads(size_t capacity = N)
 				: base(nullptr, 0, ~0),
+				_stack(capacity),
 				_threadDone(nullptr, reinterpret_cast<ip_t>(~0)) {
 					static_assert(sizeof...(D) == 0, "Don't use explicit template arguments!");
 			}
 			template<bool ... D, bool con = dynamic, enable_if_t<!con, bool> = true >
-			threads()
-				: _stack{},
-				base(_stack.data(), N, ~0),
+			threads(size_t capacity = N)
+				: base(nullptr, 0, ~0),
+				_stack(capacity),
 				_threadDone(nullptr, reinterpret_cast<ip_t>(~0)) {
 					static_assert(sizeof...(D) == 0, "Don't use explicit template arguments");
+					// _stack exists only now, and clamps the capacity to N
+					base::initialize_data(_stack.data(), _stack.capacity());
 					_threadDone.clear(nullptr);
 				}
 
@@ -208,6 +282,23 @@ namespace ink::runtime::internal
 				_threadDone.forget();
 			}
 
+			template<typename Snapper>
+			void snap(Snapper& snapper) const {
+				base::snap(snapper);
+				snapper.write(_threadDone.capacity());
+				_threadDone.snap(snapper);
+			}
+			template<typename Loader>
+			void snap_load(Loader& loader) {
+				base::snap_load(loader);
+				size_t capacity;
+				loader.read(capacity);
+				if (capacity > _threadDone.capacity()) {
+					resize(capacity, 0);
+				}
+				_threadDone.snap_load(loader);
+			}
+
 			void set(size_t index, const ip_t& value) {
 				_threadDone.set(index, value);
 			}
@@ -232,13 +323,35 @@ namespace ink::runtime::internal
 		} _threads;
 
 		// Choice list
-		managed_array<choice, config::maxChoices < 0, abs(config::maxChoices)> _choices;
+		managed_array<choice, config::maxChoices < 0, abs(config::maxChoices), alloc_category::choices> _choices;
 		optional<choice> _fallback_choice;
-		size_t _backup_choice_len;
+		size_t _backup_choice_len = 0;
 
 		// Tag list
 		managed_array<const char*, config::limitActiveTags < 0, abs(config::limitActiveTags)> _tags;
 
+		// Tags in the text of the choices of this turn. Each choice has a range,
+		//  tags from _choice_tags_begin on belong to the next choice
+		managed_array<const char*, config::limitActiveTags < 0, abs(config::limitActiveTags)> _choice_tags;
+		size_t _choice_tags_begin = 0;
+		size_t _backup_choice_tags_len = 0;
+
+		// nesting of string evaluations building choice text, tags in them are choice tags
+		int _choice_text_depth = 0;
+
+		// skip text, see set_fast_forward
+		bool _fast_forward = false;
+
+		// journal of the host input, see start_journal
+		journal_writer _journal;
+		bool _recording = false;
+		// journal being replayed, external functions read their results from it
+		journal_reader* _replay = nullptr;
+
+		// outcome of the last getline or choose
+		run_result _last_result = run_result::ok;
+		const char* _last_error = nullptr;
+
 		// TODO: Move to story? Both?
 		functions _functions;
 
@@ -249,6 +362,11 @@ namespace ink::runtime::internal
 		bool _saved = false;
 
 		prng _rng{};
+
+#ifdef INK_ENABLE_PROFILE
+		profile _profile;
+		call_profile _call_profile;
+#endif
 	};
 
 	inline void runner_impl::threads::overflow(thread_t*& buffer, size_t& size) {
@@ -27,9 +27,36 @@ namespace ink::runtime::internal
 		void restore();
 		void forget();
 
+		// == Snapshots ==
+		template<typename Snapper>
+		void snap(Snapper& snapper) const
+		{
+			snapper.write(_pos);
+			snapper.write(_save);
+			snapper.write(_jump);
+			for (size_t i = 0; i < used(); ++i)
+				snapper.write(_buffer[i]);
+		}
+		template<typename Loader>
+		void snap_load(Loader& loader)
+		{
+			loader.read(_pos);
+			loader.read(_save);
+			loader.read(_jump);
+			while (_size < used())
+			{
+				size_t size = _size;
+				overflow(_buffer, _size);
+				if (_size == size)
+					return;
+			}
+			for (size_t i = 0; i < used(); ++i)
+				loader.read(_buffer[i]);
+		}
+
 	protected:
 		virtual void overflow(T*& buffer, size_t& size) {
-			throw ink_exception("Stack overflow!");
+			inkFail("Stack overflow!");
 		}
 
 		void initialize_data(T* buffer, size_t size) {
@@ -39,6 +66,9 @@ namespace ink::runtime::internal
 			_size = size;
 		}
 	private:
+		// Number of buffer elements in use, including saved ones past _pos
+		size_t used() const { return _save != InvalidIndex && _save > _pos ? _save : _pos; }
+
 		T* _buffer;
 		size_t _size;
 		const T _null;
@@ -55,11 +85,12 @@ namespace ink::runtime::internal
 		using base = simple_restorable_stack<T>;
 	public:
 		template<bool ... D, bool con = dynamic, enable_if_t<con, bool> = true>
-		managed_restorable_stack(const T& null) : simple_restorable_stack<T>(nullptr, 0, null) { }
+		managed_restorable_stack(const T& null, size_t capacity = N)
+			: simple_restorable_stack<T>(nullptr, 0, null), _stack(capacity) { }
 		template<bool ... D, bool con = dynamic, enable_if_t<!con, bool> = true>
-		managed_restorable_stack(const T& null) :
-			simple_restorable_stack<T>(nullptr, 0, null), _stack{}
-		{ base::initialize_data(_stack.data(), N); }
+		managed_restorable_stack(const T& null, size_t capacity = N) :
+			simple_restorable_stack<T>(nullptr, 0, null), _stack(capacity)
+		{ base::initialize_data(_stack.data(), _stack.capacity()); }
 		virtual void overflow(T*& buffer, size_t& size) override final {
 			if constexpr (dynamic) {
 				if (buffer) {
@@ -79,7 +110,10 @@ namespace ink::runtime::internal
 	template<typename T>
 	inline void simple_restorable_stack<T>::push(const T& value)
 	{
-		inkAssert(value != _null, "Can not push a 'null' value onto the stack.");
+		if (value == _null) {
+			inkFail("Can not push a 'null' value onto the stack.");
+			return;
+		}
 
 		// Don't overwrite saved data. Jump over it and record where we jumped from
 		if (_save != InvalidIndex && _pos < _save)
@@ -90,6 +124,8 @@ namespace ink::runtime::internal
 
 		if (_pos >= _size) {
 			overflow(_buffer, _size);
+			if (_pos >= _size)
+				return;
 		}
 
 		// Push onto the top of the stack
@@ -99,7 +135,10 @@ namespace ink::runtime::internal
 	template<typename T>
 	inline T simple_restorable_stack<T>::pop()
 	{
-		inkAssert(_pos > 0, "Nothing left to pop!");
+		if (_pos == 0) {
+			inkFail("Nothing left to pop!");
+			return _null;
+		}
 
 		// Move over jump area
 		if (_pos == _save) {
@@ -115,11 +154,17 @@ namespace ink::runtime::internal
 	{
 		if (_pos == _save)
 		{
-			inkAssert(_jump > 0, "Stack is empty! No top()");
+			if (_jump == 0) {
+				inkFail("Stack is empty! No top()");
+				return _null;
+			}
 			return _buffer[_jump - 1];
 		}
 
-		inkAssert(_pos > 0, "Stack is empty! No top()");
+		if (_pos == 0) {
+			inkFail("Stack is empty! No top()");
+			return _null;
+		}
 		return _buffer[_pos - 1];
 	}
 
@@ -171,7 +216,7 @@ namespace ink::runtime::internal
 		iterator--;
 
 		// Skip nulls
-		while (*iterator == _null)
+		while (iterator >= _buffer && *iterator == _null)
 			iterator--;
 
 		// End
@@ -187,7 +232,10 @@ namespace ink::runtime::internal
 	template<typename T>
 	inline void simple_restorable_stack<T>::save()
 	{
-		inkAssert(_save == InvalidIndex, "Can not save stack twice! restore() or forget() first");
+		if (_save != InvalidIndex) {
+			inkFail("Can not save stack twice! restore() or forget() first");
+			return;
+		}
 
 		// Save current stack position
 		_save = _jump = _pos;
@@ -196,7 +244,10 @@ namespace ink::runtime::internal
 	template<typename T>
 	inline void simple_restorable_stack<T>::restore()
 	{
-		inkAssert(_save != InvalidIndex, "Can not restore() when there is no save!");
+		if (_save == InvalidIndex) {
+			inkFail("Can not restore() when there is no save!");
+			return;
+		}
 
 		// Move position back to saved position
 		_pos = _save;
@@ -206,7 +257,10 @@ namespace ink::runtime::internal
 	template<typename T>
 	inline void simple_restorable_stack<T>::forget()
 	{
-		inkAssert(_save != InvalidIndex, "Can not forget when the stack has never been saved!");
+		if (_save == InvalidIndex) {
+			inkFail("Can not forget when the stack has never been saved!");
+			return;
+		}
 
 		/*// If we have moven to a point earlier than the save point but we have a jump point
 		if (_pos < _save && _pos > _jump)
@@ -0,0 +1,649 @@
+#include "snapshot_impl.h"
+#include "story_impl.h"
+#include "globals_impl.h"
+#include "runner_impl.h"
+#include "string_table.h"
+#include "stack.h"
+#include "value.h"
+#include "platform.h"
+#include "error.h"
+
+#ifdef INK_ENABLE_STL
+#include <memory>
+#endif
+
+namespace ink::runtime
+{
+	snapshot* snapshot::from_binary(const unsigned char* data, size_t length, bool freeOnDestroy, load_result* result)
+	{
+		return internal::checked_create(result, [=]() -> snapshot* {
+			return new internal::snapshot_impl(data, length, freeOnDestroy);
+		});
+	}
+
+#ifdef INK_ENABLE_STL
+	snapshot* snapshot::from_file(const char* filename, load_result* result)
+	{
+		return internal::checked_create(result, [filename]() -> snapshot* {
+			std::ifstream ifs(filename, std::ios::binary | std::ios::ate);
+			if (!ifs.is_open()) {
+				inkFail("Failed to open snapshot file");
+				return nullptr;
+			}
+
+			size_t length = static_cast<size_t>(ifs.tellg());
+			std::unique_ptr<unsigned char[]> data{new unsigned char[length]};
+			ifs.seekg(0, std::ios::beg);
+			ifs.read(reinterpret_cast<char*>(data.get()), length);
+			ifs.close();
+
+			// the snapshot only owns the buffer once it loaded
+			snapshot* loaded = new internal::snapshot_impl(data.get(), length, true);
+			if (!internal::error_raised())
+				data.release();
+			return loaded;
+		});
+	}
+
+	bool snapshot::write_to_file(const char* filename) const
+	{
+		std::ofstream ofs(filename, std::ios::binary);
+		if (!ofs.is_open()) {
+			inkFail("Failed to open file to write snapshot");
+			return false;
+		}
+		ofs.write(reinterpret_cast<const char*>(get_data()), get_data_len());
+		return true;
+	}
+#endif
+}
+
+namespace ink::runtime::internal
+{
+	namespace
+	{
+		// String encodings
+		enum class string_kind : unsigned char
+		{
+			null,      // nullptr
+			story,     // offset into the story binary
+			dynamic,   // index into the snapshot string section
+			inline_str // string data follows (not owned by anyone we know of)
+		};
+
+		// Instruction pointer encodings for the two special values in use
+		constexpr uint32_t NullIp = ~0u;
+		constexpr uint32_t InvalidIp = ~0u - 1;
+	}
+
+	string_id_map::string_id_map()
+		: _alloc(current_allocator()), _slots(nullptr), _capacity(64), _size(0)
+	{
+		_slots = new_array<slot>(_alloc, alloc_category::snapshots, _capacity);
+	}
+
+	string_id_map::~string_id_map()
+	{
+		delete_array(_alloc, alloc_category::snapshots, _slots, _capacity);
+	}
+
+	size_t string_id_map::index_of(const char* str) const
+	{
+		// linear probing from a fibonacci hash of the address
+		uint64_t hash = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(str)) * 11400714819323198485ull;
+		size_t index = static_cast<size_t>(hash >> 32) & (_capacity - 1);
+		while (_slots[index].str != nullptr && _slots[index].str != str)
+			index = (index + 1) & (_capacity - 1);
+		return index;
+	}
+
+	bool string_id_map::find(const char* str, uint32_t& id) const
+	{
+		const slot& s = _slots[index_of(str)];
+		if (s.str == nullptr)
+			return false;
+		id = s.id;
+		return true;
+	}
+
+	bool string_id_map::insert(const char* str, uint32_t id)
+	{
+		inkAssert(str != nullptr, "Can not map a null string");
+		// keep the load factor below one half
+		if ((_size + 1) * 2 > _capacity)
+			grow();
+
+		slot& s = _slots[index_of(str)];
+		if (s.str != nullptr)
+			return false;
+		s.str = str;
+		s.id = id;
+		++_size;
+		return true;
+	}
+
+	void string_id_map::grow()
+	{
+		slot* old_slots = _slots;
+		size_t old_capacity = _capacity;
+
+		_capacity *= 2;
+		_slots = new_array<slot>(_alloc, alloc_category::snapshots, _capacity);
+		for (size_t i = 0; i < old_capacity; ++i)
+		{
+			if (old_slots[i].str != nullptr)
+				_slots[index_of(old_slots[i].str)] = old_slots[i];
+		}
+		delete_array(_alloc, alloc_category::snapshots, old_slots, old_capacity);
+	}
+
+	snapper::snapper(const story_impl& story, const string_table& strings)
+		: _story(story), _strings(strings), _alloc(current_allocator()), _data(nullptr), _size(0), _capacity(0)
+	{
+		reserve(512);
+	}
+
+	snapper::~snapper()
+	{
+		deallocate(_alloc, alloc_category::snapshots, _data, _capacity);
+	}
+
+	void snapper::reserve(size_t length)
+	{
+		if (_size + length <= _capacity)
+			return;
+
+		size_t new_capacity = _capacity < 256 ? 256 : _capacity;
+		while (new_capacity < _size + length)
+			new_capacity = new_capacity * 3 / 2;
+
+		unsigned char* new_data = static_cast<unsigned char*>(allocate(_alloc, alloc_category::snapshots, new_capacity, 1));
+		for (size_t i = 0; i < _size; ++i)
+			new_data[i] = _data[i];
+		deallocate(_alloc, alloc_category::snapshots, _data, _capacity);
+		_data = new_data;
+		_capacity = new_capacity;
+	}
+
+	void snapper::write_raw(const void* data, size_t length)
+	{
+		reserve(length);
+		const unsigned char* src = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < length; ++i)
+			_data[_size + i] = src[i];
+		_size += length;
+	}
+
+	void snapper::write(ip_t ptr)
+	{
+		if (ptr == nullptr)
+			write(NullIp);
+		else if (ptr == reinterpret_cast<ip_t>(~0))
+			write(InvalidIp);
+		else
+		{
+			inkAssert(ptr >= _story.data() && ptr <= _story.end(), "Instruction pointer outside of story data");
+			write(static_cast<uint32_t>(ptr - _story.data()));
+		}
+	}
+
+	void snapper::write(const char* str)
+	{
+		const unsigned char* ptr = reinterpret_cast<const unsigned char*>(str);
+		if (str == nullptr)
+		{
+			write(string_kind::null);
+		}
+		else if (ptr >= _story.data() && ptr < _story.end())
+		{
+			write(string_kind::story);
+			write(static_cast<uint32_t>(ptr - _story.data()));
+		}
+		else if (_strings.contains(str))
+		{
+			// number strings by first appearance
+			uint32_t id;
+			if (!_string_ids.find(str, id))
+			{
+				id = _string_list.size();
+				_string_list.push() = str;
+				bool inserted = _string_ids.insert(str, id);
+				inkAssert(inserted, "Dynamic string numbered twice in snapshot");
+			}
+			write(string_kind::dynamic);
+			write(id);
+		}
+		else
+		{
+			write(string_kind::inline_str);
+			size_t len = 0;
+			while (str[len]) { ++len; }
+			write_raw(str, len + 1);
+		}
+	}
+
+	void snapper::write(const value& val)
+	{
+		write(static_cast<unsigned char>(val.type()));
+		switch (val.type())
+		{
+		case value_type::boolean:
+			write(val.get<value_type::boolean>());
+			break;
+		case value_type::uint32:
+			write(val.get<value_type::uint32>());
+			break;
+		case value_type::int32:
+			write(val.get<value_type::int32>());
+			break;
+		case value_type::float32:
+			write(val.get<value_type::float32>());
+			break;
+		case value_type::divert:
+			write(val.get<value_type::divert>());
+			break;
+		case value_type::thread_end:
+			write(val.get<value_type::thread_end>());
+			break;
+		case value_type::list:
+			write(val.get<value_type::list>().lid);
+			break;
+		case value_type::list_flag:
+		{
+			list_flag flag = val.get<value_type::list_flag>();
+			write(flag.list_id);
+			write(flag.flag);
+		} break;
+		case value_type::string:
+		{
+			string_type str = val.get<value_type::string>();
+			write(str.allocated);
+			write(str.str);
+		} break;
+		case value_type::value_pointer: // shares its id with marker
+		{
+			auto pointer = val.get<value_type::value_pointer>();
+			write(pointer.name);
+			write(pointer.ci);
+		} break;
+		case value_type::tunnel_frame:
+		case value_type::function_frame:
+		case value_type::thread_frame:
+		{
+			auto frame = val.get<value_type::function_frame>();
+			write(frame.addr);
+			write(frame.eval);
+		} break;
+		case value_type::thread_start:
+		case value_type::jump_marker:
+		{
+			auto jump = val.get<value_type::jump_marker>();
+			write(jump.jump);
+			write(jump.thread_id);
+		} break;
+		default:
+			// no payload
+			break;
+		}
+	}
+
+	void snapper::write(const entry& e)
+	{
+		write(e.name);
+		write(e.data);
+	}
+
+	const unsigned char* snapper::finish(size_t& length)
+	{
+		write(static_cast<uint32_t>(_string_list.size()));
+		for (const char* str : _string_list)
+		{
+			size_t len = 0;
+			while (str[len]) { ++len; }
+			write_raw(str, len + 1);
+		}
+
+		length = _size;
+		return _data;
+	}
+
+	loader::loader(const story_impl& story, string_table& strings, const snapshot_impl& snap, size_t offset)
+		: loader(story, strings, snap.get_data(), snap.get_data_len(), snap.strings_offset())
+	{
+		if (offset > snap.get_data_len()) {
+			inkFail("Snapshot section outside of snapshot data");
+			offset = snap.get_data_len();
+		}
+		_ptr = snap.get_data() + offset;
+		_snapshot_id = snap.id();
+	}
+
+	loader::loader(const story_impl& story, string_table& strings, const unsigned char* data, size_t length, size_t strings_offset)
+		: _story(story)
+		, _strings(strings)
+		, _ptr(data + strings_offset)
+		, _end(data + length)
+		, _snapshot_id(0)
+	{
+		// Duplicate all dynamic strings into the string table
+		uint32_t count = read<uint32_t>();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const char* str = reinterpret_cast<const char*>(_ptr);
+			while (_ptr < _end && *_ptr) { ++_ptr; }
+			if (_ptr == _end) {
+				inkFail("Snapshot string section is truncated");
+				break;
+			}
+			++_ptr;
+			_string_list.push() = _strings.duplicate(str);
+		}
+
+		_ptr = data;
+	}
+
+	void loader::read_raw(void* data, size_t length)
+	{
+		if (_ptr + length > _end) {
+			inkFail("Unexpected end of snapshot data");
+			zero_memory(data, length);
+			_ptr = _end;
+			return;
+		}
+		unsigned char* dst = static_cast<unsigned char*>(data);
+		for (size_t i = 0; i < length; ++i)
+			dst[i] = _ptr[i];
+		_ptr += length;
+	}
+
+	void loader::read(ip_t& ptr)
+	{
+		uint32_t offset = read<uint32_t>();
+		if (offset == NullIp)
+			ptr = nullptr;
+		else if (offset == InvalidIp)
+			ptr = reinterpret_cast<ip_t>(~0);
+		else
+		{
+			if (offset > _story.length()) {
+				inkFail("Snapshot instruction pointer outside of story data");
+				ptr = nullptr;
+				return;
+			}
+			ptr = _story.data() + offset;
+		}
+	}
+
+	void loader::read(const char*& str)
+	{
+		switch (read<string_kind>())
+		{
+		case string_kind::null:
+			str = nullptr;
+			break;
+		case string_kind::story:
+		{
+			uint32_t offset = read<uint32_t>();
+			if (offset >= _story.length()) {
+				inkFail("Snapshot string outside of story data");
+				str = nullptr;
+				break;
+			}
+			str = reinterpret_cast<const char*>(_story.data() + offset);
+		} break;
+		case string_kind::dynamic:
+		{
+			uint32_t id = read<uint32_t>();
+			if (id >= _string_list.size()) {
+				inkFail("Snapshot string index out of range");
+				str = nullptr;
+				break;
+			}
+			str = _string_list[id];
+		} break;
+		case string_kind::inline_str:
+		{
+			const char* data = reinterpret_cast<const char*>(_ptr);
+			while (_ptr < _end && *_ptr) { ++_ptr; }
+			if (_ptr == _end) {
+				inkFail("Snapshot string is truncated");
+				str = nullptr;
+				break;
+			}
+			++_ptr;
+			str = _strings.duplicate(data);
+		} break;
+		default:
+			inkFail("Invalid string encoding in snapshot");
+			str = nullptr;
+		}
+	}
+
+	void loader::read(value& val)
+	{
+		value_type type = static_cast<value_type>(read<unsigned char>());
+		switch (type)
+		{
+		case value_type::boolean:
+			val.set<value_type::boolean>(read<bool>());
+			break;
+		case value_type::uint32:
+			val.set<value_type::uint32>(read<uint32_t>());
+			break;
+		case value_type::int32:
+			val.set<value_type::int32>(read<int32_t>());
+			break;
+		case value_type::float32:
+			val.set<value_type::float32>(read<float>());
+			break;
+		case value_type::divert:
+			val.set<value_type::divert>(read<uint32_t>());
+			break;
+		case value_type::thread_end:
+			val.set<value_type::thread_end>(read<uint32_t>());
+			break;
+		case value_type::list:
+			val.set<value_type::list>(list_table::list(read<int>()));
+			break;
+		case value_type::list_flag:
+		{
+			list_flag flag;
+			read(flag.list_id);
+			read(flag.flag);
+			val.set<value_type::list_flag>(flag);
+		} break;
+		case value_type::string:
+		{
+			bool allocated = read<bool>();
+			const char* str;
+			read(str);
+			val.set<value_type::string>(str, allocated);
+		} break;
+		case value_type::value_pointer:
+		{
+			hash_t name = read<hash_t>();
+			int ci = read<char>();
+			val.set<value_type::value_pointer>(name, ci);
+		} break;
+		case value_type::tunnel_frame:
+		{
+			uint32_t addr = read<uint32_t>();
+			val.set<value_type::tunnel_frame>(addr, read<bool>());
+		} break;
+		case value_type::function_frame:
+		{
+			uint32_t addr = read<uint32_t>();
+			val.set<value_type::function_frame>(addr, read<bool>());
+		} break;
+		case value_type::thread_frame:
+		{
+			uint32_t addr = read<uint32_t>();
+			val.set<value_type::thread_frame>(addr, read<bool>());
+		} break;
+		case value_type::thread_start:
+		{
+			uint32_t jump = read<uint32_t>();
+			val.set<value_type::thread_start>(jump, read<uint32_t>());
+		} break;
+		case value_type::jump_marker:
+		{
+			uint32_t jump = read<uint32_t>();
+			val.set<value_type::jump_marker>(jump, read<uint32_t>());
+		} break;
+		case value_type::none:       val.set<value_type::none>(); break;
+		case value_type::newline:    val.set<value_type::newline>(); break;
+		case value_type::glue:       val.set<value_type::glue>(); break;
+		case value_type::func_start: val.set<value_type::func_start>(); break;
+		case value_type::func_end:   val.set<value_type::func_end>(); break;
+		case value_type::null:       val.set<value_type::null>(); break;
+		default:
+			inkFail("Invalid value type in snapshot");
+		}
+	}
+
+	void loader::read(entry& e)
+	{
+		read(e.name);
+		read(e.data);
+	}
+
+	snapshot_impl::snapshot_impl(const unsigned char* data, size_t length, bool manage)
+		: _data(data), _length(length), _managed(false), _num_runners(0)
+	{
+		// parse header
+		auto field = [this](size_t offset) {
+			uint32_t val;
+			for (size_t i = 0; i < sizeof(uint32_t); ++i)
+				reinterpret_cast<unsigned char*>(&val)[i] = _data[offset + i];
+			return val;
+		};
+		if (_length < HeaderSize || field(0) != Magic) {
+			inkFail("Data is not an ink snapshot");
+			return;
+		}
+		uint32_t endian_version = field(4);
+		uint16_t endian = static_cast<uint16_t>(endian_version & 0xFFFF);
+		uint16_t version = static_cast<uint16_t>(endian_version >> 16);
+		if (endian != 0x0001) {
+			inkFail("Snapshot was created on a machine with different endianness");
+			return;
+		}
+		if (version != Version) {
+			inkFail("Snapshot version mismatch: snapshot was created by a different InkCpp-version");
+			return;
+		}
+		_fingerprint = field(8);
+		if (field(12) != _length) {
+			inkFail("Snapshot data length does not match its header");
+			return;
+		}
+		_strings_offset = field(16);
+		_num_runners = field(20);
+		_id = field(IdOffset);
+		_base = field(28);
+		if (_strings_offset > _length || HeaderSize + _num_runners * sizeof(uint32_t) > _length) {
+			inkFail("Snapshot header is corrupt");
+			_num_runners = 0;
+			return;
+		}
+
+		// a snapshot which failed to load leaves the data to the caller
+		_managed = manage;
+	}
+
+	snapshot_impl::~snapshot_impl()
+	{
+		if (_managed)
+			delete[] _data;
+		_data = nullptr;
+	}
+
+	uint64_t snapshot_impl::state_hash() const
+	{
+		// FNV-1a over everything but the id
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < _length; ++i)
+		{
+			if (i >= IdOffset && i < IdOffset + sizeof(uint32_t))
+				continue;
+			hash = (hash ^ _data[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool snapshot_impl::check_story(const story_impl& story) const
+	{
+		if (story.fingerprint() != _fingerprint) {
+			inkFail("Snapshot was created from a different story");
+			return false;
+		}
+		return true;
+	}
+
+	size_t snapshot_impl::globals_offset() const
+	{
+		return HeaderSize + _num_runners * sizeof(uint32_t);
+	}
+
+	size_t snapshot_impl::runner_offset(size_t index) const
+	{
+		if (index >= _num_runners) {
+			inkFail("Snapshot runner index out of range");
+			return _length;
+		}
+		uint32_t offset;
+		const unsigned char* src = _data + HeaderSize + index * sizeof(uint32_t);
+		for (size_t i = 0; i < sizeof(uint32_t); ++i)
+			reinterpret_cast<unsigned char*>(&offset)[i] = src[i];
+		return offset;
+	}
+
+	snapshot_impl* snapshot_impl::create(const globals_impl& globals, const runner_impl* const* runners, size_t num_runners,
+		uint32_t id, uint32_t base)
+	{
+		const story_impl& story = globals.story();
+		snapper out(story, globals.strings());
+
+		// header
+		out.write(Magic);
+		out.write(static_cast<uint16_t>(0x0001));
+		out.write(Version);
+		out.write(story.fingerprint());
+		size_t length_pos = out.pos();
+		out.write(static_cast<uint32_t>(0));
+		size_t strings_pos = out.pos();
+		out.write(static_cast<uint32_t>(0));
+		out.write(static_cast<uint32_t>(num_runners));
+		out.write(id);
+		out.write(base);
+		size_t runners_pos = out.pos();
+		for (size_t i = 0; i < num_runners; ++i)
+			out.write(static_cast<uint32_t>(0));
+
+		// sections
+		if (base == NoBase)
+			globals.snap(out);
+		else
+			globals.snap_changed(out, base);
+		for (size_t i = 0; i < num_runners; ++i)
+		{
+			out.patch(runners_pos + i * sizeof(uint32_t), static_cast<uint32_t>(out.pos()));
+			runners[i]->snap(out);
+		}
+		out.patch(strings_pos, static_cast<uint32_t>(out.pos()));
+
+		// string section is appended last, so fix up the length afterwards
+		size_t length;
+		const unsigned char* blob = out.finish(length);
+
+		// the snapshot owns an exactly sized copy, freed with delete[] like loaded ones
+		unsigned char* data = new unsigned char[length];
+		for (size_t i = 0; i < length; ++i)
+			data[i] = blob[i];
+		uint32_t len32 = length;
+		for (size_t i = 0; i < sizeof(uint32_t); ++i)
+			data[length_pos + i] = reinterpret_cast<const unsigned char*>(&len32)[i];
+
+		return new snapshot_impl(data, length, true);
+	}
+}
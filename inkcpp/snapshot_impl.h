@@ -0,0 +1,221 @@
+#pragma once
+
+#include "snapshot.h"
+#include "system.h"
+#include "array.h"
+#include "allocator.h"
+
+#include <type_traits>
+
+namespace ink::runtime::internal
+{
+	class story_impl;
+	class globals_impl;
+	class runner_impl;
+	class string_table;
+	class value;
+	struct entry;
+
+	// Hash map from dynamic strings to their snapshot ids. Grows as needed
+	class string_id_map
+	{
+	public:
+		string_id_map();
+		~string_id_map();
+
+		// == Non-Copyable ==
+		string_id_map(const string_id_map&) = delete;
+		string_id_map& operator=(const string_id_map&) = delete;
+
+		bool find(const char* str, uint32_t& id) const;
+
+		// Returns false if the string already has an id
+		bool insert(const char* str, uint32_t id);
+
+	private:
+		struct slot
+		{
+			const char* str = nullptr;
+			uint32_t id = 0;
+		};
+
+		size_t index_of(const char* str) const;
+		void grow();
+
+		allocator* _alloc;
+		slot* _slots;
+		size_t _capacity; // power of two
+		size_t _size;
+	};
+
+	/**
+	 * Writes runtime state into a growing byte buffer.
+	 *
+	 * Plain data is written as is. Instruction pointers and strings from the
+	 * story are written as offsets into the story binary. Dynamic strings are
+	 * numbered in the order they are first written and collected into a string
+	 * section, which is appended by finish(). This keeps snapshots of equal
+	 * states byte-identical, independent of where things live in memory.
+	 */
+	class snapper
+	{
+	public:
+		snapper(const story_impl& story, const string_table& strings);
+		~snapper();
+
+		// == Non-Copyable ==
+		snapper(const snapper&) = delete;
+		snapper& operator=(const snapper&) = delete;
+
+		// Writes plain data
+		template<typename T>
+		void write(const T& data)
+		{
+			static_assert(!std::is_pointer_v<T>, "Pointers need a dedicated snapshot encoding");
+			write_raw(&data, sizeof(T));
+		}
+
+		void write(const value&);
+		void write(const entry&);
+		void write(ip_t);
+		void write(const char*);
+
+		// Current write position
+		size_t pos() const { return _size; }
+
+		// Overwrites plain data at an earlier position
+		template<typename T>
+		void patch(size_t pos, const T& data)
+		{
+			if (pos + sizeof(T) > _size) {
+				inkFail("Snapshot patch out of range");
+				return;
+			}
+			const unsigned char* src = reinterpret_cast<const unsigned char*>(&data);
+			for (size_t i = 0; i < sizeof(T); ++i)
+				_data[pos + i] = src[i];
+		}
+
+		// Appends the string section. Returns the buffer, which stays owned by the snapper
+		const unsigned char* finish(size_t& length);
+
+	private:
+		void write_raw(const void* data, size_t length);
+		void reserve(size_t length);
+
+		const story_impl& _story;
+		const string_table& _strings;
+
+		allocator* _alloc;
+		unsigned char* _data;
+		size_t _size;
+		size_t _capacity;
+
+		// dynamic strings in order of their first appearance
+		managed_array<const char*, true, 16, alloc_category::snapshots> _string_list;
+		string_id_map _string_ids;
+	};
+
+	class snapshot_impl;
+
+	/**
+	 * Reads runtime state written by a snapper.
+	 *
+	 * Dynamic strings of the snapshot are duplicated into the given
+	 * string table on construction.
+	 */
+	class loader
+	{
+	public:
+		loader(const story_impl& story, string_table& strings, const snapshot_impl& snap, size_t offset);
+		// Reads data returned by snapper::finish, starting at its beginning
+		loader(const story_impl& story, string_table& strings, const unsigned char* data, size_t length, size_t strings_offset);
+
+		// Reads plain data
+		template<typename T>
+		void read(T& data)
+		{
+			static_assert(!std::is_pointer_v<T>, "Pointers need a dedicated snapshot encoding");
+			read_raw(&data, sizeof(T));
+		}
+		template<typename T>
+		T read() { T data; read(data); return data; }
+
+		// Id of the snapshot being read
+		uint32_t snapshot_id() const { return _snapshot_id; }
+
+		void read(value&);
+		void read(entry&);
+		void read(ip_t&);
+		void read(const char*&);
+
+	private:
+		void read_raw(void* data, size_t length);
+
+		const story_impl& _story;
+		string_table& _strings;
+		const unsigned char* _ptr;
+		const unsigned char* _end;
+		uint32_t _snapshot_id;
+
+		managed_array<const char*, true, 16> _string_list;
+	};
+
+	// Snapshot data with a parsed header
+	class snapshot_impl : public snapshot
+	{
+	public:
+		// Takes ownership of data if manage is set
+		snapshot_impl(const unsigned char* data, size_t length, bool manage);
+		virtual ~snapshot_impl();
+
+		// == Non-Copyable ==
+		snapshot_impl(const snapshot_impl&) = delete;
+		snapshot_impl& operator=(const snapshot_impl&) = delete;
+
+		// Creates a snapshot of the globals store and the given runners.
+		//  If a base is given, only globals changed since that snapshot are written.
+		static snapshot_impl* create(const globals_impl&, const runner_impl* const* runners, size_t num_runners,
+			uint32_t id, uint32_t base = NoBase);
+
+		virtual const unsigned char* get_data() const override { return _data; }
+		virtual size_t get_data_len() const override { return _length; }
+		virtual size_t num_runners() const override { return _num_runners; }
+		virtual uint32_t id() const override { return _id; }
+		virtual bool is_delta() const override { return _base != NoBase; }
+		virtual uint64_t state_hash() const override;
+
+		// Id of the snapshot a delta is based on
+		uint32_t base_id() const { return _base; }
+
+		// Fails if this snapshot was not made from the given story
+		bool check_story(const story_impl&) const;
+
+		// Section offsets
+		size_t globals_offset() const;
+		size_t runner_offset(size_t index) const;
+		size_t strings_offset() const { return _strings_offset; }
+
+		static constexpr uint32_t Magic = 0x534b4e49; // "INKS"
+		static constexpr uint16_t Version = 3;
+		static constexpr uint32_t NoBase = ~0u;
+
+	private:
+		// Header layout (all fields host endian)
+		//  uint32 magic | uint16 endian | uint16 version | uint32 story fingerprint
+		//  uint32 length | uint32 strings offset | uint32 runner count | uint32 id
+		//  uint32 base id | uint32 runner offsets[]
+		static constexpr size_t HeaderSize = 8 * sizeof(uint32_t);
+		static constexpr size_t IdOffset = 6 * sizeof(uint32_t);
+
+		const unsigned char* _data;
+		size_t _length;
+		bool _managed;
+
+		hash_t _fingerprint;
+		size_t _strings_offset;
+		size_t _num_runners;
+		uint32_t _id;
+		uint32_t _base;
+	};
+}
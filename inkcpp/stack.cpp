@@ -1,5 +1,6 @@
 #include "stack.h"
 #include "string_table.h"
+#include "snapshot_impl.h"
 
 namespace ink::runtime::internal
 {
@@ -8,23 +9,6 @@ namespace ink::runtime::internal
 	{
 	}
 
-	void basic_stack::set(hash_t name, const value& val)
-	{
-		// If we have a save point, always add no matter what
-		if (base::is_saved())
-		{
-			add(name, val);
-			return;
-		}
-
-		// Either set an existing variable or add it to the stack
-		value* existing = const_cast<value*>(get(name));
-		if (existing == nullptr)
-			add(name, val);
-		else
-			*existing = val;
-	}
-
 	bool reverse_find_predicat(hash_t name, thread_t& skip, uint32_t& jumping, entry& e) {
 			// Jumping
 			if (jumping > 0) {
@@ -125,6 +109,32 @@ namespace ink::runtime::internal
 		return nullptr;
 	}
 	
+	value* basic_stack::get(hash_t name, size_t& index) {
+		entry* found = base::reverse_find(reverse_find_predicat_operator(name));
+		if (found == nullptr || found->name != name)
+			return nullptr;
+
+		index = base::index_of(*found);
+		return &found->data;
+	}
+
+	size_t basic_stack::set(hash_t name, const value& val)
+	{
+		// If we have a save point, always add no matter what
+		if (base::is_saved())
+		{
+			return base::index_of(add(name, val));
+		}
+
+		// Either set an existing variable or add it to the stack
+		entry* existing = base::reverse_find(reverse_find_predicat_operator(name));
+		if (existing == nullptr || existing->name != name)
+			return base::index_of(add(name, val));
+
+		existing->data = val;
+		return base::index_of(*existing);
+	}
+
 	value* basic_stack::get_from_frame(int ci, hash_t name) {
 		entry* found = base::reverse_find(reverse_find_from_frame_predicat_operator(ci, name));
 		if(found == nullptr && ci == -1) {
@@ -208,7 +218,7 @@ namespace ink::runtime::internal
 		} else if (vt == value_type::thread_start) {
 			start.set<value_type::thread_start>(jump);
 		} else {
-			throw ink_exception("unknown jump type");
+			inkFail("unknown jump type");
 		}
 		return threadIter.get();
 	}
@@ -231,7 +241,10 @@ namespace ink::runtime::internal
 
 	offset_t basic_stack::pop_frame(frame_type* type, bool& eval)
 	{
-		inkAssert(!base::is_empty(), "Can not pop frame from empty callstack.");
+		if (base::is_empty()) {
+			inkFail("Can not pop frame from empty callstack.");
+			return 0;
+		}
 
 		const entry* returnedFrame = nullptr;
 		auto isNull = [](const entry& e) { return e.name == ~0; };
@@ -293,7 +306,10 @@ namespace ink::runtime::internal
 		}
 
 		// If we didn't find a frame entry, we never had a frame to return from
-		inkAssert(returnedFrame, "Attempting to pop_frame when no frames exist! Stack reset.");
+		if (returnedFrame == nullptr) {
+			inkFail("Attempting to pop_frame when no frames exist! Stack reset.");
+			return 0;
+		}
 
 		// Make sure we're not somehow trying to "return" from a thread
 		inkAssert(returnedFrame->data.type() != value_type::thread_start
@@ -413,7 +429,10 @@ namespace ink::runtime::internal
 				top->data.type() == value_type::thread_end &&
 				top->data.get<value_type::thread_end>() == thread))
 			{
-				inkAssert(!is_empty(), "Ran out of stack while searching for end of thread marker. Did you call complete_thread?");
+				if (is_empty()) {
+					inkFail("Ran out of stack while searching for end of thread marker. Did you call complete_thread?");
+					return;
+				}
 				top = pop();
 			}
 		}
@@ -491,6 +510,25 @@ namespace ink::runtime::internal
 		base::forget([](entry& elem) { elem.name = ~0; });
 	}
 
+	void basic_stack::snap(snapper& snapper) const
+	{
+		base::snap(snapper);
+		snapper.write(_next_thread);
+		snapper.write(_backup_next_thread);
+	}
+
+	void basic_stack::snap_load(loader& loader)
+	{
+		base::snap_load(loader);
+		loader.read(_next_thread);
+		loader.read(_backup_next_thread);
+	}
+
+	void basic_stack::snap_load_changed(loader& loader)
+	{
+		base::snap_load_changed(loader);
+	}
+
 	entry& basic_stack::add(hash_t name, const value& val)
 	{
 		return base::push({ name, val });
@@ -563,6 +601,16 @@ namespace ink::runtime::internal
 		base::forget([&none](value& elem) { elem = none; });
 	}
 
+	void basic_eval_stack::snap(snapper& snapper) const
+	{
+		base::snap(snapper);
+	}
+
+	void basic_eval_stack::snap_load(loader& loader)
+	{
+		base::snap_load(loader);
+	}
+
 	void basic_stack::fetch_values(basic_stack& stack) {
 		auto itr  = base::begin();
 		auto predicat = [](entry& e)
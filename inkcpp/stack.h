@@ -11,6 +11,8 @@ namespace ink
 		namespace internal
 		{
 			class string_table;
+			class snapper;
+			class loader;
 			struct entry
 			{
 				hash_t name;
@@ -34,11 +36,14 @@ namespace ink
 
 			public:
 				// Sets existing value, or creates a new one at this callstack entry
-				void set(hash_t name, const value& val);
+				// @return index of the written entry
+				size_t set(hash_t name, const value& val);
 
 				// Gets an existing value, or nullptr
 				const value* get(hash_t name) const;
 				value* get(hash_t name);
+				// Also returns the index of the found entry
+				value* get(hash_t name, size_t& index);
 				value* get_from_frame(int ci, hash_t name);
 
 				// pushes a new frame onto the stack
@@ -55,6 +60,12 @@ namespace ink
 				// Clears the entire stack
 				void clear();
 
+				// Checks if there is a save point
+				using base::is_saved;
+
+				// Replaces the stack with the given variables, which have distinct names
+				void assign(const entry* entries, size_t count) { base::assign(entries, count); }
+
 				// Garbage collection
 				void mark_strings(string_table&) const;
 
@@ -79,6 +90,18 @@ namespace ink
 				// push all values to other _stack
 				void push_values(basic_stack& _stack);
 
+				// == Snapshots ==
+				void snap(snapper&) const;
+				void snap_load(loader&);
+
+				// Only writes the entries for which changed(index) is true
+				template<typename ChangedPredicate>
+				void snap_changed(snapper& snapper, ChangedPredicate changed) const
+				{
+					base::snap_changed(snapper, changed);
+				}
+				void snap_load_changed(loader&);
+
 			private:
 				entry& add(hash_t name, const value& val);
 				const entry* pop();
@@ -101,7 +124,10 @@ namespace ink
 			class stack : public basic_stack
 			{
 			public:
-				stack() : basic_stack(&_stack[0], N) { }
+				stack(size_t capacity = N) : basic_stack(&_stack[0], capacity <= N ? capacity : N)
+				{
+					inkAssert(capacity <= N, "Capacity exceeds the fixed size set in config.h");
+				}
 			private:
 				// stack
 				entry _stack[N];
@@ -111,7 +137,7 @@ namespace ink
 			class stack<N, true> : public basic_stack
 			{
 			public:
-				stack() : basic_stack(nullptr, 0) {}
+				stack(size_t capacity = N) : basic_stack(nullptr, 0), _stack(capacity) {}
 			protected:
 				virtual void overflow(entry*& buffer, size_t& size) override {
 					if (!buffer) {
@@ -160,13 +186,20 @@ namespace ink
 				void save();
 				void restore();
 				void forget();
+
+				// == Snapshots ==
+				void snap(snapper&) const;
+				void snap_load(loader&);
 			};
 
 			template<size_t N, bool dynamic = false>
 			class eval_stack : public basic_eval_stack
 			{
 			public:
-				eval_stack() : basic_eval_stack(_stack, N) { }
+				eval_stack(size_t capacity = N) : basic_eval_stack(_stack, capacity <= N ? capacity : N)
+				{
+					inkAssert(capacity <= N, "Capacity exceeds the fixed size set in config.h");
+				}
 			private:
 				value _stack[N];
 			};
@@ -174,10 +207,12 @@ namespace ink
 			class eval_stack<N, true> : public basic_eval_stack
 			{
 			public:
-				eval_stack() : basic_eval_stack(nullptr, 0) {}
+				eval_stack(size_t capacity = N) : basic_eval_stack(nullptr, 0), _stack(capacity) {}
 			protected:
 				virtual void overflow(value*& buffer, size_t& size) override {
-					_stack.extend();
+					if (buffer) {
+						_stack.extend();
+					}
 					buffer = _stack.data();
 					size = _stack.capacity();
 				}
@@ -2,7 +2,9 @@
 #include "platform.h"
 #include "runner_impl.h"
 #include "globals_impl.h"
+#include "snapshot_impl.h"
 #include "version.h"
+#include "error.h"
 
 #ifdef INK_ENABLE_STL
 #include <iostream>
@@ -11,15 +13,19 @@
 namespace ink::runtime
 {
 #ifdef INK_ENABLE_STL
-	story* story::from_file(const char* filename)
+	story* story::from_file(const char* filename, load_result* result)
 	{
-		return new internal::story_impl(filename);
+		return internal::checked_create(result, [filename]() -> story* {
+			return new internal::story_impl(filename);
+		});
 	}
 #endif
 
-	story* story::from_binary(unsigned char* data, size_t length, bool freeOnDestroy)
+	story* story::from_binary(unsigned char* data, size_t length, bool freeOnDestroy, load_result* result)
 	{
-		return new internal::story_impl(data, length, freeOnDestroy);
+		return internal::checked_create(result, [=]() -> story* {
+			return new internal::story_impl(data, length, freeOnDestroy);
+		});
 	}
 }
 
@@ -34,7 +40,8 @@ namespace ink::runtime::internal
 		ifstream ifs(filename, ios::binary | ios::ate);
 
 		if (!ifs.is_open()) {
-			throw ink_exception("Failed to open file: " + std::string(filename));
+			inkFail("Failed to open story file");
+			return nullptr;
 		}
 
 		ifstream::pos_type pos = ifs.tellg();
@@ -52,30 +59,37 @@ namespace ink::runtime::internal
 		: _file(nullptr)
 		, _length(0)
 		, _string_table(nullptr)
+		, _globals_image(nullptr)
+		, _globals_image_size(0)
 		, _instruction_data(nullptr)
 		, _managed(true)
 	{
+		// create story block
+		_block = new internal::ref_block();
+		_block->references = 1;
+
 		// Load file into memory
 		_file = read_file_into_memory(filename, &_length);
+		if (_file == nullptr)
+			return;
 
 		// Find all the right data sections
 		setup_pointers();
-
-		// create story block
-		_block = new internal::ref_block();
-		_block->references = 1;
 	}
 #endif
 
 	story_impl::story_impl(unsigned char* binary, size_t len, bool manage /*= true*/)
-		: _file(binary), _length(len), _managed(manage)
+		: _file(binary), _length(len), _globals_image(nullptr), _globals_image_size(0), _managed(false)
 	{
-		// Setup data section pointers
-		setup_pointers();
-
 		// create story block
 		_block = new internal::ref_block();
 		_block->references = 1;
+
+		// Setup data section pointers
+		setup_pointers();
+
+		// a story which failed to load leaves the data to the caller
+		_managed = manage && !error_raised();
 	}
 
 	story_impl::~story_impl()
@@ -84,8 +98,11 @@ namespace ink::runtime::internal
 		if (_file != nullptr && _managed)
 			delete[] _file;
 
+		delete_array(_alloc, alloc_category::registry, _globals_image, _globals_image_size);
+
 		// clear pointers
 		_file = nullptr;
+		_globals_image = nullptr;
 		_instruction_data = nullptr;
 		_string_table = nullptr;
 
@@ -152,6 +169,24 @@ namespace ink::runtime::internal
 		return false;
 	}
 
+	const char* story_impl::container_name(container_t index) const
+	{
+		if (index >= _num_containers) {
+			inkFail("Container index out of range");
+			return "";
+		}
+		return string(_container_info[index * 2 + 1]);
+	}
+
+	container_t story_impl::container_parent(container_t index) const
+	{
+		if (index >= _num_containers) {
+			inkFail("Container index out of range");
+			return ~0;
+		}
+		return _container_info[index * 2];
+	}
+
 	ip_t story_impl::find_offset_for(hash_t path) const
 	{
 		hash_t* iter = _container_hash_start;
@@ -169,23 +204,248 @@ namespace ink::runtime::internal
 		return nullptr;
 	}
 
-	globals story_impl::new_globals()
+	bool story_impl::static_bounds(capacities& caps) const
+	{
+		using ink::internal::bound;
+		auto get = [this](bound b) -> size_t {
+			uint32_t value = _header.get_bound(b);
+			return value == ink::internal::header::Unbounded ? 0 : value;
+		};
+		caps.runtime_stack = get(bound::runtime_stack);
+		caps.reference_stack = get(bound::runtime_stack);
+		caps.eval_stack = get(bound::eval_stack);
+		caps.container_depth = get(bound::container_depth);
+		caps.thread_depth = get(bound::thread_depth);
+		caps.choices = get(bound::choices);
+		caps.tags = get(bound::tags);
+		caps.global_variables = get(bound::global_variables);
+		return !(_header.bounds_flags & ink::internal::header::BoundsRecursive);
+	}
+
+	capacities story_impl::resolve_capacities(const capacities* requested) const
+	{
+		// Dynamic buffers start at the size the compiler found the story needs,
+		//  fixed ones keep their compiled-in size so they can not overflow where
+		//  a static bound falls short
+		using ink::internal::bound;
+		auto pick = [this](size_t value, bound b, size_t factor, int config) -> size_t {
+			uint32_t story_bound = _header.get_bound(b);
+			if (value != 0)
+				return value;
+			if (config < 0 && story_bound != ink::internal::header::Unbounded)
+				return story_bound > 0 ? story_bound * factor : 1;
+			return abs(config);
+		};
+		capacities caps = requested != nullptr ? *requested : capacities{};
+		// runtime stacks keep a copy of the entries changed since the last save point
+		caps.runtime_stack = pick(caps.runtime_stack, bound::runtime_stack, 2, config::limitRuntimeStack);
+		caps.reference_stack = pick(caps.reference_stack, bound::runtime_stack, 2, config::limitReferenceStack);
+		caps.eval_stack = pick(caps.eval_stack, bound::eval_stack, 1, config::limitEvalStackDepth);
+		caps.container_depth = pick(caps.container_depth, bound::container_depth, 1, config::limitContainerDepth);
+		caps.thread_depth = pick(caps.thread_depth, bound::thread_depth, 1, config::limitThreadDepth);
+		caps.choices = pick(caps.choices, bound::choices, 1, config::maxChoices);
+		caps.tags = pick(caps.tags, bound::tags, 1, config::limitActiveTags);
+		caps.global_variables = pick(caps.global_variables, bound::global_variables, 1, config::limitGlobalVariables);
+		return caps;
+	}
+
+	globals story_impl::new_globals(allocator* alloc, const capacities* caps)
 	{
 		// create the new globals store
-		return globals(new globals_impl(this), _block);
+		allocator_scope scope(alloc);
+		return globals(new globals_impl(this, resolve_capacities(caps)), _block);
 	}
 
-	runner story_impl::new_runner(globals store)
+	runner story_impl::new_runner(globals store, allocator* alloc, const capacities* caps)
 	{
+		allocator_scope scope(alloc);
 		if (store == nullptr)
-			store = new_globals();
-		return runner(new runner_impl(this, store), _block);
+			store = new_globals(nullptr, caps);
+		return runner(new runner_impl(this, store, resolve_capacities(caps)), _block);
+	}
+
+	globals story_impl::new_globals_from_snapshot(const snapshot& data, allocator* alloc, load_result* result)
+	{
+		allocator_scope scope(alloc);
+		return checked_create(result, [this, &data]() {
+			return load_globals(static_cast<const snapshot_impl&>(data));
+		});
+	}
+
+	runner story_impl::new_runner_from_snapshot(const snapshot& data, globals store, size_t runner_id, allocator* alloc,
+		load_result* result)
+	{
+		allocator_scope scope(alloc);
+		return checked_create(result, [this, &data, &store, runner_id]() {
+			return load_runner(static_cast<const snapshot_impl&>(data), store, runner_id);
+		});
+	}
+
+	snapshot* story_impl::apply_delta(const snapshot& base_data, const snapshot& delta_data, load_result* result)
+	{
+		return checked_create(result, [this, &base_data, &delta_data]() -> snapshot* {
+			const snapshot_impl& base = static_cast<const snapshot_impl&>(base_data);
+			const snapshot_impl& delta = static_cast<const snapshot_impl&>(delta_data);
+			if (!base.check_story(*this) || !delta.check_story(*this))
+				return nullptr;
+			if (!delta.is_delta() || base.is_delta()) {
+				inkFail("apply_delta expects a full base and a delta snapshot");
+				return nullptr;
+			}
+			if (base.id() < delta.base_id() || base.id() >= delta.id()) {
+				inkFail("Delta snapshot does not fit onto base snapshot");
+				return nullptr;
+			}
+
+			// load base, apply changes
+			globals store = load_globals(base);
+			if (store == nullptr)
+				return nullptr;
+			globals_impl* impl = store.cast<globals_impl>().get();
+			{
+				loader in(*this, impl->strings(), delta, delta.globals_offset());
+				impl->snap_load_changed(in);
+			}
+
+			// runners are always stored completely
+			managed_array<runner, true, 4> runners;
+			managed_array<const runner_impl*, true, 4> runner_impls;
+			for (size_t i = 0; i < delta.num_runners() && !error_raised(); ++i)
+			{
+				runners.push() = load_runner(delta, store, i);
+				runner_impls.push() = runners.back().cast<runner_impl>().get();
+			}
+			if (error_raised())
+				return nullptr;
+
+			snapshot* merged = snapshot_impl::create(*impl, runner_impls.data(), runner_impls.size(), delta.id());
+			for (runner& run : runners)
+				run = nullptr;
+			return merged;
+		});
+	}
+
+	globals story_impl::load_globals(const snapshot_impl& snap)
+	{
+		if (!snap.check_story(*this))
+			return nullptr;
+		if (snap.is_delta()) {
+			inkFail("Delta snapshots must be applied onto their base before loading");
+			return nullptr;
+		}
+		globals_impl* store = new globals_impl(this, resolve_capacities(nullptr));
+		globals result(store, _block);
+		loader in(*this, store->strings(), snap, snap.globals_offset());
+		store->snap_load(in);
+		if (error_raised())
+			return nullptr;
+		return result;
+	}
+
+	runner story_impl::load_runner(const snapshot_impl& snap, globals& store, size_t runner_id)
+	{
+		if (!snap.check_story(*this))
+			return nullptr;
+		if (runner_id >= snap.num_runners()) {
+			inkFail("Snapshot runner index out of range");
+			return nullptr;
+		}
+		if (store == nullptr)
+			store = load_globals(snap);
+		if (store == nullptr)
+			return nullptr;
+		runner_impl* run = new runner_impl(this, store, resolve_capacities(nullptr));
+		runner result(run, _block);
+		loader in(*this, store.cast<globals_impl>()->strings(), snap, snap.runner_offset(runner_id));
+		run->snap_load(in);
+		if (error_raised())
+			return nullptr;
+		return result;
+	}
+
+	runner story_impl::fork(const runner_impl& parent, const globals_impl& parent_globals, allocator* alloc,
+		const capacities& caps) const
+	{
+		allocator_scope scope(alloc);
+		// only the visit counts are shared, everything else is copied
+		//  through a snapshot buffer
+		snapper out(*this, parent_globals.strings());
+		parent_globals.snap_fork(out);
+		parent.snap(out);
+		size_t strings_offset = out.pos();
+		size_t length;
+		const unsigned char* data = out.finish(length);
+
+		globals_impl* child_globals = new globals_impl(this, parent_globals.get_capacities());
+		globals store(child_globals, _block);
+		loader in(*this, child_globals->strings(), data, length, strings_offset);
+		child_globals->fork_load(parent_globals, in);
+
+		runner_impl* child = new runner_impl(this, store, caps);
+		runner result(child, _block);
+		child->snap_load(in);
+
+		return result;
+	}
+
+	void story_impl::setup_globals_image(const char*& ptr)
+	{
+		using ink::internal::header;
+		using ink::internal::global_type;
+		uint32_t count = _header.read_uint32(ptr);
+		if (count == header::NoGlobalsImage)
+			return;
+
+		// Converted to runtime values once, so new stores only copy them
+		_globals_image = new_array<entry>(_alloc, alloc_category::registry, count);
+		_globals_image_size = count;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			entry& e = _globals_image[i];
+			e.name = _header.read_uint32(ptr);
+			global_type type = static_cast<global_type>(_header.read_uint32(ptr));
+			if (type == global_type::list_flag)
+			{
+				e.data.set<value_type::list_flag>(_header.read_list_flag(ptr));
+				continue;
+			}
+			uint32_t payload = _header.read_uint32(ptr);
+			switch (type)
+			{
+			case global_type::int32:
+				e.data.set<value_type::int32>(static_cast<int32_t>(payload));
+				break;
+			case global_type::float32:
+				e.data.set<value_type::float32>(*reinterpret_cast<const float*>(&payload));
+				break;
+			case global_type::boolean:
+				e.data.set<value_type::boolean>(payload != 0);
+				break;
+			case global_type::string:
+				e.data.set<value_type::string>(payload == header::EmptyString ? "" : string(payload), false);
+				break;
+			case global_type::list:
+				e.data.set<value_type::list>(list_table::list(static_cast<int>(payload)));
+				break;
+			case global_type::divert:
+				e.data.set<value_type::divert>(payload);
+				break;
+			default:
+				inkFail("Unknown type in the initial globals of the story");
+			}
+		}
 	}
 
 	void story_impl::setup_pointers()
 	{
 		using header = ink::internal::header;
+		if (_length < header::Size) {
+			inkFail("Story data is truncated");
+			return;
+		}
 		_header = header::parse_header(reinterpret_cast<char*>(_file));
+		if (error_raised())
+			return;
 
 		// String table is after the header
 		_string_table = (char*)_file + header::Size;
@@ -275,9 +535,21 @@ namespace ink::runtime::internal
 			ptr += sizeof(uint32_t) * 2;
 		}
 
+		// Then the enclosing container and name of each counted container
+		_container_info = (uint32_t*)(ptr);
+		ptr += sizeof(uint32_t) * 2 * _num_containers;
+
+		// Then the initial global variables, if the compiler could evaluate them
+		setup_globals_image(ptr);
+
 		// After strings comes instruction data
 		_instruction_data = (ip_t)ptr;
 
+		// Fingerprint the whole binary (FNV-1a) so snapshots can be matched to it
+		_fingerprint = 2166136261u;
+		for (size_t i = 0; i < _length; ++i)
+			_fingerprint = (_fingerprint ^ _file[i]) * 16777619u;
+
 		// Debugging info
 		/*{
 			const uint32_t* iter = nullptr;
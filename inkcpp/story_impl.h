@@ -4,13 +4,22 @@
 #include <config.h>
 #include "types.h"
 #include "story.h"
+#include "allocator.h"
 #include "header.h"
 #include "list_table.h"
 
 namespace ink::runtime::internal
 {
-	// Ink story. Constant once constructed. Can be shared safely between multiple runner instances
-	class story_impl : public story
+	class runner_impl;
+	class globals_impl;
+	class snapshot_impl;
+	struct entry;
+
+	// Ink story. Constant once constructed. Can be shared safely between multiple runner instances,
+	//  including runners on different threads: after setup_pointers() no member is ever written
+	//  again (except _block's atomic reference counts) until destruction. Keep it that way; any
+	//  per-execution state belongs in runner_impl or globals_impl.
+	class story_impl : public story, public heap_object<alloc_category::story>
 	{
 	public:
 
@@ -26,7 +35,14 @@ namespace ink::runtime::internal
 		inline const ip_t instructions() const { return _instruction_data; }
 		inline const ip_t end() const { return _file + _length; }
 
-		inline uint32_t num_containers() const { return _num_containers; }
+		virtual uint32_t num_containers() const override final { return _num_containers; }
+
+		// raw story binary
+		inline const unsigned char* data() const { return _file; }
+		inline size_t length() const { return _length; }
+
+		// hash of the story binary, used to match snapshots with their story
+		inline hash_t fingerprint() const { return _fingerprint; }
 
 		const list_flag* lists() const { return _lists; }
 		const char* list_meta() const {
@@ -38,14 +54,48 @@ namespace ink::runtime::internal
 
 		ip_t find_offset_for(hash_t path) const;
 
-		// Creates a new global store for use with runners executing this story
-		virtual globals new_globals() override;
-		virtual runner new_runner(globals store = nullptr) override;
+		// Full path of a counted container, like "knot.stitch"
+		const char* container_name(container_t index) const;
+		// Closest counted container enclosing the given one, ~0 if none
+		container_t container_parent(container_t index) const;
 
+		// Creates a new global store for use with runners executing this story
+		virtual globals new_globals(allocator* alloc = nullptr, const capacities* caps = nullptr) override;
+		virtual runner new_runner(globals store = nullptr, allocator* alloc = nullptr, const capacities* caps = nullptr) override;
+		virtual globals new_globals_from_snapshot(const snapshot&, allocator* alloc = nullptr,
+			load_result* result = nullptr) override;
+		virtual runner new_runner_from_snapshot(const snapshot&, globals store = nullptr, size_t runner_id = 0,
+			allocator* alloc = nullptr, load_result* result = nullptr) override;
+		virtual snapshot* apply_delta(const snapshot& base, const snapshot& delta,
+			load_result* result = nullptr) override;
+
+		// Creates a runner with its own globals, continuing from the state of parent.
+		//  Both take their memory from the given allocator
+		runner fork(const runner_impl& parent, const globals_impl& parent_globals, allocator* alloc,
+			const capacities& caps) const;
+
+		virtual bool static_bounds(capacities& caps) const override;
+
+		// Replaces capacities left at 0 with the defaults of this story: the bounds
+		//  computed by the compiler, or the configured limits
+		capacities resolve_capacities(const capacities* requested) const;
+
+
+		// Initial global variables evaluated by the compiler, in definition order.
+		//  nullptr if the global declarations have to be run
+		const entry* globals_image(size_t& count) const {
+			count = _globals_image_size;
+			return _globals_image;
+		}
 
 		const ink::internal::header& get_header() const { return _header; }
 	private:
 		void setup_pointers();
+		void setup_globals_image(const char*& ptr);
+
+		// Load a store or runner from a snapshot, null after a failed check
+		globals load_globals(const snapshot_impl& snap);
+		runner load_runner(const snapshot_impl& snap, globals& store, size_t runner_id);
 
 	private:
 		// file information
@@ -69,9 +119,21 @@ namespace ink::runtime::internal
 		hash_t* _container_hash_start;
 		hash_t* _container_hash_end;
 
+		// enclosing container and name offset per counted container
+		uint32_t* _container_info;
+
+		// initial global variables
+		entry* _globals_image;
+		uint32_t _globals_image_size;
+
+		// Memory source of the buffers this story owns
+		allocator* _alloc = current_allocator();
+
 		// instruction info
 		ip_t _instruction_data;
 
+		hash_t _fingerprint;
+
 		// story block used to creat various weak pointers
 		ref_block* _block;
 
@@ -7,17 +7,14 @@ namespace ink::runtime::internal
 		if (block == nullptr)
 			return;
 
-		// If we only have one references left
-		if (block->references <= 1)
+		// If we just released the last reference, delete the block. The decrement
+		//  and test must be a single atomic operation, otherwise two threads
+		//  releasing at the same time could both (or neither) delete it.
+		if (block->references.fetch_sub(1, std::memory_order_acq_rel) <= 1)
 		{
-			// delete the block
 			delete block;
 			block = nullptr;
-			return;
 		}
-
-		// Otherwise, derecement references
-		block->references--;
 	}
 
 	story_ptr_base::story_ptr_base(internal::ref_block* story)
@@ -52,8 +49,10 @@ namespace ink::runtime::internal
 			return;
 		}
 
-		_instance_block->references++;
-		_story_block->references++;
+		// Incrementing only needs atomicity: a new reference is always created
+		//  from an existing one, so the count can't concurrently reach zero.
+		_instance_block->references.fetch_add(1, std::memory_order_relaxed);
+		_story_block->references.fetch_add(1, std::memory_order_relaxed);
 	}
 
 	bool story_ptr_base::remove_reference()
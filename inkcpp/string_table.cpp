@@ -6,8 +6,45 @@ namespace ink::runtime::internal
 	{
 		// Delete all allocated strings
 		for (auto iter = _table.begin(); iter != _table.end(); ++iter)
-			delete[] iter.key();
+			free_block(iter.key());
 		_table.clear();
+
+		// Release the free lists
+		for (size_t c = 0; c < NumClasses; ++c)
+		{
+			while (_free[c] != nullptr)
+			{
+				void* block = _free[c];
+				_free[c] = *static_cast<void**>(block);
+				deallocate(_alloc, alloc_category::strings, block, size_t(1) << c);
+			}
+		}
+	}
+
+	char* string_table::allocate_block(size_t length)
+	{
+		// smallest class which fits the string and its class byte
+		size_t c = MinClass;
+		while ((size_t(1) << c) < length + 1)
+			++c;
+
+		void* block = _free[c];
+		if (block != nullptr)
+			_free[c] = *static_cast<void**>(block);
+		else
+			block = allocate(_alloc, alloc_category::strings, size_t(1) << c);
+
+		unsigned char* data = static_cast<unsigned char*>(block);
+		data[0] = static_cast<unsigned char>(c);
+		return reinterpret_cast<char*>(data + 1);
+	}
+
+	void string_table::free_block(const char* string)
+	{
+		unsigned char* data = reinterpret_cast<unsigned char*>(const_cast<char*>(string)) - 1;
+		size_t c = data[0];
+		*reinterpret_cast<void**>(data) = _free[c];
+		_free[c] = data;
 	}
 	char* string_table::duplicate(const char* str)
 	{
@@ -27,16 +64,14 @@ namespace ink::runtime::internal
 	char* string_table::create(size_t length)
 	{
 		// allocate the string
-		char* data = new char[length];
-		if (data == nullptr)
-			return nullptr;
+		char* data = allocate_block(length);
 
 		// Add to the tree
 		bool success = _table.insert(data, true); // TODO: Should it start as used?
 		inkAssert(success, "Duplicate string pointer in the string_table. How is that possible?");
 		if (!success)
 		{
-			delete[] data;
+			free_block(data);
 			return nullptr;
 		}
 
@@ -61,6 +96,12 @@ namespace ink::runtime::internal
 		*iter = true;
 	}
 
+	bool string_table::contains(const char* string) const
+	{
+		bool used;
+		return _table.find(string, used);
+	}
+
 	void string_table::gc()
 	{
 		// begin at the start
@@ -73,7 +114,7 @@ namespace ink::runtime::internal
 			if (!*iter)
 			{
 				// Delete it
-				delete[] iter.key();
+				free_block(iter.key());
 				_table.erase(iter);
 
 				// Re-establish iterator at last position
@@ -2,6 +2,7 @@
 
 #include "avl_array.h"
 #include "system.h"
+#include "allocator.h"
 
 namespace ink::runtime::internal
 {
@@ -24,7 +25,22 @@ namespace ink::runtime::internal
 		// deletes all unused strings
 		void gc();
 
+		// checks if a string was allocated by this table
+		bool contains(const char* string) const;
+
 	private:
+		// Strings live in blocks of power of two sizes, with the size class
+		//  stored in the byte before the string. Deleted blocks are kept in
+		//  a free list per class and reused, so a story in steady state does
+		//  not allocate.
+		static constexpr size_t MinClass = 4;
+		static constexpr size_t NumClasses = sizeof(size_t) * 8;
+
+		char* allocate_block(size_t length);
+		void free_block(const char* string);
+
 		avl_array<const char*, bool, ink::size_t, 100> _table;
+		void* _free[NumClasses] = {};
+		allocator* _alloc = current_allocator();
 	};
 }
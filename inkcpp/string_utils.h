@@ -4,58 +4,125 @@
 #include "traits.h"
 #include "value.h"
 
-#include <cstdio>
+#include <cmath>
 
 #ifndef EINVAL
 #define EINVAL -1
 #endif
 
 namespace ink::runtime::internal {
+	// "00" to "99", to write two digits at a time
+	inline constexpr char digit_pairs[] =
+		"00010203040506070809"
+		"10111213141516171819"
+		"20212223242526272829"
+		"30313233343536373839"
+		"40414243444546474849"
+		"50515253545556575859"
+		"60616263646566676869"
+		"70717273747576777879"
+		"80818283848586878889"
+		"90919293949596979899";
+
+	// writes the decimal digits of value backwards from end, returns the first digit
+	inline char* write_digits(char* end, uint64_t value) {
+		while (value >= 100) {
+			const char* pair = &digit_pairs[(value % 100) * 2];
+			value /= 100;
+			*--end = pair[1];
+			*--end = pair[0];
+		}
+		if (value >= 10) {
+			const char* pair = &digit_pairs[value * 2];
+			*--end = pair[1];
+			*--end = pair[0];
+		} else {
+			*--end = static_cast<char>('0' + value);
+		}
+		return end;
+	}
+
+	// copies a formatted number into a null terminated buffer
+	inline int copy_number(char* buffer, size_t size, const char* begin, const char* end) {
+		if ( buffer == nullptr || size <= static_cast<size_t>(end - begin) ) { return EINVAL; }
+		while (begin != end) { *buffer++ = *begin++; }
+		*buffer = 0;
+		return 0;
+	}
+
 	// error behavior from: https://docs.microsoft.com/en-us/cpp/c-runtime-library/reference/itoa-s-itow-s?view=msvc-160
 	inline int toStr(char * buffer, size_t size, uint32_t value) {
-#ifdef WIN32
-		return _itoa_s(value, buffer, size, 10);
-#else
-		if ( buffer == nullptr || size < 1 ){ return EINVAL; }
-		int res = snprintf(buffer, size, "%d", value);
-		if (res > 0 && res < size) { return 0; }
-		return EINVAL;
-#endif
+		char digits[10];
+		char* end = digits + sizeof(digits);
+		return copy_number(buffer, size, write_digits(end, value), end);
 	}
 
 	// error behavior from: https://docs.microsoft.com/en-us/cpp/c-runtime-library/reference/itoa-s-itow-s?view=msvc-160
 	inline int toStr(char * buffer, size_t size, int32_t value) {
-#ifdef WIN32
-		return _itoa_s(value, buffer, size, 10);
-#else
-		if ( buffer == nullptr || size < 1 ){ return EINVAL; }
-		int res = snprintf(buffer, size, "%d", value);
-		if (res > 0 && res < size) { return 0; }
-		return EINVAL;
-#endif
+		char digits[11];
+		char* end = digits + sizeof(digits);
+		uint32_t magnitude = value < 0 ? 0u - static_cast<uint32_t>(value) : static_cast<uint32_t>(value);
+		char* begin = write_digits(end, magnitude);
+		if (value < 0) { *--begin = '-'; }
+		return copy_number(buffer, size, begin, end);
 	}
 
-	// error behavior from: https://docs.microsoft.com/en-us/cpp/c-runtime-library/reference/gcvt-s?view=msvc-160
+	// Same text as printf("%.7f") with trailing zeros and point removed,
+	//  independent of the locale
 	inline int toStr(char * buffer, size_t size, float value) {
-#ifdef WIN32
-		return _gcvt_s(buffer, size, value, 7); // number of significant digits
-#else
-		if ( buffer == nullptr || size < 1 ) { return EINVAL; }
-		int res = snprintf(buffer, size, "%.7f", value);
-		if (res < 0 || res >= size) { return EINVAL; }
-		// trunc cat zeros B007
-		char* itr = buffer + res - 1;
-		while(*itr == '0') { *itr--=0; --res; }
-		if (*itr == '.') { *itr-- = 0; --res;}
-		return 0;
-#endif
+		char digits[48];
+		char* end = digits + sizeof(digits);
+		char* begin = end;
+		double magnitude = std::fabs(static_cast<double>(value));
+		if (magnitude < 1e11) {
+			// a float times 1e7 is exact in a double, so this rounds like printf
+			uint64_t fixed = static_cast<uint64_t>(std::nearbyint(magnitude * 1e7));
+			uint64_t fraction = fixed % 10000000;
+			if (fraction != 0) {
+				int precision = 7;
+				while (fraction % 10 == 0) { fraction /= 10; --precision; }
+				begin = write_digits(end, fraction);
+				while (end - begin < precision) { *--begin = '0'; }
+				*--begin = '.';
+			}
+			begin = write_digits(begin, fixed / 10000000);
+		} else if (magnitude < 18446744073709551616.0) {
+			// floats this large are integers
+			begin = write_digits(end, static_cast<uint64_t>(magnitude));
+		} else if (std::isfinite(magnitude)) {
+			// exact integer mantissa * 2^exponent, doubled in base 1e9 limbs
+			int exponent;
+			uint32_t limbs[5] = { static_cast<uint32_t>(std::ldexp(std::frexp(magnitude, &exponent), 24)) };
+			size_t used = 1;
+			for (exponent -= 24; exponent > 0; --exponent) {
+				uint32_t carry = 0;
+				for (size_t i = 0; i < used; ++i) {
+					uint32_t doubled = limbs[i] * 2 + carry;
+					carry = doubled >= 1000000000u;
+					limbs[i] = doubled - carry * 1000000000u;
+				}
+				if (carry) { limbs[used++] = carry; }
+			}
+			for (size_t i = 0; i + 1 < used; ++i) {
+				char* limb_end = begin;
+				begin = write_digits(begin, limbs[i]);
+				while (limb_end - begin < 9) { *--begin = '0'; }
+			}
+			begin = write_digits(begin, limbs[used - 1]);
+		} else {
+			const char* text = std::isnan(magnitude) ? "nan" : "inf";
+			begin -= 3;
+			for (int i = 0; i < 3; ++i) { begin[i] = text[i]; }
+		}
+		if (std::signbit(value)) { *--begin = '-'; }
+		return copy_number(buffer, size, begin, end);
 	}
 
 	inline int toStr(char* buffer, size_t size, const char* c) {
 		char* ptr = buffer;
 		size_t i = 0;
 		while(*c && i < size) {
-			*ptr++ = *c;
+			*ptr++ = *c++;
 			++i;
 		}
 		if (i >= size) { return EINVAL; }
@@ -74,7 +141,8 @@ namespace ink::runtime::internal {
 			case value_type::newline:
 				return toStr(buffer, size, "\n");
 			default:
-				throw ink_exception("only support toStr for numeric types");
+				inkFail("only support toStr for numeric types");
+				return EINVAL;
 		}
 	}
 
@@ -92,7 +160,8 @@ namespace ink::runtime::internal {
 	}
 
 	inline constexpr size_t decimal_digits(float number) {
-		return decimal_digits(static_cast<int32_t>(number)) + 8;
+		// sign, point and 7 decimals, or the longest float
+		return number > -1e9f && number < 1e9f ? decimal_digits(static_cast<int32_t>(number)) + 9 : 47;
 	}
 
 	inline constexpr size_t value_length(const value& v) {
@@ -108,7 +177,8 @@ namespace ink::runtime::internal {
 			case value_type::newline:
 				return 1;
 			default:
-				throw ink_exception("Can't determine length of this value type");
+				inkFail("Can't determine length of this value type");
+				return 0;
 		}
 	}
 
@@ -117,6 +187,26 @@ namespace ink::runtime::internal {
 		return *lh == *rh;
 	}
 
+	/** checks if clean_string would keep a string as it is
+	 * @param begin iterator of string
+	 * @param end iterator of string
+	 * @return true if nothing would be removed
+	 */
+	template<bool LEADING_SPACES, bool TAILING_SPACES, typename ITR>
+	inline constexpr bool is_clean_string(ITR begin, ITR end) {
+		for(auto src = begin; src != end; ++src){
+			if (src == begin) {
+				if (LEADING_SPACES && (src[0] == ' ' || src[0] == '\n')) { return false; }
+			}
+			else if(src[-1] == '\n' && (src[0] == ' ' || src[0] == '\n')) { return false; }
+			else if ( src[0] == ' ' && ( ( src + 1 == end && TAILING_SPACES ) || (( src + 1 != end ) && ( src[1] == ' ' || src[1] == '\n' ) ) ) )
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
 	/** removes leading & tailing spaces as wide spaces
 	 * @param begin iterator of string
 	 * @param end iterator of string
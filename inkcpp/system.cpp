@@ -1,4 +1,8 @@
 #include "system.h"
+#include "error.h"
+
+#include <cstdio>
+#include <cstdlib>
 
 #ifndef INK_ENABLE_UNREAL
 
@@ -29,8 +33,49 @@ namespace ink
 	void ink_assert(bool condition, const char* msg /*= nullptr*/)
 	{
 		if (!condition)
+		{
+#ifdef INK_ENABLE_EXCEPTIONS
 			throw ink_exception(msg);
+#else
+			runtime::internal::raise_error(msg);
+#endif
+		}
+	}
+
+#ifndef INK_ENABLE_EXCEPTIONS
+	namespace runtime::internal
+	{
+		thread_local error_scope* current_error_scope = nullptr;
+
+		error_scope::error_scope()
+			: _prev{current_error_scope}
+		{
+			current_error_scope = this;
+		}
+
+		error_scope::~error_scope()
+		{
+			current_error_scope = _prev;
+		}
+
+		void raise_error(const char* msg)
+		{
+			error_scope* scope = current_error_scope;
+			if (scope == nullptr)
+			{
+				// nobody to report to
+				std::fprintf(stderr, "ink error: %s\n", msg ? msg : "unknown");
+				std::abort();
+			}
+			// the first error is the cause, later ones follow from it
+			if (!scope->_failed)
+			{
+				scope->_failed = true;
+				scope->_message = msg;
+			}
+		}
 	}
+#endif
 
 }
 
@@ -21,7 +21,10 @@ namespace ink::runtime::internal
 	void append<value_type::list_flag>(std::ostream& os, const value& val,
 			const list_table* lists) {
 		if (val.type() == value_type::list_flag) {
-			inkAssert(lists, "to stringify lists, we need a list_table");
+			if (lists == nullptr) {
+				inkFail("to stringify lists, we need a list_table");
+				return;
+			}
 			os << lists->toString(val.get<value_type::list_flag>());
 		} else {
 			append<value_type::list_flag + 1>(os, val, lists);
@@ -31,7 +34,10 @@ namespace ink::runtime::internal
 	void append<value_type::list>(std::ostream& os, const value& val,
 			const list_table* lists) {
 		if (val.type() == value_type::list) {
-			inkAssert(lists, "to stringify lists, we need a list_table");
+			if (lists == nullptr) {
+				inkFail("to stringify lists, we need a list_table");
+				return;
+			}
 			lists->write(os, val.get<value_type::list>());
 		} else {
 			append<value_type::list +1>(os, val, lists);
@@ -58,7 +64,7 @@ namespace ink::runtime::internal
 
 	std::ostream& value::write(std::ostream& os, const list_table* lists) const {
 		if (type() < value_type::PRINT_BEGIN || type() >= value_type::PRINT_END) {
-			throw ink_exception("printing this type is not supported");
+			inkFail("printing this type is not supported");
 		}
 		append(os, *this, lists);
 		return os;
@@ -61,14 +61,37 @@ namespace ink::runtime::internal {
 
 	struct string_type{
 		constexpr string_type(const char* string, bool allocated)
-			: str{string}, allocated{allocated}{}
+			: str{string}, allocated{allocated}, flags{CommandFlag::NO_FLAGS}{}
 		constexpr string_type(const char* string)
-			: str{string}, allocated{true} {}
+			: str{string}, allocated{true}, flags{CommandFlag::NO_FLAGS} {}
+		constexpr string_type(const char* string, bool allocated, CommandFlag flags)
+			: str{string}, allocated{allocated}, flags{flags}{}
 		operator const char*() const {
 			return str;
 		}
+
+		// Checks if the string is only whitespace. Story text is classified
+		//  by the compiler, other strings are scanned
+		bool is_whitespace(bool includeNewline = true) const {
+			if (flags & CommandFlag::STRING_IS_CLASSIFIED)
+				return flags & (includeNewline ? CommandFlag::STRING_IS_WHITESPACE : CommandFlag::STRING_IS_BLANK);
+			return ink::is_whitespace(str, includeNewline);
+		}
+
+		// Checks if the string only consists of isspace() characters
+		bool is_space() const {
+			if (flags & CommandFlag::STRING_IS_CLASSIFIED)
+				return flags & CommandFlag::STRING_IS_SPACE;
+			for (const char* i = str; *i; ++i)
+				// isspace only supports characters in [0, UCHAR_MAX]
+				if (!isspace(static_cast<unsigned char>(*i)))
+					return false;
+			return true;
+		}
+
 		const char* str;
 		bool allocated;
+		CommandFlag flags; // string flags of story text
 	};
 
 	class value;
@@ -130,7 +153,8 @@ namespace ink::runtime::internal {
 		template<value_type ty, typename ... T>
 		value redefine(const value& oth, const tuple<T*...>& env) const {
 			if constexpr ( ty == value_type::OP_END) {
-				throw ink_exception("Can't redefine value with this type! (It is not an variable type!)");
+				inkFail("Can't redefine value with this type! (It is not an variable type!)");
+				return *this;
 			} else if (ty != type()) {
 				return redefine<ty + 1>(oth, env);
 			} else {
@@ -0,0 +1,623 @@
+// inkcpp_bench.cpp : Measures loading and playing speed of a corpus of ink stories.
+//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+
+#include <story.h>
+#include <runner.h>
+#include <globals.h>
+#include <snapshot.h>
+#include <allocator.h>
+#include <compiler.h>
+#include <version.h>
+
+#include "../inkcpp_cl/test.h"
+#include "../inkcpp/string_utils.h"
+
+// == Heap accounting ==
+// Every allocation of the process goes through these, so the runtime's heap
+//  use can be measured without external tools. A header in front of each
+//  block remembers its size, or that it was made while accounting was paused.
+namespace
+{
+	constexpr size_t HeapHeader = alignof(std::max_align_t) > sizeof(size_t) ? alignof(std::max_align_t) : sizeof(size_t);
+	constexpr size_t Untracked = ~size_t(0);
+
+	std::atomic<size_t> heap_allocations{0};
+	std::atomic<size_t> heap_bytes{0};
+	std::atomic<size_t> heap_peak{0};
+	thread_local bool heap_paused = false;
+
+	// Excludes the benchmark's own bookkeeping from the heap statistics
+	struct heap_pause
+	{
+		heap_pause() { heap_paused = true; }
+		~heap_pause() { heap_paused = false; }
+	};
+
+	void* heap_alloc(size_t size)
+	{
+		unsigned char* block = static_cast<unsigned char*>(std::malloc(size + HeapHeader));
+		if (block == nullptr)
+			throw std::bad_alloc();
+		*reinterpret_cast<size_t*>(block) = heap_paused ? Untracked : size;
+		if (heap_paused)
+			return block + HeapHeader;
+
+		heap_allocations.fetch_add(1, std::memory_order_relaxed);
+		size_t now = heap_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+		size_t peak = heap_peak.load(std::memory_order_relaxed);
+		while (now > peak && !heap_peak.compare_exchange_weak(peak, now, std::memory_order_relaxed)) { }
+		return block + HeapHeader;
+	}
+
+	void heap_free(void* ptr)
+	{
+		if (ptr == nullptr)
+			return;
+		unsigned char* block = static_cast<unsigned char*>(ptr) - HeapHeader;
+		size_t size = *reinterpret_cast<size_t*>(block);
+		if (size != Untracked)
+			heap_bytes.fetch_sub(size, std::memory_order_relaxed);
+		std::free(block);
+	}
+}
+
+void* operator new(size_t size) { return heap_alloc(size); }
+void* operator new[](size_t size) { return heap_alloc(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	try { return heap_alloc(size); } catch (...) { return nullptr; }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	try { return heap_alloc(size); } catch (...) { return nullptr; }
+}
+void operator delete(void* ptr) noexcept { heap_free(ptr); }
+void operator delete[](void* ptr) noexcept { heap_free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { heap_free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { heap_free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { heap_free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { heap_free(ptr); }
+
+namespace
+{
+	using namespace ink::runtime;
+	using clock = std::chrono::steady_clock;
+
+	void usage()
+	{
+		using namespace std;
+		cout
+			<< "Usage: inkcpp_bench <options> <directories, ink or ink JSON files>\n"
+			<< "\t-o <filename>:\tWrite the JSON results to a file instead of stdout\n"
+			<< "\t-n <count>:\tPlay each story this many times per policy (default 10)\n"
+			<< "\t-c <count>:\tStop a play-through after this many choices (default 1000)\n"
+			<< "\t-s <count>:\tSessions to create and destroy per allocator (default 200)\n"
+			<< endl;
+	}
+
+	// Deterministic ways to pick a choice
+	enum class policy { first, last, cycle, random };
+	const policy Policies[] = { policy::first, policy::last, policy::cycle, policy::random };
+
+	const char* policy_name(policy p)
+	{
+		switch (p)
+		{
+		case policy::first: return "first";
+		case policy::last: return "last";
+		case policy::cycle: return "cycle";
+		case policy::random: return "random";
+		}
+		return "";
+	}
+
+	size_t pick(policy p, size_t turn, size_t num_choices, uint32_t& seed)
+	{
+		switch (p)
+		{
+		case policy::first: return 0;
+		case policy::last: return num_choices - 1;
+		case policy::cycle: return turn % num_choices;
+		case policy::random:
+			seed = seed * 1103515245u + 12345u;
+			return (seed >> 16) % num_choices;
+		}
+		return 0;
+	}
+
+	struct policy_result
+	{
+		policy which;
+		size_t lines = 0;
+		size_t choices = 0;
+		double seconds = 0;
+		std::vector<uint64_t> getline_ns;
+		size_t allocations = 0;
+		size_t peak_heap = 0;
+		std::string error;
+	};
+
+	struct story_result
+	{
+		std::string name;
+		std::string error;
+		double load_us = 0;
+		size_t binary_size = 0;
+		double session_heap_us = 0;
+		double session_arena_us = 0;
+		double globals_us = 0;
+		double session_reset_us = 0;
+		double replay_us = 0;
+		double replay_fast_us = 0;
+		size_t snapshot_size = 0;
+		double snapshot_save_us = 0;
+		double snapshot_load_us = 0;
+		std::vector<policy_result> policies;
+	};
+
+	// Without exceptions a failed call only sets the result of the runner.
+	//  Raise it, so the callers report it like a thrown error
+	void check(runner& thread)
+	{
+		if (thread->last_result() == run_result::error)
+			throw std::runtime_error(thread->last_error() ? thread->last_error() : "runner failed");
+	}
+
+	policy_result play(story& ink, policy which, size_t repeats, size_t max_choices)
+	{
+		policy_result result;
+		result.which = which;
+
+		size_t heap_base = heap_bytes.load();
+		heap_peak.store(heap_base);
+		size_t allocations_base = heap_allocations.load();
+
+		auto start = clock::now();
+		for (size_t r = 0; r < repeats; ++r)
+		{
+			uint32_t seed = 1;
+			runner thread = ink.new_runner();
+			for (size_t turn = 0; ; ++turn)
+			{
+				while (thread->can_continue())
+				{
+					auto line_start = clock::now();
+					thread->getline();
+					auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - line_start).count();
+					heap_pause pause;
+					result.getline_ns.push_back(elapsed);
+					result.lines += 1;
+					check(thread);
+				}
+				if (!thread->has_choices() || turn >= max_choices)
+					break;
+				thread->choose(pick(which, turn, thread->num_choices(), seed));
+				check(thread);
+				result.choices += 1;
+			}
+		}
+		result.seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+		result.allocations = heap_allocations.load() - allocations_base;
+		result.peak_heap = heap_peak.load() - heap_base;
+		return result;
+	}
+
+	// Average time of creating a session, playing to its first choice and
+	//  destroying it, with the default heap or one reused arena
+	double churn(story& ink, size_t sessions, bool use_arena)
+	{
+		arena_allocator arena;
+		auto start = clock::now();
+		for (size_t i = 0; i < sessions; ++i)
+		{
+			{
+				runner thread = ink.new_runner(nullptr, use_arena ? &arena : nullptr);
+				while (thread->can_continue())
+				{
+					thread->getline();
+					check(thread);
+				}
+			}
+			arena.reset();
+		}
+		return std::chrono::duration<double, std::micro>(clock::now() - start).count() / (sessions ? sessions : 1);
+	}
+
+	// Like churn, but reuses one session by resetting it
+	double reset_churn(story& ink, size_t sessions)
+	{
+		globals store = ink.new_globals();
+		runner thread = ink.new_runner(store);
+		auto start = clock::now();
+		for (size_t i = 0; i < sessions; ++i)
+		{
+			while (thread->can_continue())
+			{
+				thread->getline();
+				check(thread);
+			}
+			store->reset();
+			thread->reset();
+		}
+		return std::chrono::duration<double, std::micro>(clock::now() - start).count() / (sessions ? sessions : 1);
+	}
+
+	// Average time of playing a session with the cycle policy, reading
+	//  the text or fast-forwarding
+	double replay(story& ink, size_t sessions, size_t max_choices, bool fast)
+	{
+		auto start = clock::now();
+		for (size_t i = 0; i < sessions; ++i)
+		{
+			runner thread = ink.new_runner();
+			thread->set_fast_forward(fast);
+			for (size_t turn = 0; ; ++turn)
+			{
+				while (thread->can_continue())
+				{
+					thread->getline();
+					check(thread);
+				}
+				if (!thread->has_choices() || turn >= max_choices)
+					break;
+				thread->choose(turn % thread->num_choices());
+				check(thread);
+			}
+		}
+		return std::chrono::duration<double, std::micro>(clock::now() - start).count() / (sessions ? sessions : 1);
+	}
+
+	// Average time of writing a snapshot of a session and of restoring a
+	//  runner from it, taken after up to max_choices turns of the cycle policy
+	void snapshot_round_trip(story& ink, size_t sessions, size_t max_choices, story_result& result)
+	{
+		runner thread = ink.new_runner();
+		for (size_t turn = 0; ; ++turn)
+		{
+			while (thread->can_continue())
+			{
+				thread->getline();
+				check(thread);
+			}
+			if (!thread->has_choices() || turn >= max_choices)
+				break;
+			thread->choose(turn % thread->num_choices());
+			check(thread);
+		}
+
+		auto start = clock::now();
+		for (size_t i = 0; i < sessions; ++i)
+			std::unique_ptr<snapshot>{thread->create_snapshot()};
+		result.snapshot_save_us = std::chrono::duration<double, std::micro>(clock::now() - start).count() / (sessions ? sessions : 1);
+
+		std::unique_ptr<snapshot> snap{thread->create_snapshot()};
+		result.snapshot_size = snap->get_data_len();
+		start = clock::now();
+		for (size_t i = 0; i < sessions; ++i)
+			runner restored = ink.new_runner_from_snapshot(*snap);
+		result.snapshot_load_us = std::chrono::duration<double, std::micro>(clock::now() - start).count() / (sessions ? sessions : 1);
+	}
+
+	// Average time of creating and destroying a global store
+	double globals_churn(story& ink, size_t sessions)
+	{
+		auto start = clock::now();
+		for (size_t i = 0; i < sessions; ++i)
+			globals store = ink.new_globals();
+		return std::chrono::duration<double, std::micro>(clock::now() - start).count() / (sessions ? sessions : 1);
+	}
+
+	story_result bench(const std::filesystem::path& ink_file, size_t repeats, size_t max_choices, size_t sessions)
+	{
+		story_result result;
+		result.name = ink_file.filename().string();
+
+		std::string json_file = (std::filesystem::temp_directory_path() / "inkcpp_bench.tmp").string();
+		std::string bin_file = (std::filesystem::temp_directory_path() / "inkcpp_bench.bin").string();
+		try
+		{
+			// ink JSON, e.g. from inkcpp_generate, needs no inklecate
+			if (ink_file.extension() == ".json")
+				json_file = ink_file.string();
+			else
+				inklecate(ink_file.string(), json_file);
+			ink::compiler::compilation_results results;
+			ink::compiler::run(json_file.c_str(), bin_file.c_str(), &results);
+			if (!results.errors.empty())
+			{
+				result.error = results.errors.front();
+				return result;
+			}
+			result.binary_size = std::filesystem::file_size(bin_file);
+
+			// load time, averaged
+			const size_t loads = 100;
+			auto start = clock::now();
+			for (size_t i = 0; i < loads; ++i)
+				std::unique_ptr<story>{story::from_file(bin_file.c_str())};
+			result.load_us = std::chrono::duration<double, std::micro>(clock::now() - start).count() / loads;
+
+			load_result loaded;
+			std::unique_ptr<story> ink{story::from_file(bin_file.c_str(), &loaded)};
+			if (!ink)
+			{
+				result.error = loaded.error;
+				return result;
+			}
+			try
+			{
+				result.session_heap_us = churn(*ink, sessions, false);
+				result.session_arena_us = churn(*ink, sessions, true);
+				result.globals_us = globals_churn(*ink, sessions);
+				result.session_reset_us = reset_churn(*ink, sessions);
+				result.replay_us = replay(*ink, repeats, max_choices, false);
+				result.replay_fast_us = replay(*ink, repeats, max_choices, true);
+				snapshot_round_trip(*ink, sessions, max_choices, result);
+			}
+			catch (const std::exception&)
+			{
+				// the policies below report the error
+			}
+			for (policy p : Policies)
+			{
+				try
+				{
+					result.policies.push_back(play(*ink, p, repeats, max_choices));
+				}
+				catch (const std::exception& e)
+				{
+					policy_result failed;
+					failed.which = p;
+					failed.error = e.what();
+					result.policies.push_back(failed);
+				}
+			}
+		}
+		catch (const std::exception& e)
+		{
+			result.error = e.what();
+		}
+		return result;
+	}
+
+	// Nanoseconds per number written by the runtime's formatter and by printf
+	struct format_result
+	{
+		double int_ns = 0;
+		double float_ns = 0;
+		double printf_int_ns = 0;
+		double printf_float_ns = 0;
+		// sum over the written text, which keeps the loops from being optimized away
+		size_t checksum = 0;
+	};
+
+	template<typename T, typename F>
+	double time_format(const std::vector<T>& numbers, size_t repeats, size_t& checksum, F format)
+	{
+		char buffer[64];
+		auto start = clock::now();
+		for (size_t r = 0; r < repeats; ++r)
+		{
+			for (T number : numbers)
+			{
+				format(buffer, sizeof(buffer), number);
+				checksum += static_cast<unsigned char>(buffer[0]);
+			}
+		}
+		double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+		return ns / (numbers.size() * repeats);
+	}
+
+	format_result bench_format(size_t repeats)
+	{
+		// stat-like numbers: counters, money and percentages
+		std::vector<int32_t> ints;
+		std::vector<float> floats;
+		uint32_t seed = 1;
+		for (size_t i = 0; i < 4096; ++i)
+		{
+			seed = seed * 1103515245u + 12345u;
+			ints.push_back(static_cast<int32_t>(seed >> 8) % 200000 - 100000);
+			floats.push_back(ints.back() / 100.f);
+		}
+
+		format_result result;
+		repeats *= 25;
+		result.int_ns = time_format(ints, repeats, result.checksum, [](char* buffer, size_t size, int32_t number) {
+			internal::toStr(buffer, size, number);
+		});
+		result.float_ns = time_format(floats, repeats, result.checksum, [](char* buffer, size_t size, float number) {
+			internal::toStr(buffer, size, number);
+		});
+		result.printf_int_ns = time_format(ints, repeats, result.checksum, [](char* buffer, size_t size, int32_t number) {
+			std::snprintf(buffer, size, "%d", number);
+		});
+		result.printf_float_ns = time_format(floats, repeats, result.checksum, [](char* buffer, size_t size, float number) {
+			std::snprintf(buffer, size, "%.7f", number);
+		});
+		return result;
+	}
+
+	std::string escape(const std::string& text)
+	{
+		std::string out;
+		for (char c : text)
+		{
+			switch (c)
+			{
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n"; break;
+			case '\t': out += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+				{
+					char buf[8];
+					std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+					out += buf;
+				}
+				else
+					out += c;
+			}
+		}
+		return out;
+	}
+
+	uint64_t percentile(std::vector<uint64_t>& samples, double p)
+	{
+		if (samples.empty())
+			return 0;
+		size_t index = static_cast<size_t>(p * (samples.size() - 1) + 0.5);
+		std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+		return samples[index];
+	}
+
+	// Throughput of a snapshot round trip: bytes written and read again per time
+	double mb_per_sec(size_t bytes, double us)
+	{
+		return us > 0 ? 2.0 * bytes / us : 0.0;
+	}
+
+	void write_json(std::ostream& out, std::vector<story_result>& stories, size_t repeats, const format_result& format)
+	{
+		out << "{\n  \"ink_bin_version\": " << ink::InkBinVersion
+#ifdef INK_ENABLE_EXCEPTIONS
+			<< ",\n  \"errors\": \"exceptions\""
+#else
+			<< ",\n  \"errors\": \"error_codes\""
+#endif
+			<< ",\n  \"repeats\": " << repeats
+			<< ",\n  \"format\": { \"int_ns\": " << format.int_ns
+			<< ", \"float_ns\": " << format.float_ns
+			<< ", \"printf_int_ns\": " << format.printf_int_ns
+			<< ", \"printf_float_ns\": " << format.printf_float_ns
+			<< ", \"checksum\": " << format.checksum << " }"
+			<< ",\n  \"stories\": [";
+		for (size_t s = 0; s < stories.size(); ++s)
+		{
+			story_result& story = stories[s];
+			out << (s ? "," : "") << "\n    {\n      \"name\": \"" << escape(story.name) << "\"";
+			if (!story.error.empty())
+			{
+				out << ",\n      \"error\": \"" << escape(story.error) << "\"\n    }";
+				continue;
+			}
+			out << ",\n      \"binary_bytes\": " << story.binary_size
+				<< ",\n      \"load_us\": " << story.load_us
+				<< ",\n      \"session_heap_us\": " << story.session_heap_us
+				<< ",\n      \"session_arena_us\": " << story.session_arena_us
+				<< ",\n      \"globals_us\": " << story.globals_us
+				<< ",\n      \"session_reset_us\": " << story.session_reset_us
+				<< ",\n      \"replay_us\": " << story.replay_us
+				<< ",\n      \"replay_fast_us\": " << story.replay_fast_us
+				<< ",\n      \"snapshot_bytes\": " << story.snapshot_size
+				<< ",\n      \"snapshot_save_us\": " << story.snapshot_save_us
+				<< ",\n      \"snapshot_load_us\": " << story.snapshot_load_us
+				<< ",\n      \"snapshot_mb_per_sec\": " << mb_per_sec(story.snapshot_size, story.snapshot_save_us + story.snapshot_load_us)
+				<< ",\n      \"policies\": [";
+			for (size_t p = 0; p < story.policies.size(); ++p)
+			{
+				policy_result& r = story.policies[p];
+				out << (p ? "," : "") << "\n        { \"policy\": \"" << policy_name(r.which) << "\"";
+				if (!r.error.empty())
+				{
+					out << ", \"error\": \"" << escape(r.error) << "\" }";
+					continue;
+				}
+				double seconds = r.seconds > 0 ? r.seconds : 1e-9;
+				out << ", \"lines\": " << r.lines
+					<< ", \"choices\": " << r.choices
+					<< ", \"lines_per_sec\": " << r.lines / seconds
+					<< ", \"choices_per_sec\": " << r.choices / seconds
+					<< ", \"getline_p50_ns\": " << percentile(r.getline_ns, 0.5)
+					<< ", \"getline_p99_ns\": " << percentile(r.getline_ns, 0.99)
+					<< ", \"peak_heap_bytes\": " << r.peak_heap
+					<< ", \"allocations_per_line\": " << (r.lines ? static_cast<double>(r.allocations) / r.lines : 0.0)
+					<< " }";
+			}
+			out << "\n      ]\n    }";
+		}
+		out << "\n  ]\n}\n";
+	}
+}
+
+int main(int argc, const char** argv)
+{
+	if (argc == 1)
+	{
+		usage();
+		return 1;
+	}
+
+	std::string outputFilename;
+	size_t repeats = 10;
+	size_t maxChoices = 1000;
+	size_t sessions = 200;
+	std::vector<std::filesystem::path> inputs;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "-o" && i + 1 < argc)
+			outputFilename = argv[++i];
+		else if (option == "-n" && i + 1 < argc)
+			repeats = std::stoul(argv[++i]);
+		else if (option == "-c" && i + 1 < argc)
+			maxChoices = std::stoul(argv[++i]);
+		else if (option == "-s" && i + 1 < argc)
+			sessions = std::stoul(argv[++i]);
+		else
+			inputs.push_back(option);
+	}
+
+	// Collect stories, sorted so runs are comparable
+	std::vector<std::filesystem::path> files;
+	for (const auto& input : inputs)
+	{
+		if (std::filesystem::is_directory(input))
+		{
+			for (const auto& entry : std::filesystem::directory_iterator(input))
+				if (entry.path().extension() == ".ink" || entry.path().extension() == ".json")
+					files.push_back(entry.path());
+		}
+		else
+			files.push_back(input);
+	}
+	std::sort(files.begin(), files.end());
+
+	std::vector<story_result> results;
+	for (const auto& file : files)
+	{
+		std::cerr << file.filename().string() << std::endl;
+		results.push_back(bench(file, repeats, maxChoices, sessions));
+	}
+
+	format_result format = bench_format(repeats);
+
+	if (outputFilename.empty())
+		write_json(std::cout, results, repeats, format);
+	else
+	{
+		std::ofstream out(outputFilename);
+		write_json(out, results, repeats, format);
+	}
+
+	return 0;
+}
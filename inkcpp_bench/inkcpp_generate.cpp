@@ -0,0 +1,229 @@
+// inkcpp_generate.cpp : Writes synthetic ink JSON stories of a given size, for scalability benchmarks.
+//
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+
+namespace
+{
+	void usage()
+	{
+		using namespace std;
+		cout
+			<< "Usage: inkcpp_generate <options>\n"
+			<< "\t-o <filename>:\tOutput file name (default stdout)\n"
+			<< "\t-k <count>:\tNumber of knots (default 100)\n"
+			<< "\t-d <depth>:\tNesting depth of counted containers inside each knot (default 1)\n"
+			<< "\t-v <count>:\tNumber of global variables (default 10)\n"
+			<< "\t-l <count>:\tNumber of items in a global list (default 0)\n"
+			<< "\t-c <count>:\tChoices per knot (default 2)\n"
+			<< "\t-t <depth>:\tDepth of the tunnel chain each knot calls (default 0)\n"
+			<< "\t-s <count>:\tLines of text per knot (default 3)\n"
+			<< "\t-w <count>:\tWords per line (default 8)\n"
+			<< endl;
+	}
+
+	struct parameters
+	{
+		int knots = 100;
+		int depth = 1;
+		int variables = 10;
+		int list_items = 0;
+		int choices = 2;
+		int tunnels = 0;
+		int lines = 3;
+		int words = 8;
+	};
+
+	const char* Words[] = {
+		"the", "quick", "brown", "fox", "jumps", "over", "a", "lazy", "dog",
+		"while", "rain", "falls", "on", "distant", "hills", "and", "rivers",
+	};
+
+	// The compiler sorts named containers, so names are zero padded to keep
+	//  knots in story order. All diverts then point forward.
+	class generator
+	{
+	public:
+		generator(const parameters& p)
+			: _p(p)
+		{
+			_width = 1;
+			for (int n = p.knots - 1; n >= 10; n /= 10)
+				++_width;
+		}
+
+		void write(std::ostream& out)
+		{
+			out << "{\"inkVersion\": 20, \"root\": [[\"^Start.\", \"\\n\", {\"->\": \"" << knot(0) << "\"}, "
+				<< "[\"done\", {\"#f\": 5, \"#n\": \"g-0\"}], null], \"done\", {";
+			for (int k = 0; k < _p.knots; ++k)
+			{
+				out << "\"" << knot(k) << "\": ";
+				write_knot(out, k);
+				out << ", ";
+			}
+			for (int t = 0; t < _p.tunnels; ++t)
+			{
+				out << "\"" << tunnel(t) << "\": ";
+				write_tunnel(out, t);
+				out << ", ";
+			}
+			write_globals(out);
+			out << "}], \"listDefs\": {";
+			if (_p.list_items > 0)
+			{
+				out << "\"items\": {";
+				for (int i = 0; i < _p.list_items; ++i)
+					out << (i ? ", " : "") << "\"i" << i << "\": " << i + 1;
+				out << "}";
+			}
+			out << "}}\n";
+		}
+
+	private:
+		std::string knot(int k) const
+		{
+			std::string digits = std::to_string(k);
+			return "k" + std::string(_width - digits.size(), '0') + digits;
+		}
+
+		std::string tunnel(int t) const { return "t" + std::to_string(t); }
+		std::string variable(int v) const { return "v" + std::to_string(v); }
+
+		void write_knot(std::ostream& out, int k)
+		{
+			// wrap the content into nested counted containers
+			out << "[";
+			for (int d = 0; d < _p.depth; ++d)
+				out << "[";
+
+			for (int line = 0; line < _p.lines; ++line)
+			{
+				out << "\"^" << knot(k) << ":";
+				for (int w = 0; w < _p.words; ++w)
+					out << " " << Words[(k * 7 + line * 3 + w) % (sizeof(Words) / sizeof(const char*))];
+				out << "\", \"\\n\", ";
+			}
+
+			if (_p.variables > 0)
+			{
+				std::string written = variable(k % _p.variables);
+				std::string read = variable((k * 7) % _p.variables);
+				out << "\"ev\", {\"VAR?\": \"" << written << "\"}, 1, \"+\", {\"VAR=\": \"" << written << "\", \"re\": true}, \"/ev\", "
+					<< "\"^Value \", \"ev\", {\"VAR?\": \"" << read << "\"}, \"out\", \"/ev\", \"\\n\", ";
+			}
+
+			if (_p.list_items > 0)
+			{
+				int item = k % _p.list_items;
+				out << "\"ev\", {\"VAR?\": \"inventory\"}, {\"list\": {\"items.i" << item << "\": " << item + 1 << "}}, \"+\", "
+					<< "{\"VAR=\": \"inventory\", \"re\": true}, \"/ev\", "
+					<< "\"^Items \", \"ev\", {\"VAR?\": \"inventory\"}, \"LIST_COUNT\", \"out\", \"/ev\", \"\\n\", ";
+			}
+
+			if (_p.tunnels > 0)
+				out << "{\"->t->\": \"" << tunnel(0) << "\"}, ";
+
+			if (k == _p.knots - 1 || _p.choices <= 0)
+			{
+				out << "\"end\", null";
+			}
+			else
+			{
+				for (int c = 0; c < _p.choices; ++c)
+					out << "\"ev\", \"str\", \"^Option " << c << "\", \"/str\", \"/ev\", {\"*\": \".^.c-" << c << "\", \"flg\": 4}, ";
+				out << "{";
+				for (int c = 0; c < _p.choices; ++c)
+				{
+					int target = k + 1 + c < _p.knots ? k + 1 + c : _p.knots - 1;
+					out << (c ? ", " : "") << "\"c-" << c << "\": [\"\\n\", \"^Took option " << c << ".\", \"\\n\", "
+						<< "{\"->\": \"" << knot(target) << "\"}, {\"#f\": 5}]";
+				}
+				out << "}";
+			}
+
+			for (int d = 0; d < _p.depth; ++d)
+				out << "], {\"#f\": 1}";
+			out << "]";
+		}
+
+		void write_tunnel(std::ostream& out, int t)
+		{
+			out << "[\"^Tunnel " << t << ".\", \"\\n\", ";
+			if (t + 1 < _p.tunnels)
+				out << "{\"->t->\": \"" << tunnel(t + 1) << "\"}, ";
+			out << "\"->->\", {\"#f\": 1}]";
+		}
+
+		void write_globals(std::ostream& out)
+		{
+			out << "\"global decl\": [\"ev\", ";
+			for (int v = 0; v < _p.variables; ++v)
+				out << v << ", {\"VAR=\": \"" << variable(v) << "\"}, ";
+			if (_p.list_items > 0)
+				out << "{\"list\": {}, \"origins\": [\"items\"]}, {\"VAR=\": \"inventory\"}, ";
+			out << "\"/ev\", \"end\", null]";
+		}
+
+		parameters _p;
+		size_t _width;
+	};
+}
+
+int main(int argc, const char** argv)
+{
+	parameters p;
+	std::string outputFilename;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (i + 1 >= argc)
+		{
+			usage();
+			return 1;
+		}
+		const char* value = argv[++i];
+		if (option == "-o")
+			outputFilename = value;
+		else if (option == "-k")
+			p.knots = std::atoi(value);
+		else if (option == "-d")
+			p.depth = std::atoi(value);
+		else if (option == "-v")
+			p.variables = std::atoi(value);
+		else if (option == "-l")
+			p.list_items = std::atoi(value);
+		else if (option == "-c")
+			p.choices = std::atoi(value);
+		else if (option == "-t")
+			p.tunnels = std::atoi(value);
+		else if (option == "-s")
+			p.lines = std::atoi(value);
+		else if (option == "-w")
+			p.words = std::atoi(value);
+		else
+		{
+			std::cerr << "Unrecognized option: '" << option << "'\n";
+			usage();
+			return 1;
+		}
+	}
+	if (p.knots < 1)
+	{
+		std::cerr << "Need at least one knot" << std::endl;
+		return 1;
+	}
+
+	generator gen(p);
+	if (outputFilename.empty())
+		gen.write(std::cout);
+	else
+	{
+		std::ofstream out(outputFilename);
+		gen.write(out);
+	}
+	return 0;
+}
@@ -177,6 +177,10 @@ int main(int argc, const char** argv)
 			break;
 		}
 
+#ifdef INK_ENABLE_PROFILE
+		thread->get_profile().dump(std::cerr);
+#endif
+
 		return 0;
 	}
 	catch (const std::exception& e)
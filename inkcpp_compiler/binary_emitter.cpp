@@ -3,10 +3,15 @@
 #include "header.h"
 #include "version.h"
 #include "list_data.h"
+#include "bounds_analysis.h"
 
 #include <vector>
 #include <map>
+#include <set>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
 
 #ifndef WIN32
 #include <cstring>
@@ -53,6 +58,10 @@ namespace ink::compiler::internal
 		// parent pointer
 		container_data* parent = nullptr;
 
+		// name in the parent, or index in the parent if it has none
+		std::string name;
+		int index_in_parent = -1;
+
 		// Offset in the binary stream
 		uint32_t offset = 0;
 
@@ -97,6 +106,8 @@ namespace ink::compiler::internal
 		
 		// Parent it to the current container
 		container->parent = _current;
+		container->name = name;
+		container->index_in_parent = index_in_parent;
 		
 		// Set offset to the current position
 		container->offset = _containers.pos();
@@ -129,6 +140,33 @@ namespace ink::compiler::internal
 
 	void binary_emitter::write_raw(Command command, CommandFlag flag, const char* payload, ink::size_t payload_size)
 	{
+		uint32_t pos = static_cast<uint32_t>(_containers.pos());
+		_instructions.push_back(pos);
+
+		// The text of a choice is built by the last string evaluations before it
+		//  (its condition is evaluated after them). Mark them, so the runtime
+		//  knows which tags belong to the choice
+		if (command == Command::START_STR)
+		{
+			_open_strings.push_back(pos);
+		}
+		else if (command == Command::END_STR && !_open_strings.empty())
+		{
+			_strings_since_choice.push_back({ _open_strings.back(), pos });
+			_open_strings.pop_back();
+		}
+		else if (command == Command::CHOICE)
+		{
+			size_t num_texts = (flag & CommandFlag::CHOICE_HAS_START_CONTENT ? 1 : 0)
+				+ (flag & CommandFlag::CHOICE_HAS_CHOICE_ONLY_CONTENT ? 1 : 0);
+			for (size_t i = 0; i < num_texts && i < _strings_since_choice.size(); ++i)
+			{
+				const auto& text = _strings_since_choice[_strings_since_choice.size() - 1 - i];
+				_containers.set(text.first + sizeof(Command), CommandFlag::STRING_EVAL_IS_CHOICE_TEXT);
+				_containers.set(text.second + sizeof(Command), CommandFlag::STRING_EVAL_IS_CHOICE_TEXT);
+			}
+			_strings_since_choice.clear();
+		}
 		_containers.write(command);
 		_containers.write(flag);
 		if(payload_size > 0)
@@ -160,10 +198,20 @@ namespace ink::compiler::internal
 		uint32_t pos = _strings.pos();
 
 		// Write string to table (omit ^ if it begins with one)
-		if (string.length() > 0 && string[0] == '^')
-			_strings.write(string.substr(1));
-		else
-			_strings.write(string);
+		std::string text = string.length() > 0 && string[0] == '^' ? string.substr(1) : string;
+		_strings.write(text);
+
+		// Classify text once, so the runtime needs not scan it on every output
+		if (command == Command::STR)
+		{
+			flag |= CommandFlag::STRING_IS_CLASSIFIED;
+			if (ink::is_whitespace(text.c_str()))
+				flag |= CommandFlag::STRING_IS_WHITESPACE;
+			if (ink::is_whitespace(text.c_str(), false))
+				flag |= CommandFlag::STRING_IS_BLANK;
+			if (std::all_of(text.begin(), text.end(), [](char c) { return isspace(static_cast<unsigned char>(c)) != 0; }))
+				flag |= CommandFlag::STRING_IS_SPACE;
+		}
 
 		// Written position is what we write out in our command
 		write(command, pos, flag);
@@ -193,6 +241,15 @@ namespace ink::compiler::internal
 		out.write((const char*)&_ink_version, sizeof(decltype(_ink_version)));
 		out.write((const char*)&ink::InkBinVersion, sizeof(decltype(ink::InkBinVersion)));
 
+		// Write the buffer bounds
+		out.write((const char*)&_bounds_flags, sizeof(uint32_t));
+		out.write((const char*)_bounds, sizeof(_bounds));
+
+		// Container names go into the string table
+		std::vector<std::pair<container_t, uint32_t>> container_names(_max_container_index, { ~0u, 0u });
+		if (_root != nullptr)
+			collect_container_names(container_names, _root, "", ~0u);
+
 		// Write the string table
 		_strings.write_to(out);
 
@@ -215,6 +272,17 @@ namespace ink::compiler::internal
 		write_container_hash_map(out);
 		out.write((const char*)&END_MARKER, sizeof(uint32_t));
 
+		// Write enclosing container and name of each counted container
+		for (const auto& entry : container_names)
+		{
+			out.write((const char*)&entry.first, sizeof(container_t));
+			out.write((const char*)&entry.second, sizeof(uint32_t));
+		}
+
+		// Write the initial global variables
+		out.write((const char*)&_globals_count, sizeof(uint32_t));
+		_globals.write_to(out);
+
 		// Write the container data
 		_containers.write_to(out);
 
@@ -232,6 +300,13 @@ namespace ink::compiler::internal
 
 		// clear other data
 		_paths.clear();
+		_instructions.clear();
+		_open_strings.clear();
+		_strings_since_choice.clear();
+		_bounds_flags = 0;
+		_list_flags.clear();
+		_globals_count = 0;
+		_globals.reset();
 
 		if (_root != nullptr)
 			delete _root;
@@ -244,6 +319,193 @@ namespace ink::compiler::internal
 	{
 		// post process path commands
 		process_paths();
+
+		// bounds and globals need the resolved paths
+		std::ostringstream stream;
+		_containers.write_to(stream);
+		std::string data = stream.str();
+		std::vector<byte_t> code(data.begin(), data.end());
+
+		compute_bounds(code);
+		compute_globals_image(code);
+	}
+
+	void binary_emitter::compute_bounds(const std::vector<byte_t>& code)
+	{
+		using ink::internal::bound;
+		using ink::internal::header;
+
+		bounds_analysis analysis(code, _instructions);
+		if (_root != nullptr)
+		{
+			// The root, knots and global declarations may start on an empty callstack
+			analysis.add_root(_root->offset);
+			for (const auto& child : _root->named_children)
+				analysis.add_root(child.second->offset);
+
+			// Name tunnels and functions for reports
+			std::vector<std::pair<std::string, const container_data*>> open{ { "", _root } };
+			while (!open.empty())
+			{
+				auto [path, container] = open.back();
+				open.pop_back();
+				for (const auto& child : container->named_children)
+				{
+					std::string name = path.empty() ? child.first : path + "." + child.first;
+					analysis.set_name(child.second->offset, name);
+					open.push_back({ name, child.second });
+				}
+				for (const auto& child : container->indexed_children)
+					open.push_back({ path, child.second });
+			}
+		}
+		analysis.run(_bounds);
+
+		// List flags are global variables as well
+		_bounds[static_cast<size_t>(bound::global_variables)] += static_cast<uint32_t>(_list_flags.size());
+
+		// Counted containers nest as their markers in the container map
+		std::set<container_t> entered;
+		uint32_t depth = 0;
+		for (const auto& entry : _container_map)
+		{
+			if (!entered.erase(entry.second))
+				entered.insert(entry.second);
+			depth = std::max(depth, static_cast<uint32_t>(entered.size()));
+		}
+		_bounds[static_cast<size_t>(bound::container_depth)] = depth;
+
+		_bounds_flags = 0;
+		if (analysis.recursive())
+		{
+			_bounds_flags |= header::BoundsRecursive;
+			std::ostream& report = warn();
+			report << "Recursion through";
+			for (const std::string& name : analysis.recursive_names())
+				report << " '" << name << "'";
+			report << ": stack bounds of this story are unbounded, runtimes use their configured limits" << std::flush;
+		}
+	}
+
+	void binary_emitter::compute_globals_image(const std::vector<byte_t>& code)
+	{
+		using ink::internal::global_type;
+		using ink::internal::header;
+
+		// Entries in the order the runtime defines them: list flags first, then
+		//  the global declarations. A redefinition replaces the earlier entry
+		struct global
+		{
+			hash_t name;
+			global_type type;
+			uint32_t payload;
+		};
+		std::vector<global> globals;
+		std::map<hash_t, size_t> index_of;
+		auto define = [&globals, &index_of](const global& entry) {
+			auto [iter, inserted] = index_of.insert({ entry.name, globals.size() });
+			if (inserted)
+				globals.push_back(entry);
+			else
+				globals[iter->second] = entry;
+		};
+
+		for (const auto& [name, flag] : _list_flags)
+		{
+			uint32_t payload;
+			static_assert(sizeof(payload) == sizeof(flag));
+			std::memcpy(&payload, &flag, sizeof(payload));
+			define({ hash_string(name.c_str()), global_type::list_flag, payload });
+		}
+
+		// Evaluate the global declarations. Anything but constants leaves them to the runtime
+		bool constant = true;
+		const container_data* decl = nullptr;
+		if (_root != nullptr && _root->named_children.count("global decl"))
+			decl = _root->named_children.at("global decl");
+		if (decl != nullptr)
+		{
+			std::vector<std::pair<global_type, uint32_t>> eval;
+			bool in_string = false;
+			size_t num_parts = 0;
+			uint32_t string_part = header::EmptyString;
+			bool done = false;
+			auto iter = std::lower_bound(_instructions.begin(), _instructions.end(), decl->offset);
+			for (; constant && !done && iter != _instructions.end(); ++iter)
+			{
+				uint32_t offset = *iter;
+				Command cmd = static_cast<Command>(code[offset]);
+				CommandFlag flag = static_cast<CommandFlag>(code[offset + 1]);
+				uint32_t payload = 0;
+				if (offset + 2 + sizeof(uint32_t) <= code.size())
+					std::memcpy(&payload, &code[offset + 2], sizeof(payload));
+
+				switch (cmd)
+				{
+				case Command::START_EVAL:
+				case Command::END_EVAL:
+					break;
+				case Command::INT:
+					eval.push_back({ global_type::int32, payload });
+					break;
+				case Command::FLOAT:
+					eval.push_back({ global_type::float32, payload });
+					break;
+				case Command::BOOL:
+					eval.push_back({ global_type::boolean, payload ? 1u : 0u });
+					break;
+				case Command::LIST:
+					eval.push_back({ global_type::list, payload });
+					break;
+				case Command::DIVERT_VAL:
+					eval.push_back({ global_type::divert, payload });
+					break;
+				case Command::START_STR:
+					in_string = true;
+					num_parts = 0;
+					string_part = header::EmptyString;
+					break;
+				case Command::STR:
+					// only single literals are already in the string table
+					constant = in_string && num_parts++ == 0;
+					string_part = payload;
+					break;
+				case Command::END_STR:
+					constant = in_string;
+					in_string = false;
+					eval.push_back({ global_type::string, string_part });
+					break;
+				case Command::SET_VARIABLE:
+					constant = !eval.empty() && !(flag & CommandFlag::ASSIGNMENT_IS_REDEFINE);
+					if (constant)
+					{
+						define({ payload, eval.back().first, eval.back().second });
+						eval.pop_back();
+					}
+					break;
+				case Command::END:
+				case Command::DONE:
+					done = true;
+					break;
+				default:
+					constant = false;
+					break;
+				}
+			}
+			constant = constant && done && eval.empty();
+		}
+
+		_globals.reset();
+		_globals_count = constant ? static_cast<uint32_t>(globals.size()) : header::NoGlobalsImage;
+		if (constant)
+		{
+			for (const global& entry : globals)
+			{
+				_globals.write(entry.name);
+				_globals.write(entry.type);
+				_globals.write(entry.payload);
+			}
+		}
 	}
 
 	void binary_emitter::setContainerIndex(container_t index)
@@ -396,12 +658,33 @@ namespace ink::compiler::internal
 		}
 	}
 
+	void binary_emitter::collect_container_names(std::vector<std::pair<container_t, uint32_t>>& names,
+		const container_data* context, const std::string& path, container_t parent)
+	{
+		// Counted containers get their full path as name, and enclose their children
+		if (context->counter_index != ~0)
+		{
+			uint32_t pos = _strings.pos();
+			_strings.write(path.empty() ? std::string("<root>") : path);
+			names[context->counter_index] = { parent, pos };
+			parent = context->counter_index;
+		}
+
+		for (auto child : context->children)
+		{
+			std::string child_name = child->name.empty() ? std::to_string(child->index_in_parent) : child->name;
+			collect_container_names(names, child, path.empty() ? child_name : (path + "." + child_name), parent);
+		}
+	}
+
 	void binary_emitter::set_list_meta(const list_data &list_defs) {
 		if (list_defs.empty()) {
 			return;
 		}
 
 		auto flags = list_defs.get_flags();
+		for (const auto& flag : flags)
+			_list_flags.push_back({ flag.name, flag.flag });
 		auto list_names = list_defs.get_list_names().begin();
 		int list_id = -1;
 		for(const auto& flag : flags) {
@@ -2,6 +2,7 @@
 
 #include "emitter.h"
 #include "binary_stream.h"
+#include "header.h"
 
 namespace ink::compiler::internal
 {
@@ -42,6 +43,9 @@ namespace ink::compiler::internal
 		void write_container_map(std::ostream&, const container_map&, container_t);
 		void write_container_hash_map(std::ostream&);
 		void write_container_hash_map(std::ostream&, const std::string&, const container_data*);
+		void collect_container_names(std::vector<std::pair<container_t, uint32_t>>&, const container_data*, const std::string&, container_t);
+		void compute_bounds(const std::vector<byte_t>& code);
+		void compute_globals_image(const std::vector<byte_t>& code);
 
 	private:
 		container_data* _root;
@@ -54,5 +58,22 @@ namespace ink::compiler::internal
 		binary_stream _containers;
 
 		std::vector<std::tuple<size_t, std::string, container_data*, bool>> _paths;
+
+		// start offset of every instruction, for the bounds analysis
+		std::vector<uint32_t> _instructions;
+
+		// START_STR offsets of open string evaluations, and the START_STR and
+		//  END_STR offsets of the ones finished since the last choice
+		std::vector<uint32_t> _open_strings;
+		std::vector<std::pair<uint32_t, uint32_t>> _strings_since_choice;
+		uint32_t _bounds_flags = 0;
+		uint32_t _bounds[ink::internal::header::NumBounds] = {};
+
+		// names of the list flags, which are global variables too
+		std::vector<std::pair<std::string, list_flag>> _list_flags;
+
+		// initial global variables, if the global declarations are constant
+		uint32_t _globals_count = 0;
+		binary_stream _globals;
 	};
 }
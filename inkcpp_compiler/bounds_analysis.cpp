@@ -0,0 +1,516 @@
+#include "bounds_analysis.h"
+
+#include "command.h"
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+
+namespace ink::compiler::internal
+{
+	using ink::internal::header;
+	using ink::internal::bound;
+
+	namespace
+	{
+		// Values saturate here. Unbounded plus anything stays unbounded
+		constexpr int Unbounded = 1 << 28;
+		constexpr int None = -1;
+
+		// A state updated more often than this is in a loop which keeps growing it
+		constexpr int WidenAfter = 32;
+
+		int add(int a, int b)
+		{
+			if (a >= Unbounded || b >= Unbounded)
+				return Unbounded;
+			return std::min(a + b, Unbounded);
+		}
+
+		uint32_t to_bound(int value)
+		{
+			return value >= Unbounded ? header::Unbounded : static_cast<uint32_t>(std::max(value, 0));
+		}
+	}
+
+	struct bounds_analysis::routine
+	{
+		summary& result;
+
+		// state before each instruction, keyed by index * 2 + evaluation mode
+		std::unordered_map<uint32_t, state> states{};
+		std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> work{};
+
+		// names of the temporaries it defines
+		std::set<uint32_t> temps{};
+		int callee_stack = 0;
+	};
+
+	bounds_analysis::bounds_analysis(const std::vector<byte_t>& code, const std::vector<uint32_t>& offsets)
+		: _code(code), _offsets(offsets), _visited(offsets.size(), false)
+	{
+	}
+
+	void bounds_analysis::add_root(uint32_t offset)
+	{
+		_roots.push_back(offset);
+	}
+
+	void bounds_analysis::set_name(uint32_t offset, const std::string& name)
+	{
+		_names.insert({ offset, name });
+	}
+
+	uint32_t bounds_analysis::index_of(uint32_t offset) const
+	{
+		return static_cast<uint32_t>(std::lower_bound(_offsets.begin(), _offsets.end(), offset) - _offsets.begin());
+	}
+
+	std::string bounds_analysis::name_of(uint32_t index) const
+	{
+		uint32_t offset = index < _offsets.size() ? _offsets[index] : static_cast<uint32_t>(_code.size());
+		auto iter = _names.find(offset);
+		if (iter != _names.end())
+			return iter->second;
+		return "offset " + std::to_string(offset);
+	}
+
+	std::vector<std::string> bounds_analysis::recursive_names() const
+	{
+		std::vector<std::string> names;
+		for (uint32_t index : _recursive)
+			names.push_back(name_of(index));
+		return names;
+	}
+
+	void bounds_analysis::run(uint32_t bounds[header::NumBounds])
+	{
+		// Collect divert targets and global variables
+		std::set<uint32_t> globals;
+		_divert_targets.clear();
+		for (uint32_t i = 0; i < _offsets.size(); ++i)
+		{
+			uint32_t offset = _offsets[i];
+			uint32_t end = i + 1 < _offsets.size() ? _offsets[i + 1] : static_cast<uint32_t>(_code.size());
+			if (end - offset < 2 + sizeof(uint32_t))
+				continue;
+			uint32_t payload;
+			std::memcpy(&payload, &_code[offset + 2], sizeof(uint32_t));
+			Command cmd = static_cast<Command>(_code[offset]);
+			if (cmd == Command::DIVERT_VAL)
+				_divert_targets.push_back(payload);
+			else if (cmd == Command::SET_VARIABLE)
+				globals.insert(payload);
+		}
+
+		int depth = 0, threads = 0, stack = 0, eval = 0;
+		int counters[NUM_COUNTERS] = {};
+		bool first = true;
+		for (uint32_t offset : _roots)
+		{
+			// Containers already reached from an earlier root are covered
+			uint32_t index = index_of(offset);
+			if (index >= _offsets.size() || (!first && _visited[index]))
+				continue;
+			first = false;
+
+			const summary& s = analyze(index);
+			depth = std::max(depth, s.depth);
+			threads = std::max(threads, s.threads);
+			eval = std::max(eval, s.eval_peak);
+			for (int c = 0; c < NUM_COUNTERS; ++c)
+				counters[c] = std::max({ counters[c], s.peak[c].rel, s.peak[c].abs });
+			stack = std::max(stack, add(s.stack, std::max({ 0, s.peak[MARKERS].rel, s.peak[MARKERS].abs })));
+		}
+
+		auto set = [bounds](bound b, uint32_t value) { bounds[static_cast<size_t>(b)] = value; };
+		set(bound::call_depth, to_bound(depth));
+		set(bound::thread_depth, to_bound(threads));
+		set(bound::eval_stack, to_bound(eval));
+		set(bound::runtime_stack, to_bound(stack));
+		set(bound::choices, to_bound(counters[CHOICES]));
+		set(bound::tags, to_bound(counters[TAGS]));
+		set(bound::output, to_bound(counters[OUTPUT]));
+		set(bound::global_variables, static_cast<uint32_t>(globals.size()));
+	}
+
+	const bounds_analysis::summary& bounds_analysis::analyze(uint32_t index)
+	{
+		// Calls into a routine still being analyzed are recursion
+		static const summary recursion = [] {
+			summary s;
+			s.done = s.exits = true;
+			s.depth = s.threads = s.stack = s.eval_peak = s.eval_exit = Unbounded;
+			for (int c = 0; c < NUM_COUNTERS; ++c)
+				s.peak[c] = s.exit[c] = { Unbounded, Unbounded };
+			return s;
+		}();
+
+		summary& s = _summaries[index];
+		if (s.done)
+			return s;
+		if (s.active)
+		{
+			_recursive.insert(index);
+			return recursion;
+		}
+		s.active = true;
+		s.eval_exit = -Unbounded;
+		for (int c = 0; c < NUM_COUNTERS; ++c)
+			s.peak[c] = s.exit[c] = { None, None };
+
+		routine r{ s };
+		state entry;
+		entry.eval = 0;
+		entry.updates = 0;
+		for (int c = 0; c < NUM_COUNTERS; ++c)
+			entry.counters[c] = { 0, None };
+		flow(r, index, false, entry);
+
+		// Walk in code order, so forward flow settles in one pass
+		while (!r.work.empty())
+		{
+			uint32_t key = r.work.top();
+			r.work.pop();
+			state& queued = r.states[key];
+			if (!queued.queued)
+				continue;
+			queued.queued = false;
+			state st = queued;
+			uint32_t at = key / 2;
+			if (at < _visited.size())
+				_visited[at] = true;
+			step(r, at, key % 2 == 1, st);
+		}
+
+		s.stack = add(static_cast<int>(r.temps.size()), r.callee_stack);
+		s.active = false;
+		s.done = true;
+		return s;
+	}
+
+	void bounds_analysis::flow(routine& r, uint32_t index, bool eval_mode, const state& st)
+	{
+		uint32_t key = index * 2 + (eval_mode ? 1 : 0);
+		auto [iter, inserted] = r.states.try_emplace(key, st);
+		if (inserted)
+		{
+			iter->second.updates = 0;
+			iter->second.queued = true;
+			r.work.push(key);
+			return;
+		}
+
+		// Join, widening values which keep growing
+		state& target = iter->second;
+		bool widen = target.updates >= WidenAfter;
+		bool changed = false;
+		auto join = [&](int& into, int value) {
+			if (value > into)
+			{
+				into = widen ? Unbounded : value;
+				changed = true;
+			}
+		};
+		join(target.eval, st.eval);
+		for (int c = 0; c < NUM_COUNTERS; ++c)
+		{
+			join(target.counters[c].rel, st.counters[c].rel);
+			join(target.counters[c].abs, st.counters[c].abs);
+		}
+		if (changed)
+		{
+			++target.updates;
+			if (!target.queued)
+				r.work.push(key);
+			target.queued = true;
+		}
+	}
+
+	void bounds_analysis::leave(routine& r, const state& st)
+	{
+		summary& s = r.result;
+		s.exits = true;
+		s.eval_exit = std::max(s.eval_exit, st.eval);
+		for (int c = 0; c < NUM_COUNTERS; ++c)
+		{
+			s.exit[c].rel = std::max(s.exit[c].rel, st.counters[c].rel);
+			s.exit[c].abs = std::max(s.exit[c].abs, st.counters[c].abs);
+		}
+	}
+
+	namespace
+	{
+		template<typename S>
+		void increment(S& counter, int amount)
+		{
+			if (counter.rel != None)
+				counter.rel = add(counter.rel, amount);
+			if (counter.abs != None)
+				counter.abs = add(counter.abs, amount);
+		}
+
+		template<typename S>
+		void reset(S& counter, int value)
+		{
+			counter.rel = None;
+			counter.abs = value;
+		}
+	}
+
+	void bounds_analysis::call(routine& r, bool eval_mode, const state& st,
+		uint32_t target_offset, call_kind kind, uint32_t next)
+	{
+		uint32_t target = index_of(target_offset);
+		if (target >= _offsets.size())
+			return;
+
+		state before = st;
+		if (kind == call_kind::function)
+			increment(before.counters[OUTPUT], 1); // function start marker
+		else if (kind == call_kind::thread)
+			increment(before.counters[MARKERS], 2); // thread start and end
+
+		const summary& callee = analyze(target);
+		summary& s = r.result;
+		s.depth = std::max(s.depth, add(callee.depth, 1));
+		s.threads = std::max(s.threads, kind == call_kind::thread ? add(callee.threads, 1) : callee.threads);
+		r.callee_stack = std::max(r.callee_stack, add(callee.stack, 1));
+		s.eval_peak = std::max(s.eval_peak, add(before.eval, callee.eval_peak));
+
+		// Counts continue from the caller, unless the callee started a new turn or line
+		state after = before;
+		after.eval = add(before.eval, callee.eval_exit);
+		for (int c = 0; c < NUM_COUNTERS; ++c)
+		{
+			const counter& in = before.counters[c];
+			const counter& peak = callee.peak[c];
+			const counter& exit = callee.exit[c];
+			if (peak.rel != None)
+			{
+				if (in.rel != None)
+					s.peak[c].rel = std::max(s.peak[c].rel, add(in.rel, peak.rel));
+				if (in.abs != None)
+					s.peak[c].abs = std::max(s.peak[c].abs, add(in.abs, peak.rel));
+			}
+			s.peak[c].abs = std::max(s.peak[c].abs, peak.abs);
+
+			counter& out = after.counters[c];
+			out.rel = in.rel != None && exit.rel != None ? add(in.rel, exit.rel) : None;
+			out.abs = in.abs != None && exit.rel != None ? add(in.abs, exit.rel) : None;
+			out.abs = std::max(out.abs, exit.abs);
+		}
+
+		if (!callee.exits)
+			return;
+		if (kind == call_kind::function)
+			increment(after.counters[OUTPUT], 1); // function end marker
+		flow(r, next, eval_mode, after);
+	}
+
+	void bounds_analysis::step(routine& r, uint32_t index, bool eval_mode, const state& st)
+	{
+		summary& s = r.result;
+		s.eval_peak = std::max(s.eval_peak, st.eval);
+		for (int c = 0; c < NUM_COUNTERS; ++c)
+		{
+			s.peak[c].rel = std::max(s.peak[c].rel, st.counters[c].rel);
+			s.peak[c].abs = std::max(s.peak[c].abs, st.counters[c].abs);
+		}
+
+		// Ran off the end of the code
+		if (index >= _offsets.size())
+		{
+			leave(r, st);
+			return;
+		}
+
+		// Decode
+		uint32_t offset = _offsets[index];
+		uint32_t end = index + 1 < _offsets.size() ? _offsets[index + 1] : static_cast<uint32_t>(_code.size());
+		Command cmd = static_cast<Command>(_code[offset]);
+		CommandFlag flag = static_cast<CommandFlag>(_code[offset + 1]);
+		uint32_t payload = 0;
+		if (end - offset >= 2 + sizeof(uint32_t))
+			std::memcpy(&payload, &_code[offset + 2], sizeof(uint32_t));
+
+		state next = st;
+		bool next_mode = eval_mode;
+		bool falls = true;
+		auto push = [&next](int count) { next.eval = add(next.eval, count); };
+		auto print = [&next]() { increment(next.counters[OUTPUT], 1); };
+
+		if (cmd >= Command::OP_BEGIN && cmd < Command::OP_END)
+		{
+			if (cmd <= Command::TERNARY_OPERATORS_END)
+				push(-2);
+			else if (cmd <= Command::BINARY_OPERATORS_END)
+				push(-1);
+			else if (cmd == Command::CHOICE_COUNT)
+				push(1);
+		}
+		else switch (cmd)
+		{
+		case Command::STR:
+		case Command::BOOL:
+		case Command::LIST:
+		case Command::GLUE:
+			if (eval_mode)
+				push(1);
+			else
+				print();
+			break;
+		case Command::NEWLINE:
+			if (eval_mode)
+				push(1);
+			else
+			{
+				reset(next.counters[OUTPUT], 0);
+				print();
+			}
+			break;
+		case Command::INT:
+		case Command::FLOAT:
+		case Command::VALUE_POINTER:
+		case Command::DIVERT_VAL:
+		case Command::VOID:
+			if (eval_mode)
+				push(1);
+			break;
+
+		case Command::DIVERT:
+		{
+			bool conditional = flag & CommandFlag::DIVERT_HAS_CONDITION;
+			if (conditional)
+				push(-1);
+			if (payload >= _code.size())
+			{
+				// Falling out of the story is a done, or a return with a null value
+				state done = next;
+				done.eval = add(done.eval, 1);
+				leave(r, done);
+			}
+			else
+				flow(r, index_of(payload), next_mode, next);
+			falls = conditional;
+		}
+		break;
+		case Command::DIVERT_TO_VARIABLE:
+		{
+			bool conditional = flag & CommandFlag::DIVERT_HAS_CONDITION;
+			if (conditional)
+				push(-1);
+			for (uint32_t target : _divert_targets)
+				flow(r, index_of(target), next_mode, next);
+			falls = conditional;
+		}
+		break;
+
+		case Command::DONE:
+			// ends a thread, or the turn. The next turn starts at a choice target
+			leave(r, next);
+			falls = false;
+			break;
+		case Command::END:
+			falls = false;
+			break;
+
+		case Command::TUNNEL:
+		case Command::FUNCTION:
+		{
+			call_kind kind = cmd == Command::TUNNEL ? call_kind::tunnel : call_kind::function;
+			if (flag & CommandFlag::FUNCTION_TO_VARIABLE)
+			{
+				for (uint32_t target : _divert_targets)
+					call(r, eval_mode, next, target, kind, index + 1);
+			}
+			else
+				call(r, eval_mode, next, payload, kind, index + 1);
+			falls = false;
+		}
+		break;
+		case Command::THREAD:
+			// The thread runs the divert after it and returns past it
+			if (index + 1 < _offsets.size() && static_cast<Command>(_code[_offsets[index + 1]]) == Command::DIVERT)
+			{
+				uint32_t target;
+				std::memcpy(&target, &_code[_offsets[index + 1] + 2], sizeof(uint32_t));
+				call(r, eval_mode, next, target, call_kind::thread, index + 2);
+				falls = false;
+			}
+			break;
+		case Command::TUNNEL_RETURN:
+		case Command::FUNCTION_RETURN:
+			leave(r, next);
+			falls = false;
+			break;
+
+		case Command::DEFINE_TEMP:
+			push(-1);
+			r.temps.insert(payload);
+			break;
+		case Command::SET_VARIABLE:
+		case Command::POP:
+		case Command::SEQUENCE:
+			push(-1);
+			break;
+		case Command::CALL_EXTERNAL:
+			push(1 - static_cast<int>(flag));
+			break;
+		case Command::START_EVAL:
+			next_mode = true;
+			break;
+		case Command::END_EVAL:
+			next_mode = false;
+			break;
+		case Command::OUTPUT:
+			push(-1);
+			print();
+			break;
+		case Command::DUPLICATE:
+		case Command::PUSH_VARIABLE_VALUE:
+		case Command::VISIT:
+		case Command::READ_COUNT:
+			push(1);
+			break;
+		case Command::START_STR:
+			next_mode = false;
+			print();
+			break;
+		case Command::END_STR:
+			next_mode = true;
+			push(1);
+			break;
+
+		case Command::CHOICE:
+		{
+			int pops = 0;
+			if (flag & CommandFlag::CHOICE_HAS_CONDITION)
+				++pops;
+			if (flag & CommandFlag::CHOICE_HAS_START_CONTENT)
+				++pops;
+			if (flag & CommandFlag::CHOICE_HAS_CHOICE_ONLY_CONTENT)
+				++pops;
+			push(-pops);
+			increment(next.counters[CHOICES], 1);
+
+			// Picking it starts a new turn at the target
+			state chosen = next;
+			reset(chosen.counters[CHOICES], 0);
+			reset(chosen.counters[TAGS], 0);
+			reset(chosen.counters[MARKERS], 0);
+			flow(r, index_of(payload), false, chosen);
+		}
+		break;
+		case Command::TAG:
+			increment(next.counters[TAGS], 1);
+			break;
+
+		default:
+			break;
+		}
+
+		if (falls)
+			flow(r, index + 1, next_mode, next);
+	}
+}
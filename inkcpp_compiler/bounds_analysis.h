@@ -0,0 +1,100 @@
+#pragma once
+
+#include "system.h"
+#include "header.h"
+
+#include <vector>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+namespace ink::compiler::internal
+{
+	// Computes upper bounds of the runtime buffers from compiled story code.
+	//  Every tunnel, function and thread target is summarized once, and a call
+	//  graph over the summaries gives the bounds of the whole story. Recursion
+	//  and loops which grow a buffer make the affected bounds unbounded.
+	class bounds_analysis
+	{
+	public:
+		// code: instructions of the story, offsets: start of every instruction in code
+		bounds_analysis(const std::vector<byte_t>& code, const std::vector<uint32_t>& offsets);
+
+		// Adds a container which may be entered on an empty callstack,
+		//  like the root, knots and the global declarations
+		void add_root(uint32_t offset);
+
+		// Names a container offset for reports
+		void set_name(uint32_t offset, const std::string& name);
+
+		// Runs the analysis, fills the bounds depending on control flow
+		void run(uint32_t bounds[ink::internal::header::NumBounds]);
+
+		// Whether some tunnel, function or thread calls itself
+		bool recursive() const { return !_recursive.empty(); }
+
+		// Names of the recursive tunnels, functions and threads
+		std::vector<std::string> recursive_names() const;
+
+	private:
+		enum counter_kind { CHOICES, TAGS, MARKERS, OUTPUT, NUM_COUNTERS };
+
+		// A per-turn or per-line count. rel counts from the routine entry,
+		//  abs from a reset inside the routine. None if no path gets there
+		struct counter
+		{
+			int rel;
+			int abs;
+		};
+
+		// State of the routine before an instruction
+		struct state
+		{
+			int eval;
+			counter counters[NUM_COUNTERS];
+			int updates;
+			bool queued;
+		};
+
+		// Effect of a tunnel, function or thread relative to its entry
+		struct summary
+		{
+			bool active = false;
+			bool done = false;
+			bool exits = false;   // returns to its caller
+			int depth = 0;        // frames opened below it
+			int threads = 0;      // thread frames opened below it
+			int stack = 0;        // temporaries and frames on the runtime stack
+			int eval_peak = 0;
+			int eval_exit = 0;
+			counter peak[NUM_COUNTERS];
+			counter exit[NUM_COUNTERS];
+		};
+
+		struct routine;
+		enum class call_kind { tunnel, function, thread };
+
+		const summary& analyze(uint32_t index);
+		void step(routine& r, uint32_t index, bool eval_mode, const state& st);
+		void call(routine& r, bool eval_mode, const state& st, uint32_t target_offset, call_kind kind, uint32_t next);
+		void flow(routine& r, uint32_t index, bool eval_mode, const state& st);
+		void leave(routine& r, const state& st);
+
+		uint32_t index_of(uint32_t offset) const;
+		std::string name_of(uint32_t index) const;
+
+	private:
+		const std::vector<byte_t>& _code;
+		const std::vector<uint32_t>& _offsets;
+		std::vector<uint32_t> _roots;
+		std::map<uint32_t, std::string> _names;
+
+		// targets of divert values, where variable diverts may lead
+		std::vector<uint32_t> _divert_targets;
+
+		std::unordered_map<uint32_t, summary> _summaries;
+		std::vector<bool> _visited;
+		std::set<uint32_t> _recursive;
+	};
+}
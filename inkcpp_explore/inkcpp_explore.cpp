@@ -0,0 +1,367 @@
+// inkcpp_explore.cpp : Explores every reachable choice path of a story, in parallel.
+//
+
+#include <iostream>
+#include <fstream>
+#include <regex>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <string>
+#include <memory>
+#include <unordered_set>
+
+#include <story.h>
+#include <runner.h>
+#include <globals.h>
+#include <snapshot.h>
+#include <compiler.h>
+
+using namespace ink::runtime;
+
+namespace
+{
+	void usage()
+	{
+		using namespace std;
+		cout
+			<< "Usage: inkcpp_explore <options> <json or bin file>\n"
+			<< "\t-d <depth>:\tMaximum number of choices per path (default 20)\n"
+			<< "\t-j <threads>:\tNumber of worker threads (default all cores)\n"
+			<< "\t-v:\tList the choice paths leading to dead ends and errors\n"
+			<< endl;
+	}
+
+	// A runner waiting to continue, and the choices which led to it.
+	//  The last choice is taken when the task is processed
+	struct task
+	{
+		runner thread;
+		std::vector<int> path;
+	};
+
+	// Work-stealing queue: every worker pushes and pops at the back of its
+	//  own deque, idle workers steal from the front of the others.
+	class work_queue
+	{
+	public:
+		work_queue(size_t workers)
+			: _queues(workers), _pending(0)
+		{ }
+
+		void push(size_t worker, task&& t)
+		{
+			_pending.fetch_add(1, std::memory_order_relaxed);
+			std::lock_guard<std::mutex> lock(_queues[worker].lock);
+			_queues[worker].tasks.push_back(std::move(t));
+		}
+
+		bool pop(size_t worker, task& out)
+		{
+			for (size_t i = 0; i < _queues.size(); ++i)
+			{
+				queue& q = _queues[(worker + i) % _queues.size()];
+				std::lock_guard<std::mutex> lock(q.lock);
+				if (q.tasks.empty())
+					continue;
+				if (i == 0)
+				{
+					out = std::move(q.tasks.back());
+					q.tasks.pop_back();
+				}
+				else
+				{
+					out = std::move(q.tasks.front());
+					q.tasks.pop_front();
+				}
+				return true;
+			}
+			return false;
+		}
+
+		// Marks a popped task as done. Children must be pushed before
+		void done() { _pending.fetch_sub(1, std::memory_order_acq_rel); }
+
+		// True once all tasks are done
+		bool finished() const { return _pending.load(std::memory_order_acquire) == 0; }
+
+	private:
+		struct queue
+		{
+			std::mutex lock;
+			std::deque<task> tasks;
+		};
+		std::vector<queue> _queues;
+		std::atomic<size_t> _pending;
+	};
+
+	// Set of state hashes, split into shards to keep lock contention low
+	class state_set
+	{
+	public:
+		// Returns false if the hash was already in the set
+		bool insert(uint64_t hash)
+		{
+			shard& s = _shards[hash % NumShards];
+			std::lock_guard<std::mutex> lock(s.lock);
+			return s.hashes.insert(hash).second;
+		}
+
+	private:
+		static constexpr size_t NumShards = 64;
+		struct shard
+		{
+			std::mutex lock;
+			std::unordered_set<uint64_t> hashes;
+		};
+		shard _shards[NumShards];
+	};
+
+	struct explorer
+	{
+		explorer(size_t workers, size_t max_depth, uint32_t num_containers)
+			: queue(workers), max_depth(max_depth)
+			, visited(workers, std::vector<bool>(num_containers, false))
+		{ }
+
+		work_queue queue;
+		state_set seen;
+		size_t max_depth;
+
+		std::atomic<size_t> states{0};
+		std::atomic<size_t> duplicates{0};
+		std::atomic<size_t> dead_ends{0};
+		std::atomic<size_t> cut_off{0};
+		std::atomic<size_t> errors{0};
+
+		// containers visited, per worker
+		std::vector<std::vector<bool>> visited;
+
+		std::mutex report_lock;
+		std::vector<std::string> reports;
+
+		void report(const char* what, const std::vector<int>& path, const char* message = nullptr)
+		{
+			std::string line = what;
+			line += ":";
+			for (int c : path)
+				line += " " + std::to_string(c + 1);
+			if (message)
+				line += std::string(" (") + message + ")";
+			std::lock_guard<std::mutex> lock(report_lock);
+			reports.push_back(line);
+		}
+
+		// Visit counts only grow along a path, so marking the containers
+		//  visited where a path stops covers the whole path.
+		void cover(size_t worker, runner& thread)
+		{
+			globals store = thread->get_globals();
+			std::vector<bool>& out = visited[worker];
+			for (uint32_t i = 0; i < out.size(); ++i)
+				if (!out[i] && store->visits(i) > 0)
+					out[i] = true;
+		}
+
+		void process(size_t worker, task& t)
+		{
+			// without exceptions a failed call only sets the result of the runner
+			bool failed = false;
+			std::string error;
+			try
+			{
+				// the choice leading here is taken by the worker running the task
+				if (!t.path.empty())
+					t.thread->choose(t.path.back());
+				while (t.thread->last_result() != run_result::error && t.thread->can_continue())
+					t.thread->getline();
+				if (t.thread->last_result() == run_result::error)
+				{
+					failed = true;
+					if (t.thread->last_error())
+						error = t.thread->last_error();
+				}
+			}
+			catch (const std::exception& e)
+			{
+				failed = true;
+				error = e.what();
+			}
+			if (failed)
+			{
+				errors.fetch_add(1, std::memory_order_relaxed);
+				report("error", t.path, error.empty() ? nullptr : error.c_str());
+				cover(worker, t.thread);
+				return;
+			}
+			states.fetch_add(1, std::memory_order_relaxed);
+
+			size_t num_choices = t.thread->num_choices();
+			if (num_choices == 0)
+			{
+				dead_ends.fetch_add(1, std::memory_order_relaxed);
+				report("dead end", t.path);
+				cover(worker, t.thread);
+				return;
+			}
+			if (t.path.size() >= max_depth)
+			{
+				cut_off.fetch_add(1, std::memory_order_relaxed);
+				cover(worker, t.thread);
+				return;
+			}
+
+			// a state seen before has the same visits and the same future
+			std::unique_ptr<snapshot> snap{t.thread->create_snapshot()};
+			if (!seen.insert(snap->state_hash()))
+			{
+				duplicates.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			// fork for all choices but the last, which continues this runner
+			for (size_t i = 0; i < num_choices; ++i)
+			{
+				task next{i + 1 < num_choices ? t.thread->fork() : t.thread, t.path};
+				next.path.push_back(static_cast<int>(i));
+				queue.push(worker, std::move(next));
+			}
+		}
+
+		void work(size_t worker)
+		{
+			task t;
+			while (true)
+			{
+				if (queue.pop(worker, t))
+				{
+					process(worker, t);
+					t = task{};
+					queue.done();
+				}
+				else if (queue.finished())
+					break;
+				else
+					std::this_thread::yield();
+			}
+		}
+	};
+}
+
+int main(int argc, const char** argv)
+{
+	// Usage
+	if (argc == 1)
+	{
+		usage();
+		return 1;
+	}
+
+	// Parse options
+	size_t maxDepth = 20;
+	size_t numThreads = std::thread::hardware_concurrency();
+	bool verbose = false;
+	for (int i = 1; i < argc - 1; i++)
+	{
+		std::string option = argv[i];
+		if (option == "-d" && i + 1 < argc - 1)
+		{
+			maxDepth = std::stoul(argv[i + 1]);
+			i += 1;
+		}
+		else if (option == "-j" && i + 1 < argc - 1)
+		{
+			numThreads = std::stoul(argv[i + 1]);
+			i += 1;
+		}
+		else if (option == "-v")
+			verbose = true;
+		else
+		{
+			std::cerr << "Unrecognized option: '" << option << "'\n";
+		}
+	}
+	if (numThreads == 0)
+		numThreads = 1;
+
+	// Compile JSON files first
+	std::string inputFilename = argv[argc - 1];
+	std::string binFilename = inputFilename;
+	size_t ext = inputFilename.rfind(".json");
+	if (ext != std::string::npos && ext == inputFilename.length() - 5)
+	{
+		binFilename = std::regex_replace(inputFilename, std::regex("\\.[^\\.]+$"), ".bin");
+		try
+		{
+			ink::compiler::compilation_results results;
+			std::ofstream fout(binFilename, std::ios::binary | std::ios::out);
+			ink::compiler::run(inputFilename.c_str(), fout, &results);
+			fout.close();
+
+			for (auto& err : results.errors)
+				std::cerr << "ERROR: " << err << '\n';
+			if (results.errors.size() > 0)
+				return -1;
+		}
+		catch (std::exception& e)
+		{
+			std::cerr << "Unhandled InkBin compiler exception: " << e.what() << std::endl;
+			return 1;
+		}
+	}
+
+	try
+	{
+		std::unique_ptr<story> myInk{story::from_file(binFilename.c_str())};
+		explorer ex(numThreads, maxDepth, myInk->num_containers());
+
+		auto start = std::chrono::steady_clock::now();
+		ex.queue.push(0, task{myInk->new_runner(), {}});
+
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i < numThreads; ++i)
+			workers.emplace_back(&explorer::work, &ex, i);
+		for (std::thread& w : workers)
+			w.join();
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// Merge coverage of all workers
+		size_t covered = 0;
+		for (uint32_t i = 0; i < myInk->num_containers(); ++i)
+		{
+			for (const std::vector<bool>& v : ex.visited)
+			{
+				if (v[i])
+				{
+					++covered;
+					break;
+				}
+			}
+		}
+
+		if (verbose)
+		{
+			for (const std::string& line : ex.reports)
+				std::cout << line << '\n';
+		}
+
+		std::cout
+			<< "states:     " << ex.states << " (" << ex.duplicates << " duplicates)\n"
+			<< "coverage:   " << covered << " / " << myInk->num_containers() << " containers\n"
+			<< "dead ends:  " << ex.dead_ends << '\n'
+			<< "depth cut:  " << ex.cut_off << '\n'
+			<< "errors:     " << ex.errors << '\n'
+			<< "throughput: " << static_cast<size_t>(ex.states / (seconds > 0 ? seconds : 1)) << " states/s on "
+			<< numThreads << " threads" << std::endl;
+
+		return ex.errors > 0 ? 1 : 0;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Unhandled ink runtime exception: " << e.what() << std::endl;
+		return 1;
+	}
+}
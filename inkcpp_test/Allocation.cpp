@@ -0,0 +1,172 @@
+#include "catch.hpp"
+#include "../inkcpp_cl/test.h"
+#include "../inkcpp/story_impl.h"
+
+#include <story.h>
+#include <runner.h>
+#include <choice.h>
+#include <globals.h>
+#include <allocator.h>
+#include <compiler.h>
+
+#include <memory>
+#include <cstdlib>
+
+using namespace ink::runtime;
+
+namespace
+{
+	// plays one round of the loop
+	void play_round(runner& thread)
+	{
+		thread->getall();
+		thread->choose(0);
+	}
+}
+
+SCENARIO("a story in steady state does not allocate", "[allocation]")
+{
+	GIVEN("a looping story")
+	{
+		inklecate("ink/AllocationStory.ink", "AllocationStory.tmp");
+		ink::compiler::run("AllocationStory.tmp", "AllocationStory.bin");
+		std::unique_ptr<story> ink{story::from_file("AllocationStory.bin")};
+		runner thread = ink->new_runner();
+
+		WHEN("it has been played for a while")
+		{
+			for (int i = 0; i < 5; ++i)
+				play_round(thread);
+
+			THEN("runtime memory is counted by category")
+			{
+				REQUIRE(get_allocation_stats(alloc_category::story).bytes > 0);
+				REQUIRE(get_allocation_stats(alloc_category::strings).allocations > 0);
+				REQUIRE(get_allocation_stats(alloc_category::registry).bytes > 0);
+			}
+			THEN("literal choice text points into the story")
+			{
+				thread->getall();
+				const char* text = thread->get_choice(1)->text();
+				const internal::story_impl& impl = *static_cast<internal::story_impl*>(ink.get());
+				REQUIRE(text == std::string("Stop"));
+				REQUIRE(reinterpret_cast<const unsigned char*>(text) >= impl.data());
+				REQUIRE(reinterpret_cast<const unsigned char*>(text) < impl.end());
+				REQUIRE(thread->get_choice(0)->text() == std::string("Again 6"));
+			}
+			THEN("further rounds do not touch the heap")
+			{
+				reset_allocation_stats();
+				{
+					heap_guard guard;
+					for (int i = 0; i < 50; ++i)
+						REQUIRE_NOTHROW(play_round(thread));
+				}
+				REQUIRE(get_allocation_stats().allocations == 0);
+				REQUIRE(thread->getline() == "Round 56 of Bob.\n");
+			}
+		}
+#ifdef INK_ENABLE_EXCEPTIONS
+		WHEN("a heap guard is active")
+		{
+			THEN("allocations throw")
+			{
+				heap_guard guard;
+				REQUIRE_THROWS_AS(ink->new_runner(), ink::ink_exception);
+			}
+		}
+#endif
+	}
+}
+
+SCENARIO("a session lives in an arena", "[allocation]")
+{
+	GIVEN("a story and an arena")
+	{
+		inklecate("ink/AllocationStory.ink", "AllocationStory.tmp");
+		ink::compiler::run("AllocationStory.tmp", "AllocationStory.bin");
+		std::unique_ptr<story> ink{story::from_file("AllocationStory.bin")};
+		arena_allocator arena(4096);
+
+		WHEN("a runner is created with the arena")
+		{
+			runner thread = ink->new_runner(nullptr, &arena);
+			size_t created = arena.used();
+			for (int i = 0; i < 5; ++i)
+				play_round(thread);
+
+			THEN("the runner and its globals take their memory from it")
+			{
+				REQUIRE(thread->get_allocator() == &arena);
+				REQUIRE(created > 0);
+				REQUIRE(arena.used() > created);
+				REQUIRE(arena.reserved() >= arena.used());
+			}
+			THEN("forks use the arena as well")
+			{
+				runner child = thread->fork();
+				REQUIRE(child->get_allocator() == &arena);
+				REQUIRE(child->getline() == "Round 6 of Bob.\n");
+			}
+			THEN("the arena can be reused after the session ends")
+			{
+				thread = nullptr;
+				arena.reset();
+				REQUIRE(arena.used() == 0);
+				runner next = ink->new_runner(nullptr, &arena);
+				REQUIRE(next->getline() == "Round 1 of Bob.\n");
+			}
+		}
+	}
+}
+
+SCENARIO("runners are sized by a capacity profile", "[allocation]")
+{
+	GIVEN("a story")
+	{
+		inklecate("ink/AllocationStory.ink", "AllocationStory.tmp");
+		ink::compiler::run("AllocationStory.tmp", "AllocationStory.bin");
+		std::unique_ptr<story> ink{story::from_file("AllocationStory.bin")};
+
+		WHEN("a runner is created with small capacities")
+		{
+			capacities lean;
+			lean.runtime_stack = 2;
+			lean.reference_stack = 2;
+			lean.eval_stack = 2;
+			lean.container_depth = 2;
+			lean.thread_depth = 1;
+			lean.global_variables = 2;
+
+			// the configured limits, not the story's own bounds
+			capacities roomy;
+			roomy.runtime_stack = std::abs(ink::config::limitRuntimeStack);
+			roomy.reference_stack = std::abs(ink::config::limitReferenceStack);
+			roomy.eval_stack = std::abs(ink::config::limitEvalStackDepth);
+			roomy.container_depth = std::abs(ink::config::limitContainerDepth);
+			roomy.thread_depth = std::abs(ink::config::limitThreadDepth);
+			roomy.global_variables = std::abs(ink::config::limitGlobalVariables);
+
+			arena_allocator lean_arena, roomy_arena;
+			runner small = ink->new_runner(nullptr, &lean_arena, &lean);
+			runner normal = ink->new_runner(nullptr, &roomy_arena, &roomy);
+
+			THEN("it uses less memory")
+			{
+				REQUIRE(lean_arena.used() < roomy_arena.used());
+			}
+			THEN("its buffers grow as the story needs")
+			{
+				for (int i = 0; i < 3; ++i)
+					play_round(small);
+				REQUIRE(small->getline() == "Round 4 of Bob.\n");
+			}
+			THEN("forks keep the capacities")
+			{
+				size_t before = lean_arena.used();
+				runner child = small->fork();
+				REQUIRE(lean_arena.used() - before < roomy_arena.used());
+			}
+		}
+	}
+}
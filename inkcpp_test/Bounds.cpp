@@ -0,0 +1,88 @@
+#include "catch.hpp"
+#include "../inkcpp_cl/test.h"
+#include "../inkcpp/runner_impl.h"
+#include "../inkcpp/globals_impl.h"
+
+#include <story.h>
+#include <runner.h>
+#include <globals.h>
+#include <compiler.h>
+#include <config.h>
+
+#include <memory>
+#include <cstdlib>
+
+using namespace ink::runtime;
+
+SCENARIO("the compiler bounds the buffers of a story", "[bounds]")
+{
+	GIVEN("a story with a tunnel, a function, choices and a tag")
+	{
+		inklecate("ink/BoundsStory.ink", "BoundsStory.tmp");
+		ink::compiler::compilation_results results;
+		ink::compiler::run("BoundsStory.tmp", "BoundsStory.bin", &results);
+		std::unique_ptr<story> ink{story::from_file("BoundsStory.bin")};
+
+		THEN("it is bounded")
+		{
+			capacities bounds;
+			REQUIRE(ink->static_bounds(bounds));
+			REQUIRE(results.warnings.empty());
+			REQUIRE(bounds.choices == 3u);
+			REQUIRE(bounds.tags == 1u);
+			REQUIRE(bounds.thread_depth == 0u);
+			REQUIRE(bounds.global_variables == 1u);
+			REQUIRE(bounds.runtime_stack >= 2u);
+			REQUIRE(bounds.eval_stack >= 2u);
+		}
+		WHEN("a runner is created without capacities")
+		{
+			runner thread = ink->new_runner();
+			capacities bounds;
+			ink->static_bounds(bounds);
+
+			THEN("dynamic buffers are sized by the bounds")
+			{
+				const capacities& caps = thread.cast<internal::runner_impl>()->get_capacities();
+				if (ink::config::limitEvalStackDepth < 0)
+					REQUIRE(caps.eval_stack == bounds.eval_stack);
+				if (ink::config::limitGlobalVariables < 0)
+					REQUIRE(caps.global_variables == bounds.global_variables);
+				if (ink::config::maxChoices > 0)
+					REQUIRE(caps.choices == static_cast<size_t>(ink::config::maxChoices));
+			}
+			THEN("the story plays")
+			{
+				REQUIRE(thread->getline() == "Hello.\n");
+				REQUIRE(thread->getline() == "You have 2 coins.\n");
+				REQUIRE(thread->num_choices() == 3u);
+			}
+		}
+	}
+	GIVEN("a story with a recursive function")
+	{
+		inklecate("ink/RecursionStory.ink", "RecursionStory.tmp");
+		ink::compiler::compilation_results results;
+		ink::compiler::run("RecursionStory.tmp", "RecursionStory.bin", &results);
+		std::unique_ptr<story> ink{story::from_file("RecursionStory.bin")};
+
+		THEN("the compiler reports the recursion")
+		{
+			REQUIRE(results.warnings.size() == 1u);
+			REQUIRE(results.warnings[0].find("'fact'") != std::string::npos);
+		}
+		THEN("it is unbounded")
+		{
+			capacities bounds;
+			REQUIRE_FALSE(ink->static_bounds(bounds));
+			REQUIRE(bounds.runtime_stack == 0u);
+			REQUIRE(bounds.eval_stack == 0u);
+		}
+		THEN("runners fall back to the configured limits and play")
+		{
+			runner thread = ink->new_runner();
+			REQUIRE(thread.cast<internal::runner_impl>()->get_capacities().runtime_stack == static_cast<size_t>(std::abs(ink::config::limitRuntimeStack)));
+			REQUIRE(thread->getline() == "Five factorial is 120.\n");
+		}
+	}
+}
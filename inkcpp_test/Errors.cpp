@@ -0,0 +1,158 @@
+#include "catch.hpp"
+#include "../inkcpp_cl/test.h"
+
+#include <story.h>
+#include <runner.h>
+#include <globals.h>
+#include <choice.h>
+#include <compiler.h>
+
+#include "../inkcpp/array.h"
+#include "../inkcpp/collections/restorable.h"
+#include "../inkcpp/error.h"
+
+#include <memory>
+#include <string>
+
+using namespace ink::runtime;
+using ink::runtime::internal::managed_array;
+using ink::runtime::internal::restorable;
+
+SCENARIO("a failing call resets the runner and reports the error", "[errors]")
+{
+	GIVEN("a runner at a choice")
+	{
+		inklecate("ink/BoundsStory.ink", "BoundsStory.tmp");
+		ink::compiler::run("BoundsStory.tmp", "BoundsStory.bin");
+		std::unique_ptr<story> ink{story::from_file("BoundsStory.bin")};
+		runner thread = ink->new_runner();
+		REQUIRE(thread->getline() == "Hello.\n");
+		REQUIRE(thread->getline() == "You have 2 coins.\n");
+		REQUIRE(thread->last_result() == run_result::ok);
+		REQUIRE(thread->last_error() == nullptr);
+
+		WHEN("an invalid choice is made")
+		{
+#ifdef INK_ENABLE_EXCEPTIONS
+			REQUIRE_THROWS_AS(thread->choose(5), ink::ink_exception);
+#else
+			thread->choose(5);
+			REQUIRE(thread->last_error() == std::string("Choice index out of range"));
+#endif
+			THEN("the error is reported and the runner is cleared")
+			{
+				REQUIRE(thread->last_result() == run_result::error);
+				REQUIRE_FALSE(thread->can_continue());
+				REQUIRE(thread->num_choices() == 0);
+			}
+			THEN("the runner plays again after a reset")
+			{
+				thread->reset();
+				REQUIRE(thread->getline() == "Hello.\n");
+				REQUIRE(thread->last_result() == run_result::ok);
+			}
+		}
+	}
+}
+
+#ifndef INK_ENABLE_EXCEPTIONS
+using ink::runtime::internal::error_scope;
+#endif
+
+SCENARIO("a failed check returns without touching live data", "[errors]")
+{
+	GIVEN("a full fixed size array")
+	{
+		managed_array<int, false, 4> array;
+		for (int i = 0; i < 4; ++i)
+			array.push() = i;
+
+		WHEN("one more element is pushed")
+		{
+#ifdef INK_ENABLE_EXCEPTIONS
+			REQUIRE_THROWS_AS(array.push(), ink::ink_exception);
+#else
+			error_scope scope;
+			int& extra = array.push();
+			extra = 42;
+			REQUIRE(scope.failed());
+			REQUIRE(scope.message() == std::string("Stack Overflow!"));
+			REQUIRE((&extra < array.begin() || &extra >= array.begin() + array.capacity()));
+#endif
+			THEN("the stored elements are unchanged")
+			{
+				REQUIRE(array.size() == 4);
+				for (int i = 0; i < 4; ++i)
+					REQUIRE(array[i] == i);
+			}
+		}
+	}
+	GIVEN("a full restorable collection which can not grow")
+	{
+		int buffer[4];
+		restorable<int> collection(buffer, 4);
+		for (int i = 0; i < 4; ++i)
+			collection.push(i);
+
+		WHEN("one more element is pushed")
+		{
+#ifdef INK_ENABLE_EXCEPTIONS
+			REQUIRE_THROWS_AS(collection.push(42), ink::ink_exception);
+#else
+			error_scope scope;
+			int& extra = collection.push(42);
+			REQUIRE(scope.failed());
+			REQUIRE((&extra < buffer || &extra >= buffer + 4));
+#endif
+			THEN("the stored elements are unchanged")
+			{
+				for (int i = 0; i < 4; ++i)
+					REQUIRE(buffer[i] == i);
+			}
+		}
+	}
+	GIVEN("a runner with a tag and choices")
+	{
+		inklecate("ink/BoundsStory.ink", "BoundsStory.tmp");
+		ink::compiler::run("BoundsStory.tmp", "BoundsStory.bin");
+		std::unique_ptr<story> ink{story::from_file("BoundsStory.bin")};
+		runner thread = ink->new_runner();
+		REQUIRE(thread->getline() == "Hello.\n");
+		REQUIRE(thread->num_tags() == 1);
+
+		WHEN("a tag past the end is requested")
+		{
+#ifdef INK_ENABLE_EXCEPTIONS
+			REQUIRE_THROWS_AS(thread->get_tag(1), ink::ink_exception);
+#else
+			error_scope scope;
+			REQUIRE(thread->get_tag(1) == nullptr);
+			REQUIRE(scope.failed());
+#endif
+			THEN("the runner goes on")
+			{
+				REQUIRE(thread->get_tag(0) == std::string("greeting"));
+				REQUIRE(thread->getline() == "You have 2 coins.\n");
+			}
+		}
+		WHEN("a choice past the end is requested")
+		{
+			REQUIRE(thread->getline() == "You have 2 coins.\n");
+			REQUIRE(thread->num_choices() == 3);
+#ifdef INK_ENABLE_EXCEPTIONS
+			REQUIRE_THROWS_AS(thread->get_choice(3), ink::ink_exception);
+#else
+			error_scope scope;
+			REQUIRE(thread->get_choice(3) == nullptr);
+			REQUIRE(scope.failed());
+#endif
+			THEN("the runner goes on")
+			{
+				REQUIRE(thread->get_choice(2)->text() == std::string("Leave"));
+				thread->choose(2);
+				REQUIRE(thread->getall() == "Bye.\n");
+				REQUIRE(thread->last_result() == run_result::ok);
+			}
+		}
+	}
+}
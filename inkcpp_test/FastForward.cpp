@@ -0,0 +1,121 @@
+#include "catch.hpp"
+#include "../inkcpp_cl/test.h"
+
+#include <story.h>
+#include <runner.h>
+#include <globals.h>
+#include <choice.h>
+#include <snapshot.h>
+#include <compiler.h>
+
+#include <memory>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+using namespace ink::runtime;
+
+SCENARIO("a fast-forwarding runner skips text but keeps its state", "[fast_forward]")
+{
+	GIVEN("a story and two runners, one fast-forwarding")
+	{
+		inklecate("ink/BoundsStory.ink", "BoundsStory.tmp");
+		ink::compiler::run("BoundsStory.tmp", "BoundsStory.bin");
+		std::unique_ptr<story> ink{story::from_file("BoundsStory.bin")};
+		runner reference = ink->new_runner();
+		runner thread = ink->new_runner();
+		thread->set_fast_forward(true);
+		REQUIRE(thread->is_fast_forward());
+
+		WHEN("both play to the first choices")
+		{
+			std::string text = reference->getall();
+			std::string skipped = thread->getall();
+
+			THEN("no text is returned")
+			{
+				REQUIRE(text == "Hello.\nYou have 2 coins.\n");
+				REQUIRE(skipped.empty());
+				REQUIRE(thread->num_tags() == reference->num_tags());
+			}
+			THEN("the choices are the same, with text built on request")
+			{
+				REQUIRE(thread->num_choices() == 3);
+				for (size_t i = 0; i < 3; ++i)
+				{
+					REQUIRE(std::string(thread->get_choice(i)->text()) == reference->get_choice(i)->text());
+					REQUIRE(thread->get_choice(i)->index() == reference->get_choice(i)->index());
+				}
+			}
+			THEN("the story continues the same after a choice")
+			{
+				reference->choose(1);
+				thread->choose(1);
+				thread->set_fast_forward(false);
+				REQUIRE(thread->getall() == "Bye.\n");
+				REQUIRE(reference->getall() == "Bye.\n");
+				REQUIRE_FALSE(thread->can_continue());
+			}
+		}
+	}
+}
+
+namespace
+{
+	story* story_from_json(const std::string& text)
+	{
+		std::stringstream json{text};
+		std::stringstream bin;
+		ink::compiler::run(json, bin);
+		std::string data = bin.str();
+		unsigned char* buffer = new unsigned char[data.size()];
+		std::copy(data.begin(), data.end(), buffer);
+		return story::from_binary(buffer, data.size());
+	}
+
+	// the lines getline returns until the story ends, or how many there are
+	std::vector<std::string> read_lines(runner& thread)
+	{
+		std::vector<std::string> lines;
+		while (thread->can_continue())
+			lines.push_back(thread->getline());
+		return lines;
+	}
+}
+
+SCENARIO("a fast-forwarding runner ends lines where getline does", "[fast_forward]")
+{
+	GIVEN("a choice leading to a leading newline, glue and trailing spaces")
+	{
+		std::unique_ptr<story> ink{story_from_json(
+			R"({"inkVersion":20,"root":[["^Start.","\n","ev","str","^Go","/str","/ev",{"*":".^.c-0","flg":4},)"
+			R"({"c-0":["\n","^Hello ","\n","<>","^there. ","\n","^Last.","\n","end",{"#f":5}]}],)"
+			R"("done",{"#f":1}],"listDefs":{}})")};
+		runner reference = ink->new_runner();
+		runner thread = ink->new_runner();
+		thread->set_fast_forward(true);
+		reference->getall();
+		thread->getall();
+
+		WHEN("both take the choice and read line by line")
+		{
+			reference->choose(0);
+			thread->choose(0);
+			std::vector<std::string> lines = read_lines(reference);
+			std::vector<std::string> skipped = read_lines(thread);
+
+			THEN("they need the same number of calls")
+			{
+				REQUIRE(lines == std::vector<std::string>{"Hello there.\n", "Last.\n"});
+				REQUIRE(skipped.size() == lines.size());
+			}
+			THEN("they end in the same state")
+			{
+				std::unique_ptr<snapshot> expected{reference->create_snapshot()};
+				std::unique_ptr<snapshot> actual{thread->create_snapshot()};
+				REQUIRE(actual->state_hash() == expected->state_hash());
+			}
+		}
+	}
+}
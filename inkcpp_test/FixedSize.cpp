@@ -0,0 +1,108 @@
+#include "catch.hpp"
+#include "../inkcpp_cl/test.cpp"
+
+#include <story.h>
+#include <runner.h>
+#include <globals.h>
+#include <allocator.h>
+#include <compiler.h>
+
+#include "../inkcpp/error.h"
+
+#include <memory>
+
+using namespace ink::runtime;
+
+// Built against the runtime with INK_FIXED_SIZE_LIMITS, see config.h
+static_assert(ink::config::limitGlobalVariables > 0 && ink::config::limitThreadDepth > 0
+	&& ink::config::limitEvalStackDepth > 0 && ink::config::limitContainerDepth > 0
+	&& ink::config::limitActiveTags > 0 && ink::config::limitRuntimeStack > 0
+	&& ink::config::limitReferenceStack > 0 && ink::config::maxChoices > 0
+	&& ink::config::maxListTypes > 0 && ink::config::maxFlags > 0 && ink::config::maxLists > 0,
+	"the fixed size tests need every limit to be fixed");
+
+SCENARIO("a story with fixed size limits does not allocate", "[allocation]")
+{
+	GIVEN("a looping story")
+	{
+		inklecate("ink/AllocationStory.ink", "AllocationStory.tmp");
+		ink::compiler::run("AllocationStory.tmp", "AllocationStory.bin");
+		std::unique_ptr<story> ink{story::from_file("AllocationStory.bin")};
+		runner thread = ink->new_runner();
+
+		WHEN("it has been played for a while")
+		{
+			for (int i = 0; i < 5; ++i)
+			{
+				thread->getall();
+				thread->choose(0);
+			}
+
+			THEN("further rounds do not touch the heap")
+			{
+				reset_allocation_stats();
+				{
+					heap_guard guard;
+					for (int i = 0; i < 50; ++i)
+					{
+						thread->getall();
+						thread->choose(0);
+					}
+				}
+				REQUIRE(get_allocation_stats().allocations == 0);
+				REQUIRE(thread->getline() == "Round 56 of Bob.\n");
+			}
+		}
+		WHEN("a capacity exceeds a fixed size of config.h")
+		{
+			capacities big;
+			big.choices = ink::config::maxChoices + 1;
+			capacities deep;
+			deep.thread_depth = ink::config::limitThreadDepth + 1;
+#ifdef INK_ENABLE_EXCEPTIONS
+			THEN("the runner can not be created")
+			{
+				REQUIRE_THROWS_AS(ink->new_runner(nullptr, nullptr, &big), ink::ink_exception);
+				REQUIRE_THROWS_AS(ink->new_runner(nullptr, nullptr, &deep), ink::ink_exception);
+			}
+#else
+			THEN("the error is reported and the runner keeps to the fixed size")
+			{
+				ink::runtime::internal::error_scope scope;
+				runner clamped = ink->new_runner(nullptr, nullptr, &deep);
+				REQUIRE(scope.failed());
+				REQUIRE(clamped->getline() == "Round 1 of Bob.\n");
+			}
+#endif
+		}
+	}
+}
+
+SCENARIO("a new store does not allocate on the first visits", "[allocation]")
+{
+	GIVEN("a story with more counted containers than one page of visit counts")
+	{
+		inklecate("ink/VisitStory.ink", "VisitStory.tmp");
+		ink::compiler::run("VisitStory.tmp", "VisitStory.bin");
+		std::unique_ptr<story> ink{story::from_file("VisitStory.bin")};
+		runner thread = ink->new_runner();
+
+		WHEN("it is played from the start")
+		{
+			reset_allocation_stats();
+			{
+				heap_guard guard;
+				for (int i = 0; i < 3; ++i)
+				{
+					thread->getall();
+					thread->choose(0);
+				}
+			}
+			THEN("visiting every container does not touch the heap")
+			{
+				REQUIRE(get_allocation_stats().allocations == 0);
+				REQUIRE(thread->getline() == "Round 4.\n");
+			}
+		}
+	}
+}
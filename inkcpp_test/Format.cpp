@@ -0,0 +1,134 @@
+#include "catch.hpp"
+
+#include "../inkcpp/string_utils.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+using ink::runtime::internal::toStr;
+
+namespace
+{
+	// what the runtime printed before: printf, with trailing zeros removed
+	std::string printf_float(float value)
+	{
+		char buffer[64];
+		int res = std::snprintf(buffer, sizeof(buffer), "%.7f", value);
+		char* itr = buffer + res - 1;
+		while(*itr == '0') { *itr-- = 0; }
+		if (*itr == '.') { *itr = 0; }
+		return buffer;
+	}
+
+	std::string format_float(float value)
+	{
+		char buffer[64];
+		REQUIRE(toStr(buffer, sizeof(buffer), value) == 0);
+		return buffer;
+	}
+
+	float from_bits(uint32_t bits)
+	{
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// counts values which format different from printf, remembers the first
+	template<typename T, typename F>
+	size_t count_mismatches(T value, F reference, std::string& first)
+	{
+		char buffer[64];
+		toStr(buffer, sizeof(buffer), value);
+		std::string expected = reference(value);
+		if (expected == buffer)
+			return 0;
+		if (first.empty())
+			first = expected + " != " + buffer;
+		return 1;
+	}
+}
+
+SCENARIO("numbers are formatted like printf", "[format]")
+{
+	GIVEN("integers")
+	{
+		auto print_int = [](int32_t value) {
+			char buffer[16];
+			std::snprintf(buffer, sizeof(buffer), "%d", value);
+			return std::string(buffer);
+		};
+		auto print_uint = [](uint32_t value) {
+			char buffer[16];
+			std::snprintf(buffer, sizeof(buffer), "%u", value);
+			return std::string(buffer);
+		};
+
+		THEN("small and boundary values match")
+		{
+			size_t mismatches = 0;
+			std::string first;
+			for (int32_t i = -1000000; i <= 1000000; ++i)
+				mismatches += count_mismatches(i, print_int, first);
+			int64_t power = 1;
+			for (int digits = 0; digits < 10; ++digits, power *= 10)
+			{
+				for (int64_t v : { power - 1, power, power + 1, -power + 1, -power, -power - 1 })
+					mismatches += count_mismatches(static_cast<int32_t>(v), print_int, first);
+			}
+			mismatches += count_mismatches(std::numeric_limits<int32_t>::min(), print_int, first);
+			mismatches += count_mismatches(std::numeric_limits<int32_t>::max(), print_int, first);
+			for (uint32_t u : { 0u, 9u, 10u, 4294967295u, 2147483648u, 1000000000u })
+				mismatches += count_mismatches(u, print_uint, first);
+			INFO(first);
+			REQUIRE(mismatches == 0);
+		}
+		THEN("too small buffers fail")
+		{
+			char buffer[4];
+			REQUIRE(toStr(buffer, sizeof(buffer), int32_t(-100)) != 0);
+			REQUIRE(toStr(buffer, sizeof(buffer), int32_t(-10)) == 0);
+			REQUIRE(std::string(buffer) == "-10");
+		}
+	}
+	GIVEN("floats")
+	{
+		THEN("typical story values match")
+		{
+			size_t mismatches = 0;
+			std::string first;
+			for (int32_t i = -200000; i <= 200000; ++i)
+			{
+				mismatches += count_mismatches(i / 100.f, printf_float, first);
+				mismatches += count_mismatches(i / 3.f, printf_float, first);
+			}
+			INFO(first);
+			REQUIRE(mismatches == 0);
+		}
+		THEN("a sweep over all bit patterns matches")
+		{
+			size_t mismatches = 0;
+			std::string first;
+			for (uint64_t bits = 0; bits <= 0xFFFFFFFFu; bits += 4099)
+				mismatches += count_mismatches(from_bits(static_cast<uint32_t>(bits)), printf_float, first);
+			INFO(first);
+			REQUIRE(mismatches == 0);
+		}
+		THEN("special values match")
+		{
+			REQUIRE(format_float(0.f) == "0");
+			REQUIRE(format_float(-0.f) == "-0");
+			REQUIRE(format_float(0.5f) == "0.5");
+			REQUIRE(format_float(-1.25f) == "-1.25");
+			REQUIRE(format_float(1e-8f) == "0");
+			REQUIRE(format_float(0.00390625f) == printf_float(0.00390625f));
+			REQUIRE(format_float(std::numeric_limits<float>::max()) == printf_float(std::numeric_limits<float>::max()));
+			REQUIRE(format_float(std::numeric_limits<float>::infinity()) == "inf");
+			REQUIRE(format_float(-std::numeric_limits<float>::infinity()) == "-inf");
+			REQUIRE(format_float(std::numeric_limits<float>::quiet_NaN()) == "nan");
+		}
+	}
+}
@@ -6,6 +6,10 @@
 #include <runner.h>
 #include <compiler.h>
 
+#include <memory>
+#include <sstream>
+#include <algorithm>
+
 using namespace ink::runtime;
 
 SCENARIO("run story with global variable", "[global variables]")
@@ -74,3 +78,51 @@ SCENARIO("run story with global variable", "[global variables]")
 		}
 	}
 }
+
+SCENARIO("global store starts with the values computed by the compiler", "[global variables]")
+{
+	GIVEN ("a story with constant global declarations")
+	{
+		inklecate("ink/GlobalStory.ink", "GlobalsStory.tmp");
+		ink::compiler::run("GlobalsStory.tmp", "GlobalsStory.bin");
+		std::unique_ptr<story> ink{story::from_file("GlobalsStory.bin")};
+		globals globStore = ink->new_globals();
+
+		THEN("variables are set without running the story")
+		{
+			REQUIRE(*globStore->get<int32_t>("age") == 23);
+			REQUIRE(*globStore->get<const char*>("friendly_name_of_player") == std::string{"Jackie"});
+		}
+		WHEN("a variable is changed before runners are created")
+		{
+			globStore->set<int32_t>("age", 30);
+			runner first = ink->new_runner(globStore);
+			runner second = ink->new_runner(globStore);
+			THEN("runners keep the change")
+			{
+				REQUIRE(*globStore->get<int32_t>("age") == 30);
+				REQUIRE(second->getline() == "My name is Jean Passepartout, but my friend's call me Jackie. I'm 30 years old.\n");
+			}
+		}
+	}
+	GIVEN ("a story with a computed global declaration")
+	{
+		std::stringstream json{R"({"inkVersion":20,"root":[["ev",{"VAR?":"x"},"out","/ev","\n","done",{"#n":"g-0"}],"done",)"
+			R"({"global decl":["ev",1,2,"+",{"VAR=":"x"},"/ev","end",null]}],"listDefs":{}})"};
+		std::stringstream bin;
+		ink::compiler::run(json, bin);
+		std::string data = bin.str();
+		unsigned char* buffer = new unsigned char[data.size()];
+		std::copy(data.begin(), data.end(), buffer);
+		std::unique_ptr<story> ink{story::from_binary(buffer, data.size())};
+		globals globStore = ink->new_globals();
+
+		THEN("the first runner initializes the globals")
+		{
+			REQUIRE_FALSE(globStore->get<int32_t>("x").has_value());
+			runner thread = ink->new_runner(globStore);
+			REQUIRE(*globStore->get<int32_t>("x") == 3);
+			REQUIRE(thread->getline() == "3\n");
+		}
+	}
+}
@@ -0,0 +1,100 @@
+#include "catch.hpp"
+
+#include <story.h>
+#include <runner.h>
+#include <globals.h>
+#include <journal.h>
+#include <snapshot.h>
+#include <compiler.h>
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace ink::runtime;
+
+namespace
+{
+	story* story_from_json(const std::string& text)
+	{
+		std::stringstream json{text};
+		std::stringstream bin;
+		ink::compiler::run(json, bin);
+		std::string data = bin.str();
+		unsigned char* buffer = new unsigned char[data.size()];
+		std::copy(data.begin(), data.end(), buffer);
+		return story::from_binary(buffer, data.size());
+	}
+
+	// rolls with an external function and a random number, prints a global
+	const char* DiceStory = R"json({"inkVersion":20,"root":[[
+		"^Roll ","ev",{"x()":"roll","exArgs":0},"out","/ev","^.","\n",
+		"^Dice ","ev",1,6,"rnd","out","/ev","^.","\n",
+		"^X is ","ev",{"VAR?":"x"},"out","/ev","^.","\n",
+		"ev","str","^Again","/str","/ev",{"*":".^.c-0","flg":4},
+		"ev","str","^Stop","/str","/ev",{"*":".^.c-1","flg":4},
+		{"c-0":["^Roll ","ev",{"x()":"roll","exArgs":0},"out","/ev","^ and x is ","ev",{"VAR?":"x"},"out","/ev","^.","\n","end",{"#f":5}],
+		 "c-1":["^Bye.","\n","end",{"#f":5}]}
+		],"done",{"global decl":["ev",5,{"VAR=":"x"},"/ev","end",null],"#f":1}],"listDefs":{}})json";
+}
+
+SCENARIO("a journal reproduces a session", "[journal]")
+{
+	GIVEN("a recorded session with external functions, random numbers and host globals")
+	{
+		std::unique_ptr<story> ink{story_from_json(DiceStory)};
+		int rolls = 0;
+		runner thread = ink->new_runner();
+		thread->bind("roll", [&rolls]() { return ++rolls * 10; });
+		thread->start_journal();
+
+		std::string text = thread->getline();
+		thread->get_globals()->set<int32_t>("x", 7);
+		text += thread->getall();
+		thread->choose(0);
+		text += thread->getall();
+		REQUIRE(text.find("Roll 10.\n") == 0);
+		REQUIRE(text.find("Roll 20 and x is 7.\n") != std::string::npos);
+
+		std::unique_ptr<journal> log{thread->create_journal()};
+		std::unique_ptr<snapshot> snap{thread->create_snapshot()};
+		REQUIRE(log != nullptr);
+
+		WHEN("it is replayed on a new runner without the external function")
+		{
+			runner replayed = ink->new_runner();
+			replayed->start_journal();
+			replayed->replay(*log);
+
+			THEN("the state is the same")
+			{
+				REQUIRE(replayed->last_result() == run_result::ok);
+				std::unique_ptr<snapshot> replayed_snap{replayed->create_snapshot()};
+				REQUIRE(replayed_snap->state_hash() == snap->state_hash());
+				REQUIRE_FALSE(replayed->can_continue());
+			}
+			THEN("the replay is recorded the same")
+			{
+				std::unique_ptr<journal> again{replayed->create_journal()};
+				REQUIRE(std::string(reinterpret_cast<const char*>(again->get_data()), again->get_data_len())
+					== std::string(reinterpret_cast<const char*>(log->get_data()), log->get_data_len()));
+			}
+		}
+		WHEN("it is loaded from its data")
+		{
+			unsigned char* data = new unsigned char[log->get_data_len()];
+			std::copy(log->get_data(), log->get_data() + log->get_data_len(), data);
+			std::unique_ptr<journal> loaded{journal::from_binary(data, log->get_data_len())};
+			runner replayed = ink->new_runner();
+			replayed->replay(*loaded);
+
+			THEN("it replays the same and is smaller than a snapshot")
+			{
+				std::unique_ptr<snapshot> replayed_snap{replayed->create_snapshot()};
+				REQUIRE(replayed_snap->state_hash() == snap->state_hash());
+				REQUIRE(log->get_data_len() < snap->get_data_len());
+			}
+		}
+	}
+}
@@ -0,0 +1,105 @@
+#include "catch.hpp"
+#include "../inkcpp_cl/test.h"
+
+#include <story.h>
+#include <runner.h>
+#include <globals.h>
+#include <profile.h>
+#include <compiler.h>
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace ink::runtime;
+
+SCENARIO("profiles can be merged and dumped", "[profile]")
+{
+	GIVEN("two profiles")
+	{
+		profile a, b;
+		a.record(1, 100);
+		a.record(1, 50);
+		b.record(1, 10);
+		b.record(2, 500);
+
+		WHEN("they are merged")
+		{
+			a.merge(b);
+			THEN("counters are summed up")
+			{
+				REQUIRE(a.count(1) == 3);
+				REQUIRE(a.nanoseconds(1) == 160);
+				REQUIRE(a.count(2) == 1);
+				REQUIRE(a.total_count() == 4);
+				REQUIRE(a.total_nanoseconds() == 660);
+			}
+			THEN("the histogram is sorted by time")
+			{
+				std::stringstream out;
+				a.dump(out);
+				std::string text = out.str();
+				REQUIRE(text.find(profile::name(2)) < text.find(profile::name(1)));
+				REQUIRE(text.find(profile::name(0)) == std::string::npos);
+			}
+		}
+		WHEN("one is reset")
+		{
+			a.reset();
+			THEN("all counters are zero")
+			{
+				REQUIRE(a.total_count() == 0);
+				REQUIRE(a.total_nanoseconds() == 0);
+			}
+		}
+	}
+}
+
+#ifdef INK_ENABLE_PROFILE
+SCENARIO("runners record a profile", "[profile]")
+{
+	GIVEN("a story")
+	{
+		inklecate("ink/SnapshotStory.ink", "SnapshotStory.tmp");
+		ink::compiler::run("SnapshotStory.tmp", "SnapshotStory.bin");
+		std::unique_ptr<story> ink{story::from_file("SnapshotStory.bin")};
+		globals store = ink->new_globals();
+
+		WHEN("a runner executes it")
+		{
+			runner thread = ink->new_runner(store);
+			thread->getall();
+			uint64_t executed = thread->get_profile().total_count();
+			THEN("commands are counted")
+			{
+				REQUIRE(executed > 0);
+				REQUIRE(store->get_profile().total_count() == executed);
+			}
+			THEN("the store keeps the counts of destroyed runners")
+			{
+				thread = nullptr;
+				REQUIRE(store->get_profile().total_count() == executed);
+			}
+			THEN("commands are attributed to counted knots")
+			{
+				thread->choose(0);
+				thread->getall();
+				std::stringstream out;
+				thread->write_folded_stacks(out, true);
+				std::string folded = out.str();
+				INFO(folded);
+				REQUIRE(folded.find("one ") != std::string::npos);
+				REQUIRE(folded.find("two ") != std::string::npos);
+			}
+			THEN("the profile can be reset")
+			{
+				thread->reset_profile();
+				REQUIRE(thread->get_profile().total_count() == 0);
+				std::stringstream out;
+				thread->write_folded_stacks(out);
+				REQUIRE(out.str().empty());
+			}
+		}
+	}
+}
+#endif
@@ -0,0 +1,75 @@
+#include "catch.hpp"
+#include "../inkcpp_cl/test.h"
+
+#include <story.h>
+#include <globals.h>
+#include <runner.h>
+#include <snapshot.h>
+#include <compiler.h>
+
+#include <memory>
+#include <string>
+
+using namespace ink::runtime;
+
+namespace
+{
+	// plays the given choices, starting and ending at a choice point
+	std::string play(runner& thread, std::initializer_list<int> choices)
+	{
+		std::string out = thread->getall();
+		for (int c : choices)
+		{
+			thread->choose(c);
+			out += thread->getall();
+		}
+		return out;
+	}
+}
+
+SCENARIO("reset a session to reuse it", "[reset]")
+{
+	GIVEN("a session which played a few turns")
+	{
+		inklecate("ink/SnapshotStory.ink", "SnapshotStory.tmp");
+		ink::compiler::run("SnapshotStory.tmp", "SnapshotStory.bin");
+		std::unique_ptr<story> ink{story::from_file("SnapshotStory.bin")};
+		globals store = ink->new_globals();
+		runner thread = ink->new_runner(store);
+
+		const std::string first_turns = "Hello Bob!\nx is 5.\nLeft 6.\nOne was visited 1 times. x is 6.\n";
+		REQUIRE(play(thread, {0}) == first_turns);
+		std::unique_ptr<snapshot> snap{thread->create_snapshot()};
+
+		WHEN("runner and globals are reset")
+		{
+			store->reset();
+			thread->reset();
+			THEN("the session starts over like a new one")
+			{
+				REQUIRE(*store->get<int32_t>("x") == 5);
+				REQUIRE(*store->get<const char*>("name") == std::string{"Bob"});
+				REQUIRE(thread->num_choices() == 0);
+				REQUIRE(play(thread, {0}) == first_turns);
+			}
+			THEN("earlier snapshots are no base for deltas")
+			{
+#ifdef INK_ENABLE_EXCEPTIONS
+				REQUIRE_THROWS(store->delta_since(snap->id()));
+#else
+				REQUIRE(store->delta_since(snap->id()) == nullptr);
+#endif
+			}
+		}
+		WHEN("only the runner is reset")
+		{
+			thread->reset();
+			THEN("it starts over with the current globals")
+			{
+				REQUIRE(thread->getline() == "Hello Bob!!\n");
+				REQUIRE(thread->getline() == "x is 6.\n");
+				REQUIRE(thread->num_choices() == 2);
+			}
+		}
+	}
+}
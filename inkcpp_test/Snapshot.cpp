@@ -0,0 +1,295 @@
+#include "catch.hpp"
+#include "../inkcpp_cl/test.h"
+
+#include <story.h>
+#include <globals.h>
+#include <runner.h>
+#include <snapshot.h>
+#include <choice.h>
+#include <compiler.h>
+
+#include "../inkcpp/snapshot_impl.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+using namespace ink::runtime;
+
+namespace
+{
+	// plays the given choices, starting and ending at a choice point
+	std::string play(runner& thread, std::initializer_list<int> choices)
+	{
+		std::string out = thread->getall();
+		for (int c : choices)
+		{
+			thread->choose(c);
+			out += thread->getall();
+		}
+		return out;
+	}
+
+	std::string bytes(const snapshot& snap)
+	{
+		return std::string(reinterpret_cast<const char*>(snap.get_data()), snap.get_data_len());
+	}
+}
+
+SCENARIO("snapshot and restore a running story", "[snapshot]")
+{
+	GIVEN("a story paused at a choice point")
+	{
+		inklecate("ink/SnapshotStory.ink", "SnapshotStory.tmp");
+		ink::compiler::run("SnapshotStory.tmp", "SnapshotStory.bin");
+		std::unique_ptr<story> ink{story::from_file("SnapshotStory.bin")};
+		globals store = ink->new_globals();
+		runner thread = ink->new_runner(store);
+
+		REQUIRE(play(thread, {0}) == "Hello Bob!\nx is 5.\nLeft 6.\nOne was visited 1 times. x is 6.\n");
+		REQUIRE(thread->num_choices() == 2);
+
+		std::unique_ptr<snapshot> snap{thread->create_snapshot()};
+		REQUIRE(snap->num_runners() == 1);
+
+		WHEN("a runner is restored from the snapshot")
+		{
+			runner restored = ink->new_runner_from_snapshot(*snap);
+			THEN("it offers the same choices")
+			{
+				REQUIRE(restored->num_choices() == 2);
+				REQUIRE(restored->get_choice(1)->text() == std::string{"Right"});
+			}
+			THEN("it continues like the original")
+			{
+				std::string expected = play(thread, {1, 0});
+				REQUIRE(play(restored, {1, 0}) == expected);
+				REQUIRE(expected == "Right.\nx is 6.\nLeft 7.\nBye Bob!!.\n");
+				REQUIRE_FALSE(restored->can_continue());
+			}
+			THEN("its next snapshot is byte-identical to the original's")
+			{
+				std::unique_ptr<snapshot> again{restored->create_snapshot()};
+				std::unique_ptr<snapshot> next{thread->create_snapshot()};
+				REQUIRE(again->id() == next->id());
+				REQUIRE(bytes(*again) == bytes(*next));
+			}
+		}
+		WHEN("the snapshot goes through a file")
+		{
+			snap->write_to_file("SnapshotStory.snap");
+			std::unique_ptr<snapshot> loaded{snapshot::from_file("SnapshotStory.snap")};
+			runner restored = ink->new_runner_from_snapshot(*loaded);
+			THEN("the restored runner continues like the original")
+			{
+				REQUIRE(bytes(*loaded) == bytes(*snap));
+				REQUIRE(play(restored, {0, 1}) == play(thread, {0, 1}));
+			}
+		}
+		WHEN("the globals are snapshotted")
+		{
+			std::unique_ptr<snapshot> globals_snap{store->create_snapshot()};
+			globals restored = ink->new_globals_from_snapshot(*globals_snap);
+			THEN("variables are kept")
+			{
+				REQUIRE(*restored->get<int32_t>("x") == 6);
+				REQUIRE(*restored->get<const char*>("name") == std::string{"Bob!"});
+			}
+			THEN("the runners using them can be restored onto the store")
+			{
+				REQUIRE(globals_snap->num_runners() == 1);
+				runner resumed = ink->new_runner_from_snapshot(*globals_snap, restored);
+				resumed->choose(0);
+				REQUIRE(resumed->getall() == "Left 7.\nx is 7.\n");
+				REQUIRE(*restored->get<const char*>("name") == std::string{"Bob!!"});
+			}
+		}
+		WHEN("the snapshot data is loaded again")
+		{
+			load_result result{false, "unset"};
+			std::unique_ptr<snapshot> loaded{snapshot::from_binary(snap->get_data(), snap->get_data_len(), false, &result)};
+			THEN("the result reports success")
+			{
+				REQUIRE(loaded != nullptr);
+				REQUIRE(result.ok);
+				REQUIRE(result.error == nullptr);
+			}
+		}
+		WHEN("the snapshot data is corrupted")
+		{
+			std::unique_ptr<unsigned char[]> data{new unsigned char[snap->get_data_len()]};
+			for (size_t i = 0; i < snap->get_data_len(); ++i)
+				data[i] = snap->get_data()[i];
+			data[0] = 'X';
+			THEN("loading it fails")
+			{
+#ifdef INK_ENABLE_EXCEPTIONS
+				REQUIRE_THROWS_AS(snapshot::from_binary(data.get(), snap->get_data_len(), false), ink::ink_exception);
+#else
+				load_result result;
+				REQUIRE(snapshot::from_binary(data.get(), snap->get_data_len(), false, &result) == nullptr);
+				REQUIRE_FALSE(result.ok);
+				REQUIRE(result.error == std::string("Data is not an ink snapshot"));
+#endif
+			}
+		}
+	}
+}
+
+SCENARIO("delta snapshots between turns", "[snapshot]")
+{
+	GIVEN("a snapshot at the first choice")
+	{
+		inklecate("ink/SnapshotStory.ink", "SnapshotStory.tmp");
+		ink::compiler::run("SnapshotStory.tmp", "SnapshotStory.bin");
+		std::unique_ptr<story> ink{story::from_file("SnapshotStory.bin")};
+		globals store = ink->new_globals();
+		runner thread = ink->new_runner(store);
+		thread->getall();
+		std::unique_ptr<snapshot> base{store->create_snapshot()};
+		REQUIRE_FALSE(base->is_delta());
+
+		WHEN("a delta is taken after the next turn")
+		{
+			thread->choose(0);
+			thread->getall();
+			std::unique_ptr<snapshot> delta{store->delta_since(base->id())};
+			std::unique_ptr<snapshot> full{store->create_snapshot()};
+
+			THEN("it is smaller than a full snapshot")
+			{
+				REQUIRE(delta->is_delta());
+				REQUIRE(delta->id() > base->id());
+				REQUIRE(delta->get_data_len() < full->get_data_len());
+			}
+			THEN("it can not be loaded on its own")
+			{
+#ifdef INK_ENABLE_EXCEPTIONS
+				REQUIRE_THROWS_AS(ink->new_globals_from_snapshot(*delta), ink::ink_exception);
+#else
+				load_result result;
+				REQUIRE_FALSE(ink->new_globals_from_snapshot(*delta, nullptr, &result));
+				REQUIRE(result.error == std::string("Delta snapshots must be applied onto their base before loading"));
+#endif
+			}
+			THEN("applied onto its base it restores the same state")
+			{
+				std::unique_ptr<snapshot> merged{ink->apply_delta(*base, *delta)};
+				REQUIRE_FALSE(merged->is_delta());
+				REQUIRE(merged->id() == delta->id());
+
+				runner restored = ink->new_runner_from_snapshot(*merged);
+				std::unique_ptr<snapshot> again{restored->create_snapshot()};
+				REQUIRE(bytes(*again) == bytes(*full));
+				REQUIRE(play(restored, {1, 0}) == play(thread, {1, 0}));
+			}
+			THEN("further deltas can be chained")
+			{
+				std::unique_ptr<snapshot> merged{ink->apply_delta(*base, *delta)};
+				thread->choose(0);
+				thread->getall();
+				std::unique_ptr<snapshot> next{store->delta_since(delta->id())};
+				std::unique_ptr<snapshot> chained{ink->apply_delta(*merged, *next)};
+
+				runner restored = ink->new_runner_from_snapshot(*chained);
+				REQUIRE(play(restored, {0}) == "Left 8.\nBye Bob!!!.\n");
+#ifdef INK_ENABLE_EXCEPTIONS
+				REQUIRE_THROWS_AS(ink->apply_delta(*base, *next), ink::ink_exception);
+#else
+				load_result result;
+				REQUIRE(ink->apply_delta(*base, *next, &result) == nullptr);
+				REQUIRE(result.error == std::string("Delta snapshot does not fit onto base snapshot"));
+#endif
+			}
+		}
+	}
+}
+
+SCENARIO("fork a running story", "[snapshot]")
+{
+	GIVEN("a runner paused at a choice point")
+	{
+		inklecate("ink/SnapshotStory.ink", "SnapshotStory.tmp");
+		ink::compiler::run("SnapshotStory.tmp", "SnapshotStory.bin");
+		std::unique_ptr<story> ink{story::from_file("SnapshotStory.bin")};
+		globals store = ink->new_globals();
+		runner thread = ink->new_runner(store);
+		play(thread, {0});
+
+		WHEN("it is forked")
+		{
+			runner forked = thread->fork();
+			THEN("the fork offers the same choices")
+			{
+				REQUIRE(forked->num_choices() == 2);
+				REQUIRE(forked->get_choice(1)->text() == std::string{"Right"});
+			}
+			THEN("both continue independently")
+			{
+				std::string left = play(forked, {0});
+				std::string right = play(thread, {1, 0});
+				REQUIRE(left == "Left 7.\nx is 7.\n");
+				REQUIRE(right == "Right.\nx is 6.\nLeft 7.\nBye Bob!!.\n");
+				REQUIRE(*store->get<int32_t>("x") == 7);
+				REQUIRE(*store->get<const char*>("name") == std::string{"Bob!!"});
+			}
+			THEN("the fork continues like the original would have")
+			{
+				runner other = thread->fork();
+				REQUIRE(play(forked, {1, 0}) == play(thread, {1, 0}));
+				REQUIRE(play(other, {0}) == "Left 7.\nx is 7.\n");
+			}
+		}
+	}
+}
+
+SCENARIO("snapshots number any amount of dynamic strings", "[snapshot]")
+{
+	using ink::runtime::internal::string_id_map;
+
+	GIVEN("more strings than the initial map capacity")
+	{
+		constexpr uint32_t count = 1000;
+		std::unique_ptr<char[]> strings(new char[count]);
+		string_id_map ids;
+		for (uint32_t i = 0; i < count; ++i)
+			REQUIRE(ids.insert(&strings[i], i));
+
+		THEN("every string keeps its id")
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				uint32_t id = ~0u;
+				REQUIRE(ids.find(&strings[i], id));
+				REQUIRE(id == i);
+			}
+		}
+		THEN("a string can not be numbered twice")
+		{
+			REQUIRE_FALSE(ids.insert(&strings[42], count));
+		}
+	}
+}
+
+SCENARIO("snapshot throughput", "[.benchmark][snapshot]")
+{
+	inklecate("ink/SnapshotStory.ink", "SnapshotStory.tmp");
+	ink::compiler::run("SnapshotStory.tmp", "SnapshotStory.bin");
+	std::unique_ptr<story> ink{story::from_file("SnapshotStory.bin")};
+	runner thread = ink->new_runner();
+	play(thread, {0});
+
+	const int iterations = 10000;
+	size_t size = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; ++i)
+	{
+		std::unique_ptr<snapshot> snap{thread->create_snapshot()};
+		size = snap->get_data_len();
+		runner restored = ink->new_runner_from_snapshot(*snap);
+	}
+	auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start);
+
+	WARN("snapshot size: " << size << " bytes, save+restore: " << elapsed.count() / iterations << " us");
+	SUCCEED();
+}
@@ -6,6 +6,11 @@
 #include <runner.h>
 #include <compiler.h>
 #include <choice.h>
+#include <snapshot.h>
+
+#include <memory>
+#include <sstream>
+#include <algorithm>
 
 using namespace ink::runtime;
 
@@ -94,3 +99,112 @@ SCENARIO("run story with tags", "[tags]")
 		}
 	}
 }
+
+namespace
+{
+	story* story_from_json(const std::string& text)
+	{
+		std::stringstream json{text};
+		std::stringstream bin;
+		ink::compiler::run(json, bin);
+		std::string data = bin.str();
+		unsigned char* buffer = new unsigned char[data.size()];
+		std::copy(data.begin(), data.end(), buffer);
+		return story::from_binary(buffer, data.size());
+	}
+
+	// a choice with text and tags, leading to a line with its number
+	std::string choice_json(int i, const std::string& tags)
+	{
+		std::string n = std::to_string(i);
+		return R"("ev","str","^Option )" + n + "\"," + tags + R"("/str","/ev",{"*":".^.c-)" + n + R"(","flg":4},)";
+	}
+}
+
+SCENARIO("choices have tags and grow", "[tags]")
+{
+	GIVEN("a story with tags in the text of its choices")
+	{
+		std::string choices, targets;
+		for (int i = 0; i < 12; ++i)
+		{
+			std::string tags = i == 0 ? R"({"#":"first"},{"#":"warm"},)" : i == 11 ? R"({"#":"last"},)" : "";
+			choices += choice_json(i, tags);
+			targets += (i ? "," : "") + std::string(R"("c-)") + std::to_string(i)
+				+ R"(":["^Picked )" + std::to_string(i) + R"(.","\n","end",{"#f":5}])";
+		}
+		std::unique_ptr<story> ink{story_from_json(
+			R"({"inkVersion":20,"root":[["^Pick one.",{"#":"line"},"\n",)" + choices + "{" + targets
+			+ R"(}],"done",{"#f":1}],"listDefs":{}})")};
+		runner thread = ink->new_runner();
+
+		WHEN("the choices are presented")
+		{
+			std::string line = thread->getall();
+
+			THEN("there are more choices than the default capacity")
+			{
+				REQUIRE(line == "Pick one.\n");
+				REQUIRE(thread->num_choices() == 12);
+				REQUIRE(std::string(thread->get_choice(11)->text()) == "Option 11");
+			}
+			THEN("choice tags are separate from line tags")
+			{
+				REQUIRE(thread->num_tags() == 1);
+				REQUIRE(std::string(thread->get_tag(0)) == "line");
+
+				const choice* first = thread->get_choice(0);
+				REQUIRE(first->num_tags() == 2);
+				REQUIRE(std::string(first->get_tag(0)) == "first");
+				REQUIRE(std::string(first->get_tag(1)) == "warm");
+				REQUIRE_FALSE(thread->get_choice(5)->has_tags());
+				REQUIRE(thread->get_choice(11)->num_tags() == 1);
+				REQUIRE(std::string(thread->get_choice(11)->get_tag(0)) == "last");
+			}
+			THEN("tags survive a snapshot")
+			{
+				std::unique_ptr<snapshot> snap{thread->create_snapshot()};
+				runner loaded = ink->new_runner_from_snapshot(*snap);
+				REQUIRE(loaded->num_choices() == 12);
+				REQUIRE(std::string(loaded->get_choice(0)->get_tag(1)) == "warm");
+				REQUIRE(std::string(loaded->get_choice(11)->get_tag(0)) == "last");
+			}
+			WHEN("a choice is taken")
+			{
+				thread->choose(11);
+				THEN("its tags do not carry over")
+				{
+					REQUIRE(thread->getall() == "Picked 11.\n");
+					REQUIRE_FALSE(thread->has_tags());
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("tags in other strings are line tags", "[tags]")
+{
+	GIVEN("a line built from a string expression with a tag, before a choice")
+	{
+		std::unique_ptr<story> ink{story_from_json(
+			R"({"inkVersion":20,"root":[["ev","str","^Built",{"#":"inner"},"/str","out","/ev","\n",)"
+			+ choice_json(0, R"({"#":"option"},)")
+			+ R"({"c-0":["^Picked 0.","\n","end",{"#f":5}]}],"done",{"#f":1}],"listDefs":{}})")};
+		runner thread = ink->new_runner();
+
+		WHEN("the line is read")
+		{
+			std::string line = thread->getall();
+
+			THEN("the tag belongs to the line, not to the choice")
+			{
+				REQUIRE(line == "Built\n");
+				REQUIRE(thread->num_tags() == 1);
+				REQUIRE(std::string(thread->get_tag(0)) == "inner");
+				REQUIRE(thread->num_choices() == 1);
+				REQUIRE(thread->get_choice(0)->num_tags() == 1);
+				REQUIRE(std::string(thread->get_choice(0)->get_tag(0)) == "option");
+			}
+		}
+	}
+}
@@ -0,0 +1,86 @@
+#include "catch.hpp"
+#include "../inkcpp_cl/test.h"
+
+#include <story.h>
+#include <globals.h>
+#include <runner.h>
+#include <compiler.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ink::runtime;
+
+SCENARIO("a story can be shared between threads", "[threading]")
+{
+	GIVEN("a story loaded once")
+	{
+		inklecate("ink/GlobalStory.ink", "ThreadStory.tmp");
+		ink::compiler::run("ThreadStory.tmp", "ThreadStory.bin");
+		std::unique_ptr<story> ink{story::from_file("ThreadStory.bin")};
+
+		const std::string expected = "My name is Jean Passepartout, but my friend's call me Jackie. I'm 23 years old.\nFoo:23\n";
+		const int num_threads = 8;
+		const int iterations = 200;
+
+		WHEN("many threads create and destroy runners and globals")
+		{
+			std::atomic<int> failures = 0;
+			std::vector<std::thread> threads;
+			for (int t = 0; t < num_threads; ++t)
+			{
+				threads.emplace_back([&ink, &failures, &expected, t]() {
+					for (int i = 0; i < iterations; ++i)
+					{
+						globals store = ink->new_globals();
+						runner thread = ink->new_runner(store);
+
+						// copy pointers around to exercise the shared story reference count
+						runner copy = thread;
+						globals store_copy = store;
+						if (copy->getall() != expected)
+							failures++;
+
+						// every other iteration also run a runner with its own globals
+						if ((i + t) % 2 == 0)
+						{
+							runner own = ink->new_runner();
+							if (own->getall() != expected)
+								failures++;
+						}
+						if (*store_copy->get<int32_t>("age") != 23)
+							failures++;
+					}
+				});
+			}
+			for (auto& thread : threads)
+				thread.join();
+
+			THEN("every runner produces the same output")
+			{
+				REQUIRE(failures == 0);
+			}
+		}
+		WHEN("pointers to one runner are released on different threads")
+		{
+			runner thread = ink->new_runner();
+			std::vector<runner> copies(num_threads, thread);
+			std::vector<std::thread> threads;
+			for (auto& copy : copies)
+			{
+				threads.emplace_back([&copy]() { copy = nullptr; });
+			}
+			for (auto& t : threads)
+				t.join();
+
+			THEN("the last owner still holds a valid runner")
+			{
+				REQUIRE(thread.is_valid());
+				REQUIRE(thread->getall() == expected);
+			}
+		}
+	}
+}
@@ -140,6 +140,15 @@ namespace ink
 		// == Function/Tunnel flags
 		FUNCTION_TO_VARIABLE = 1 << 0,
 		TUNNEL_TO_VARIABLE = 1 << 0,
+
+		// == String flags: what story text consists of, so the runtime doesn't scan it
+		STRING_IS_CLASSIFIED = 1 << 0, // the other string flags are set
+		STRING_IS_WHITESPACE = 1 << 1, // only spaces, tabs and newlines (or empty)
+		STRING_IS_BLANK = 1 << 2,      // only spaces and tabs (or empty)
+		STRING_IS_SPACE = 1 << 3,      // only characters isspace() accepts (or empty)
+
+		// == String evaluation flags (START_STR and END_STR)
+		STRING_EVAL_IS_CHOICE_TEXT = 1 << 0, // builds the text of a choice, tags in it belong to the choice
 	};
 
 	inline bool operator& (CommandFlag lhs, CommandFlag rhs)
@@ -4,6 +4,33 @@
 
 namespace ink::internal {
 
+		// Upper bounds of runtime buffers, computed by the compiler and stored in the header
+		enum class bound : unsigned char
+		{
+			call_depth,       // nested tunnels, functions and threads
+			thread_depth,     // nested threads
+			eval_stack,       // evaluation stack entries
+			runtime_stack,    // callstack frames, temporaries and thread markers
+			container_depth,  // nested counted containers
+			choices,          // choices per turn
+			tags,             // tags per turn
+			output,           // output elements per line
+			global_variables, // global variables
+			NUM_BOUNDS
+		};
+
+		// Type of an entry in the initial globals image
+		enum class global_type : uint32_t
+		{
+			int32,     // payload: value
+			float32,   // payload: bits of the value
+			boolean,   // payload: 0 or 1
+			string,    // payload: string table offset, EmptyString for ""
+			list,      // payload: index of the predefined list
+			list_flag, // payload: list id and flag, as stored in the list meta data
+			divert,    // payload: instruction offset
+		};
+
 		struct header {
 			static header parse_header(const char* data);
 
@@ -24,6 +51,12 @@ namespace ink::internal {
 				}
 				return result;
 			}
+			uint32_t read_uint32(const char*& ptr) const {
+				uint32_t result = *reinterpret_cast<const uint32_t*>(ptr);
+				ptr += sizeof(uint32_t);
+				return endien == ink::internal::header::endian_types::differ
+					? swap_bytes(result) : result;
+			}
 
 			enum class  endian_types: uint16_t {
 				none = 0,
@@ -32,9 +65,25 @@ namespace ink::internal {
 			} endien = endian_types::none;
 			uint32_t ink_version_number = 0;
 			uint32_t ink_bin_version_number = 0;
+
+			static constexpr size_t NumBounds = static_cast<size_t>(bound::NUM_BOUNDS);
+			// value of a bound which depends on recursion or an unbounded loop
+			static constexpr uint32_t Unbounded = ~0u;
+			// bounds_flags: a tunnel, function or thread calls itself
+			static constexpr uint32_t BoundsRecursive = 1 << 0;
+
+			uint32_t bounds_flags = 0;
+			uint32_t bounds[NumBounds] = {};
+			uint32_t get_bound(bound b) const { return bounds[static_cast<size_t>(b)]; }
+
+			// entry count of a globals image which the compiler could not evaluate
+			static constexpr uint32_t NoGlobalsImage = ~0u;
+			// string payload of an empty string, which has no string table entry
+			static constexpr uint32_t EmptyString = ~0u;
+
 			static constexpr size_t Size = ///< actual data size of Header,
 										   ///   because padding of struct may
 										   ///   differ between platforms
-				sizeof(uint16_t) + 2 * sizeof(uint32_t);
+				sizeof(uint16_t) + (3 + NumBounds) * sizeof(uint32_t);
 		};
 }
@@ -7,31 +7,46 @@
 #define INK_ENABLE_CSTD
 #endif
 
+// Define INK_DISABLE_EXCEPTIONS to build the runtime without exceptions.
+// Errors then abort the current line or choice, which reports them through
+// runner_interface::last_result and runner_interface::last_error
+#ifndef INK_DISABLE_EXCEPTIONS
+#define INK_ENABLE_EXCEPTIONS
+#endif
+
 // Only turn on if you have json.hpp and you want to use it with the compiler
 // #define INK_EXPOSE_JSON
 
 namespace ink::config {
+	/// Define INK_FIXED_SIZE_LIMITS to make all limits below positive, so
+	/// runners never grow their storage on the heap.
+#ifdef INK_FIXED_SIZE_LIMITS
+	static constexpr int dynamic = 1;
+#else
+	static constexpr int dynamic = -1;
+#endif
+
 	/// set limitations which are required to minimize heap allocations.
 	/// if required you can set them to -x then, the system will use dynamic
 	/// allocation for this type, with an initial size of x.
-	static constexpr int limitGlobalVariables = -50;
-	static constexpr int limitThreadDepth = -10;
-	static constexpr int limitEvalStackDepth = -20;
-	static constexpr int limitContainerDepth = -20;
-	/// number of simultaneous active tags
-	static constexpr int limitActiveTags = 10;
+	static constexpr int limitGlobalVariables = dynamic * 50;
+	static constexpr int limitThreadDepth = dynamic * 10;
+	static constexpr int limitEvalStackDepth = dynamic * 20;
+	static constexpr int limitContainerDepth = dynamic * 20;
+	/// number of simultaneous active tags, and of tags in the choices of a turn
+	static constexpr int limitActiveTags = dynamic * 10;
 	// temporary variables and callstack;
-	static constexpr int limitRuntimeStack = -20;
+	static constexpr int limitRuntimeStack = dynamic * 20;
 	// references  and callstack
-	static constexpr int limitReferenceStack = -20;
+	static constexpr int limitReferenceStack = dynamic * 20;
 	// max number of elements in one output (a string is one element)
 	// no dynamic support now! (FIXME)
 	static constexpr int limitOutputSize = 200;
 	// max number of choices per choice
-	static constexpr int maxChoices = 10;
+	static constexpr int maxChoices = dynamic * 10;
 	// max number of list types, and there total amount of flags
-	static constexpr int maxListTypes = -20;
-	static constexpr int maxFlags = -200;
+	static constexpr int maxListTypes = dynamic * 20;
+	static constexpr int maxFlags = dynamic * 200;
 	// number of max initelized lists
-	static constexpr int maxLists = -50;
+	static constexpr int maxLists = dynamic * 50;
 }
@@ -213,5 +213,10 @@ namespace ink
 #else
 #define inkZeroMemory ink::zero_memory
 #define inkAssert ink::ink_assert
+#ifdef INK_ENABLE_EXCEPTIONS
 #define inkFail(text) ink::ink_assert(text)
+#else
+// Without exceptions failing returns, see inkcpp/error.h
+#define inkFail(text) ink::ink_assert(false, text)
+#endif
 #endif